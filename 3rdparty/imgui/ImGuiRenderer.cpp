@@ -1,4 +1,5 @@
 #include "ImGuiRenderer.h"
+#include "RingBuffer.hpp"
 #include <QDateTime>
 #include <QGuiApplication>
 #include <QMouseEvent>
@@ -157,16 +158,37 @@ void ImGuiRenderer::renderDrawList(ImDrawData *draw_data)
     glUniformMatrix4fv(g_AttribLocationProjMtx, 1, GL_FALSE, &ortho_projection[0][0]);
     glBindVertexArray(g_VaoHandle);
 
+    // Stream all lists of this frame into one ring region (plus alignment slack per list)
+    if (m_ring)
+    {
+        m_ring->beginFrame();
+        m_ring->reserve((GLsizeiptr)draw_data->TotalVtxCount * sizeof(ImDrawVert) + (GLsizeiptr)draw_data->TotalIdxCount * sizeof(ImDrawIdx)
+                        + (GLsizeiptr)draw_data->CmdListsCount * (sizeof(ImDrawVert) + sizeof(ImDrawIdx)));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ring->getId());
+    }
+
     for (int n = 0; n < draw_data->CmdListsCount; n++)
     {
         const ImDrawList* cmd_list = draw_data->CmdLists[n];
         const ImDrawIdx* idx_buffer_offset = 0;
 
-        glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
-        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
+        if (m_ring)
+        {
+            RingBuffer::Allocation vtx = m_ring->write(cmd_list->VtxBuffer.Data, (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), sizeof(ImDrawVert));
+            RingBuffer::Allocation idx = m_ring->write(cmd_list->IdxBuffer.Data, (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), sizeof(ImDrawIdx));
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, m_ring->getId());
+            setupVertexAttribs(vtx.offset);
+            idx_buffer_offset = (const ImDrawIdx*)(size_t)idx.offset;
+        }
+        else
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, g_VboHandle);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
+
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_ElementsHandle);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+        }
 
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
         {
@@ -185,6 +207,9 @@ void ImGuiRenderer::renderDrawList(ImDrawData *draw_data)
         }
     }
 
+    if (m_ring)
+        m_ring->endFrame();
+
     // Restore modified GL state
     glUseProgram(last_program);
     glBindTexture(GL_TEXTURE_2D, last_texture);
@@ -295,12 +320,12 @@ bool ImGuiRenderer::createDeviceObjects()
     glEnableVertexAttribArray(g_AttribLocationPosition);
     glEnableVertexAttribArray(g_AttribLocationUV);
     glEnableVertexAttribArray(g_AttribLocationColor);
+    setupVertexAttribs(0);
 
-#define OFFSETOF(TYPE, ELEMENT) ((size_t)&(((TYPE *)0)->ELEMENT))
-    glVertexAttribPointer(g_AttribLocationPosition, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)OFFSETOF(ImDrawVert, pos));
-    glVertexAttribPointer(g_AttribLocationUV, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)OFFSETOF(ImDrawVert, uv));
-    glVertexAttribPointer(g_AttribLocationColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)OFFSETOF(ImDrawVert, col));
-#undef OFFSETOF
+#ifndef USE_GLSL_ES
+    if (RingBuffer::isSupported())
+        m_ring = std::make_unique<RingBuffer>(1 << 20);
+#endif
 
     createFontsTexture();
 
@@ -312,6 +337,15 @@ bool ImGuiRenderer::createDeviceObjects()
     return true;
 }
 
+void ImGuiRenderer::setupVertexAttribs(size_t baseOffset)
+{
+#define OFFSETOF(TYPE, ELEMENT) ((size_t)&(((TYPE *)0)->ELEMENT))
+    glVertexAttribPointer(g_AttribLocationPosition, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)(baseOffset + OFFSETOF(ImDrawVert, pos)));
+    glVertexAttribPointer(g_AttribLocationUV, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), (GLvoid*)(baseOffset + OFFSETOF(ImDrawVert, uv)));
+    glVertexAttribPointer(g_AttribLocationColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)(baseOffset + OFFSETOF(ImDrawVert, col)));
+#undef OFFSETOF
+}
+
 void ImGuiRenderer::newFrame()
 {
     // Select current context
@@ -378,6 +412,11 @@ ImGuiRenderer::ImGuiRenderer()
 ImGuiRenderer::~ImGuiRenderer()
 {
   // remove this context
+  // GL objects already died with the context if it is gone
+  if (QOpenGLContext::currentContext())
+    m_ring.reset();
+  else
+    m_ring.release();
   ImGui::DestroyContext(g_ctx);
 }
 
@@ -9,6 +9,7 @@
 class QMouseEvent;
 class QWheelEvent;
 class QKeyEvent;
+class RingBuffer;
 
 namespace QtImGui {
 
@@ -49,6 +50,7 @@ private:
     void renderDrawList(ImDrawData *draw_data);
     bool createFontsTexture();
     bool createDeviceObjects();
+    void setupVertexAttribs(size_t baseOffset);
 
     std::unique_ptr<WindowWrapper> m_window;
     double       g_Time = 0.0f;
@@ -60,6 +62,7 @@ private:
     int          g_AttribLocationTex = 0, g_AttribLocationProjMtx = 0;
     int          g_AttribLocationPosition = 0, g_AttribLocationUV = 0, g_AttribLocationColor = 0;
     unsigned int g_VboHandle = 0, g_VaoHandle = 0, g_ElementsHandle = 0;
+    std::unique_ptr<RingBuffer> m_ring;  // persistent-mapped vertex/index stream (desktop GL 4.4+ only)
 
     ImGuiContext* g_ctx = nullptr;
 };
@@ -0,0 +1,36 @@
+#version 450 core
+
+/* Rest pose of every blade instance (patch x blade) for bladeSimulationCS, optionally resets the state to it */
+
+layout(local_size_x = 64) in;
+
+#include "frameUniforms.glsl"
+#include "grassBlade.glsl"
+
+uniform int uPatchCount;
+uniform float uStiffness;
+uniform int uResetState;
+
+void main()
+{
+    int bladeCount = grassBlades.length();
+    int index = int(gl_GlobalInvocationID.x);
+    if (index >= uPatchCount * bladeCount)
+        return;
+
+    int patchIndex = index / bladeCount;
+    int bladeIndex = index % bladeCount;
+    Blade blade = grassBlades[bladeIndex];
+
+    /* Root on the terrain and the tip between the upper corners, both without wind */
+    BladeVertex bottomLeft = computeBladeVertex(patchIndex, bladeIndex, blade, 0, false);
+    BladeVertex topRight   = computeBladeVertex(patchIndex, bladeIndex, blade, 2, false);
+    BladeVertex topLeft    = computeBladeVertex(patchIndex, bladeIndex, blade, 3, false);
+    vec3 root = bottomLeft.root;
+    vec3 tip  = 0.5 * (topRight.position.xyz + topLeft.position.xyz);
+    float height = bottomLeft.discardBlade == 1 ? 0.0 : length(tip - root);
+
+    bladeRest[index] = BladeRest(vec4(root, height), vec4(tip, 0.0), vec4(bottomLeft.normal, uStiffness * blade.randoms1.x));
+    if (uResetState == 1)
+        bladeStates[index] = BladeState(vec4(root + vec3(0.0, height, 0.0), 0.0), vec4(tip, 0.0));
+}
@@ -0,0 +1,21 @@
+/* Persistent blade state of bladeSimulationCS, one entry per patch x blade (mirrors BladeSimulation::State/Rest) */
+
+struct BladeState
+{
+    vec4 v1;        // xyz, w unused
+    vec4 v2;        // xyz, w = collision strength
+};
+struct BladeRest
+{
+    vec4 root;      // v0, w = blade height (0 - blade is discarded)
+    vec4 tip;       // rest position of v2, w unused
+    vec4 front;     // facing direction, w = stiffness
+};
+layout(std430, binding=7) buffer bladeStatesBuffer
+{
+    BladeState bladeStates[];
+};
+layout(std430, binding=8) buffer bladeRestBuffer
+{
+    BladeRest bladeRest[];
+};
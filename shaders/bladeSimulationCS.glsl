@@ -0,0 +1,116 @@
+#version 450 core
+
+/* One step of the blade model, same operations in the same order as BladeSimulation::step (CPU reference) */
+
+layout(local_size_x = 64) in;
+
+#define M_PI 3.1415926535897932384626433832795
+#define MAX_COLLIDERS 8
+
+#include "frameUniforms.glsl"
+#include "bladeSimulation.glsl"
+
+uniform int uInstanceCount;
+uniform float uGravity;
+uniform float uWindStrength;
+uniform float uCollisionDecay;     // per second
+uniform int uSimulationTime;       // ms, drives the wind like uTime
+uniform float uDeltaTime;          // s
+uniform int uColliderCount;
+uniform vec4 uColliders[2 * MAX_COLLIDERS];   // capsules: (a, radius), (b, unused), spheres have a == b
+
+/* Same field as the analytic wind in grassBlade.glsl, the pole of the cos() term is clamped like BladeSimulation::windForce */
+vec3 windForce(vec3 p)
+{
+    if (uWindEnabled == 0)
+        return vec3(0.0);
+
+    float c1 = uWindParams.x;
+    float c2 = 2.0;
+    float c3 = uWindParams.y;
+    float a = M_PI * p.x + 10.0 * (uWindParams.z + 1.0) + (M_PI / 4) / max(abs(cos(c2 * M_PI * p.z)), 0.05);
+    float w = sin(c1 * a) * cos(c3 * a);
+
+    float phase = p.x + p.y + p.z;
+    float x = (1.0 * sin(0.03 * (phase + uSimulationTime / 30))) + 1.0 + w;
+    float z = (0.5 * sin(0.03 * (phase + uSimulationTime / 100))) + 0.5 + w;
+
+    return vec3(x, 0.0, z) * uWindStrength;
+}
+
+/* Point p pushed out of collider i, zero when p is outside */
+vec3 collide(vec3 p, int i)
+{
+    vec3 a = uColliders[2 * i].xyz;
+    vec3 ab = uColliders[2 * i + 1].xyz - a;
+    float radius = uColliders[2 * i].w;
+    float abLength2 = dot(ab, ab);
+    float t = abLength2 > 0.0 ? clamp(dot(p - a, ab) / abLength2, 0.0, 1.0) : 0.0;
+    vec3 d = p - (a + t * ab);
+    float distance = length(d);
+
+    if (distance >= radius || distance == 0.0)
+        return vec3(0.0);
+    return d * ((radius - distance) / distance);
+}
+
+void main()
+{
+    int index = int(gl_GlobalInvocationID.x);
+    if (index >= uInstanceCount)
+        return;
+
+    BladeRest rest = bladeRest[index];
+    float height = rest.root.w;
+    if (height <= 0.0)
+        return;
+
+    const vec3 up = vec3(0.0, 1.0, 0.0);
+    vec3 v0 = rest.root.xyz;
+    vec3 v1 = bladeStates[index].v1.xyz;
+    vec3 v2 = bladeStates[index].v2.xyz;
+    float collision = bladeStates[index].v2.w;
+    float dt = uDeltaTime;
+
+    /* Gravity - environmental plus a front component that bends the blade along its facing */
+    vec3 gravity = vec3(0.0, -uGravity, 0.0) + 0.25 * uGravity * rest.front.xyz;
+
+    /* Recovery towards the rest pose, weakened while the blade is pressed down */
+    vec3 recovery = (rest.tip.xyz - v2) * rest.front.w * max(1.0 - collision, 0.1);
+
+    /* Wind, strongest on upright blades standing across it */
+    vec3 wind = windForce(v0);
+    float windLength = length(wind);
+    if (windLength > 0.0)
+    {
+        float directionalAlignment = 1.0 - abs(dot(wind / windLength, normalize(v2 - v0)));
+        float heightRatio = dot(v2 - v0, up) / height;
+        wind = wind * (directionalAlignment * heightRatio);
+    }
+
+    v2 += (gravity + recovery + wind) * dt;
+
+    /* Collisions of the tip and of the curve midpoint */
+    for (int i = 0; i < uColliderCount && i < MAX_COLLIDERS; i++)
+    {
+        vec3 m = 0.25 * v0 + 0.5 * v1 + 0.25 * v2;
+        vec3 push = collide(v2, i) + 4.0 * collide(m, i);
+        v2 += push;
+        collision += length(push);
+    }
+    collision = clamp(collision - uCollisionDecay * dt, 0.0, 1.0);
+
+    /* Validation - keep v2 above the ground, place v1 and restore the blade length */
+    v2 -= up * min(dot(up, v2 - v0), 0.0);
+    float projectedLength = length(v2 - v0 - up * dot(v2 - v0, up));
+    v1 = v0 + height * up * max(1.0 - projectedLength / height, 0.05 * max(projectedLength / height, 1.0));
+
+    float l0 = length(v2 - v0);
+    float l1 = length(v2 - v1) + length(v1 - v0);
+    float ratio = height / ((2.0 * l0 + l1) / 3.0);   // curve length estimate for degree 2
+    vec3 v1Corrected = v0 + ratio * (v1 - v0);
+    v2 = v1Corrected + ratio * (v2 - v1);
+    v1 = v1Corrected;
+
+    bladeStates[index] = BladeState(vec4(v1, 0.0), vec4(v2, collision));
+}
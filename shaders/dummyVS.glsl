@@ -2,7 +2,7 @@
 
 layout(location = 0) in vec4 position;
 layout(location = 1) in vec2 texCoord;
-uniform mat4 uMVP;
+#include "frameUniforms.glsl"
 out vec2 vTexCoord;
 
 void main()
@@ -0,0 +1,26 @@
+/* Per-frame data shared by all programs, mirrors OpenGLWindow::FrameUniforms (std140) */
+layout(std140, binding=0) uniform FrameUniforms
+{
+    mat4  uMVP;
+    mat4  uSkyboxMVP;
+    vec4  uFrustumPlanes[6];
+    vec3  uCameraPos;
+    float uMaxDistance;
+    vec3  uLightPos;
+    float uMaxTerrainHeight;
+    vec3  uLightColor;
+    float uMaxBendingFactor;
+    vec3  uWindParams;
+    float uFieldSize;
+    float uTerrainWidth;
+    float uTerrainHeight;
+    int   uTime;
+    int   uMaxTessLevel;
+    int   uWindEnabled;
+    int   uLightingEnabled;
+    int   uSimulationEnabled;
+    int   uOverdrawView;
+};
+
+/* Added per fragment with additive blending in the overdraw view - 8 layers saturate red, 16 green, 32 blue */
+const vec4 OVERDRAW_COLOR = vec4(1.0 / 8.0, 1.0 / 16.0, 1.0 / 32.0, 1.0);
@@ -0,0 +1,204 @@
+/* Blade data and per-vertex blade placement shared by all grass paths (tessellated and low-poly) */
+
+#define M_PI 3.1415926535897932384626433832795
+
+layout(binding=1) uniform sampler2D uHeightMap;
+
+layout(std430, binding=0) buffer patchTranslationsBuffer
+{
+    mat4 patchTranslations[];
+};
+layout(std430, binding=1) buffer patchRandomsBuffer
+{
+    int patchRandoms[];
+};
+
+struct Blade
+{
+    vec4 placement;   // x offset, z offset, width, height
+    vec4 randoms0;    // r0 (angle), r1, r2, r3
+    vec4 randoms1;    // r4, r5, r6, r7
+};
+layout(std430, binding=2) buffer grassBladesBuffer
+{
+    Blade grassBlades[];
+};
+layout(std430, binding=3) buffer visiblePatchesBuffer
+{
+    int visiblePatches[];
+};
+
+/* Explicit locations - the color and depth-only variants of a grass program share them (uVertexCapacity 1, uSegmentCount 2, uCardSize 3) */
+layout(location = 0) uniform int uPatchListOffset;  // start of this draw's patch list in visiblePatches
+
+#include "bladeSimulation.glsl"
+
+struct BladeVertex
+{
+    vec4 position;
+    vec4 centerPosition;
+    vec4 texCoord;
+    vec4 randoms;
+    vec3 root;          // blade center on the terrain, same for all corners
+    vec3 normal;        // facing of the flat blade
+    vec3 width;         // left edge to right edge (bottom right - bottom left), the same at every height
+    int  discardBlade;
+};
+
+/* Wind function */
+float w(vec3 p)
+{
+   float c1 = uWindParams.x;
+   float c2 = 2.0;
+   float c3 = uWindParams.y;
+   float timeScale = (1 - uWindParams.z) * 500 + 1500;  // z = 0 -> slow, z = 1 -> fast
+   float a = M_PI * p.x + 10.0 * (uWindParams.z + 1.0) + (M_PI / 4) / (abs(cos(c2 * M_PI * p.z)) + 0.00001);
+   return sin(c1 * a) * cos(c3 * a);
+}
+
+/* Taken from https://stackoverflow.com/questions/61998702/opengl-es-2-0-rotate-point-around-pivot-point-2d-vertex-shader */
+vec2 rotate(vec2 point, float degree, vec2 pivot)
+{
+    float radAngle = radians(degree);
+    float x = point.x;
+    float y = point.y;
+
+    float rX = pivot.x + (x - pivot.x) * cos(radAngle) - (y - pivot.y) * sin(radAngle);
+    float rY = pivot.y + (x - pivot.x) * sin(radAngle) + (y - pivot.y) * cos(radAngle);
+
+    return vec2(rX, rY);
+}
+
+/*
+   corner: 0 - bottom left, 1 - bottom right, 2 - top right, 3 - top left
+   animate: false gives the rest pose (no wind, no simulated tip)
+*/
+BladeVertex computeBladeVertex(int patchIndex, int bladeIndex, Blade blade, int corner, bool animate)
+{
+   BladeVertex result;
+
+   /* Reconstruct blade corner from per-blade data */
+   float s = (corner == 1 || corner == 2) ? 1.0 : 0.0;
+   float t = (corner >= 2) ? 1.0 : 0.0;
+
+   vec4 position       = vec4(blade.placement.x + (s - 0.5) * blade.placement.z, t * blade.placement.w, blade.placement.y, blade.randoms0.x);
+   vec4 centerPosition = vec4(blade.placement.x, t, blade.placement.y, blade.randoms0.y);
+   vec4 texCoord       = vec4(s, t, blade.randoms0.z, blade.randoms0.w);
+   vec4 randoms        = blade.randoms1;
+
+   result.discardBlade = 0;
+   result.width = vec3(0.0);
+   vec2 rotation;
+   float newX = position.x;
+   float newY = position.y;
+   float newZ = position.z;
+   float centerNewX = centerPosition.x;
+   float centerNewY = centerPosition.y;
+   float centerNewZ = centerPosition.z;
+   float facing = (patchRandoms[patchIndex] % 4) * 90;
+
+   /* Rotate patch */
+   rotation = rotate(vec2(newX, newZ), (patchRandoms[patchIndex] % 4) * 90, vec2(0.0, 0.0));
+   newX = rotation.x;
+   newZ = rotation.y;
+   rotation = rotate(vec2(centerNewX, centerNewZ), (patchRandoms[patchIndex] % 4) * 90, vec2(0.0, 0.0));
+   centerNewX = rotation.x;
+   centerNewZ = rotation.y;
+   
+   /* Calculate world space position */
+   float patchX = patchTranslations[patchIndex][3][0];
+   float patchY = patchTranslations[patchIndex][3][1];
+   float patchZ = patchTranslations[patchIndex][3][2];
+   vec3 worldPos       = vec3(patchX + newX, patchY + newY, patchZ + newZ);
+   vec3 centerWorldPos = vec3(patchX + centerNewX, patchY + centerNewY, patchZ + centerNewZ);
+
+   /* Calculate height map coordinates */
+   float x =      (centerWorldPos.x + uFieldSize/2) / uFieldSize;    // normalize x (possitive x is pointing away from us)
+   float z = 1 - ((centerWorldPos.z + uFieldSize/2) / uFieldSize);   // normalize z (possitive z is pointing towards us)
+   x = clamp(x, 0.01, 0.99);
+   z = clamp(z, 0.01, 0.99);
+   vec2 mapCoords = vec2(x, z);
+   vec4 heightSample = texture(uHeightMap, mapCoords);
+
+   float terrainHeight = mix(0.0, uMaxTerrainHeight, 1 - heightSample.b);
+   result.root = vec3(centerWorldPos.x, patchY + terrainHeight, centerWorldPos.z);
+
+   /* Discard blades based on density */
+   float d = abs(centerPosition.w) + (1 - heightSample.r);
+   if (d > 1)
+      result.discardBlade = 1;
+   else
+   {
+      float r0 = position.w;
+      float r1 = centerPosition.w;
+      float r2 = texCoord.z;
+      facing += r0;
+
+      /* Rotate blades around center */
+      rotation = rotate(vec2(newX, newZ), r0, vec2(centerNewX, centerNewZ));
+      newX = rotation.x;
+      newZ = rotation.y;
+
+      /* New height sampled from height map */
+      newY = newY + terrainHeight;
+
+      /* Scale blade dimensions based on sampled height */
+      if (heightSample.g > 0.1)
+      {
+         newX = newX + (centerNewX - newX) * (1 - heightSample.g);
+         newZ = newZ + (centerNewZ - newZ) * (1 - heightSample.g);
+         if (centerNewY > 0.99f) // upper vertices
+            newY = newY - ((1 - heightSample.g) * (newY - terrainHeight));
+
+         /* Rotated and scaled like the corners, the bending and wind offsets below are shared by both edges */
+         result.width = heightSample.g * blade.placement.z * vec3(cos(radians(facing)), 0.0, sin(radians(facing)));
+      }
+      else
+         result.discardBlade = 1;
+
+      /* Upper vertex starting offset */
+      if (centerNewY > 0.99f)
+      {
+         // scale offset based on height (heightSample.g)
+         newX = newX + heightSample.g * ((uMaxBendingFactor * (2 * r1) - 1.0));
+         newZ = newZ + heightSample.g * ((uMaxBendingFactor * (2 * r2) - 1.0));
+      }
+
+      /* Wind calculation */
+      if (animate && (centerPosition.y > 0.99f) && (uWindEnabled == 1) && (uSimulationEnabled == 0)) // upper vertices
+      {
+         /* Inspired by Horizon Zero Dawn GDC presentation */
+         newX = newX + heightSample.g * ((1.0 * sin (0.03 * (centerWorldPos.x + centerWorldPos.y + centerWorldPos.z + uTime/30 ))) + 1.0);
+         newZ = newZ + heightSample.g * ((0.5 * sin (0.03 * (centerWorldPos.x + centerWorldPos.y + centerWorldPos.z + uTime/100))) + 0.5);
+         newX = newX + heightSample.g * w(vec3(centerWorldPos.x, newY, centerWorldPos.z));
+         newZ = newZ + heightSample.g * w(vec3(centerWorldPos.x, newY, centerWorldPos.z));
+      }
+
+      /* Simulated tip (bladeSimulationCS) replaces the analytic wind */
+      if (animate && (centerPosition.y > 0.99f) && (uSimulationEnabled == 1))
+      {
+         int stateIndex = patchIndex * grassBlades.length() + bladeIndex;
+         vec3 offset = bladeStates[stateIndex].v2.xyz - bladeRest[stateIndex].tip.xyz;
+         newX = newX + offset.x;
+         newY = newY + offset.y;
+         newZ = newZ + offset.z;
+      }
+   }
+
+   /* Width direction of the blade is (cos, sin) of the accumulated rotation, the normal is perpendicular to it */
+   result.normal = vec3(-sin(radians(facing)), 0.0, cos(radians(facing)));
+
+   result.position          = patchTranslations[patchIndex] * vec4(newX, newY, newZ, 1.0f); // move the patch
+   result.centerPosition    = patchTranslations[patchIndex] * vec4(centerNewX, 1.0f, centerNewZ, 1.0f);
+   result.centerPosition.y  = newY;  // update center's y coordinate with actual height
+   result.centerPosition.w  = centerPosition.w;
+   result.texCoord          = texCoord;
+   result.randoms           = randoms;
+
+   return result;
+}
+
+BladeVertex computeBladeVertex(int patchIndex, int bladeIndex, int corner)
+{
+   return computeBladeVertex(patchIndex, bladeIndex, grassBlades[bladeIndex], corner, true);
+}
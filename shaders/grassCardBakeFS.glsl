@@ -0,0 +1,21 @@
+#version 450 core
+
+layout(binding=0) uniform sampler2D uAlphaTexture;
+
+in vec2 bTexCoord;
+in vec4 bRandoms;
+out vec4 color;
+
+void main()
+{
+    vec4 texColor = texture(uAlphaTexture, bTexCoord);
+    if (texColor.a < 0.1)
+        discard;
+
+    /* Same gradient as grassFS.glsl */
+    vec4 top    = vec4(0.086, 0.837, 0.388, 1.0);
+    vec4 bottom = vec4(0.086, 0.288, 0.213, 1.0);
+
+    color = vec4(mix(bottom, top, bTexCoord.t));
+    color = vec4(color.r + bRandoms.y, color.g + bRandoms.z, color.b + bRandoms.w, 1.0);
+}
\ No newline at end of file
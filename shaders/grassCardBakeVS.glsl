@@ -0,0 +1,31 @@
+#version 450 core
+
+/* Renders one patch of blades from the side into the far LOD grass card texture */
+
+out vec2 bTexCoord;
+out vec4 bRandoms;
+
+#include "frameUniforms.glsl"
+#include "grassBlade.glsl"
+
+uniform mat4 uBakeProjection;
+uniform float uBakeBendingFactor;
+
+const int triangleCorners[6] = int[](0, 1, 2, 0, 2, 3);
+
+void main()
+{
+   Blade blade = grassBlades[gl_VertexID / 6];
+   int corner = triangleCorners[gl_VertexID % 6];
+   float s = (corner == 1 || corner == 2) ? 1.0 : 0.0;
+   float t = (corner >= 2) ? 1.0 : 0.0;
+
+   /* Width as seen from the side depends on the blade rotation, tips lean by the random bending offset */
+   float width = blade.placement.z * max(abs(cos(radians(blade.randoms0.x))), 0.2);
+   vec3 position = vec3(blade.placement.x + (s - 0.5) * width, t * blade.placement.w, blade.placement.y);
+   position.x += t * uBakeBendingFactor * (2.0 * blade.randoms0.y - 1.0);
+
+   gl_Position = uBakeProjection * vec4(position, 1.0);
+   bTexCoord   = vec2(s, t);
+   bRandoms    = blade.randoms1;
+}
\ No newline at end of file
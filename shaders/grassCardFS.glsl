@@ -0,0 +1,19 @@
+#version 450 core
+
+#include "frameUniforms.glsl"
+
+layout(binding=0) uniform sampler2D uCardTexture;
+
+in vec2 cTexCoord;
+out vec4 color;
+
+void main()
+{
+    vec4 texColor = texture(uCardTexture, cTexCoord);
+    if (texColor.a < 0.5)
+        discard;
+
+#ifndef DEPTH_ONLY
+    color = uOverdrawView == 1 ? OVERDRAW_COLOR : vec4(texColor.rgb, 1.0);
+#endif
+}
\ No newline at end of file
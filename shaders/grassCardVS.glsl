@@ -0,0 +1,43 @@
+#version 450 core
+
+/* Far LOD tier - two crossed grass cards per patch textured with the baked patch */
+
+out vec2 cTexCoord;
+invariant gl_Position;
+
+#include "frameUniforms.glsl"
+#include "grassBlade.glsl"
+
+layout(location = 3) uniform vec2 uCardSize;  // width and height of a card
+
+const int triangleCorners[6] = int[](0, 1, 2, 0, 2, 3);
+
+void main()
+{
+   int patchIndex = visiblePatches[uPatchListOffset + gl_InstanceID];
+   int card   = gl_VertexID / 6;
+   int corner = triangleCorners[gl_VertexID % 6];
+   float s = (corner == 1 || corner == 2) ? 1.0 : 0.0;
+   float t = (corner >= 2) ? 1.0 : 0.0;
+
+   /* Terrain height and blade height at the patch center, same mapping as grassBlade.glsl */
+   vec3 center = patchTranslations[patchIndex][3].xyz;
+   float x =      (center.x + uFieldSize/2) / uFieldSize;
+   float z = 1 - ((center.z + uFieldSize/2) / uFieldSize);
+   vec4 heightSample = texture(uHeightMap, clamp(vec2(x, z), 0.01, 0.99));
+
+   if (heightSample.g <= 0.1 || heightSample.r <= 0.0)
+   {
+      gl_Position = vec4(2.0, 2.0, 2.0, 1.0);   // no grass here
+      return;
+   }
+
+   float terrainHeight = mix(0.0, uMaxTerrainHeight, 1 - heightSample.b);
+   float angle = (patchRandoms[patchIndex] % 4) * 90 + card * 90;
+   vec2 offset = rotate(vec2((s - 0.5) * uCardSize.x, 0.0), angle, vec2(0.0, 0.0));
+
+   vec3 position = vec3(center.x + offset.x, center.y + terrainHeight + t * uCardSize.y * heightSample.g, center.z + offset.y);
+   gl_Position = uMVP * vec4(position, 1.0);
+
+   cTexCoord = vec2(card == 0 ? s : 1.0 - s, t);
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#version 450 core
+
+/*
+    Near LOD tier without hardware tessellation - evaluates the blade curve of grassTES for every blade
+    of the visible patches and appends one triangle strip per blade to expandedVertices. Strips are joined
+    by degenerate triangles, so the whole tier is a single GL_TRIANGLE_STRIP draw.
+    Work group x - patch in the list, y - chunk of 64 blades. The x count is capped at GL_MAX_COMPUTE_WORK_GROUP_COUNT,
+    work groups past the cap are folded back onto the existing ones.
+*/
+
+layout(local_size_x = 64) in;
+
+struct DrawArraysIndirectCommand
+{
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+};
+
+layout(std430, binding=4) buffer grassDrawCommandBuffer
+{
+    DrawArraysIndirectCommand grassDrawCommands[3];     // only the near tier patch count (instanceCount) is read
+};
+layout(std430, binding=5) buffer expandedDrawCommandBuffer
+{
+    DrawArraysIndirectCommand expandedDrawCommand;
+};
+
+#include "frameUniforms.glsl"
+#include "grassBlade.glsl"
+#include "grassSpline.glsl"
+#include "grassExpanded.glsl"
+
+uniform int uBladeCount;
+uniform int uPatchListCount;      // patches in the list, -1 - the near tier count of grassDrawCommands (GPU culling)
+
+shared uint groupVertexCount;
+shared uint groupFirstVertex;
+
+void writeVertex(uint index, vec3 position, vec3 normal, vec2 texCoord, int bladeIndex)
+{
+    if (index < uVertexCapacity)
+        expandedVertices[index] = ExpandedVertex(position, packUnorm2x16(texCoord), normal, bladeIndex);
+}
+
+void expandPatch(int patchIndex)
+{
+    int bladeIndex = int(gl_WorkGroupID.y * gl_WorkGroupSize.x + gl_LocalInvocationID.x);
+
+    if (gl_LocalInvocationIndex == 0)
+        groupVertexCount = 0;
+    barrier();
+
+    /* Same corners as grassVS and same blade rejection as grassTCS */
+    BladeVertex corners[4];
+    int level = 0;
+    if (bladeIndex < uBladeCount)
+    {
+        for (int corner = 0; corner < 4; corner++)
+            corners[corner] = computeBladeVertex(patchIndex, bladeIndex, corner);
+        level = max(int(calculateTessellationLevel(corners[0].position, corners[0].centerPosition.w, corners[0].discardBlade)), 0);
+    }
+
+    /* Left and right vertex per tessellated row, plus a duplicated first and last vertex for the joins */
+    uint vertexCount = level > 0 ? 2 * (level + 1) + 2 : 0;
+    uint localOffset = atomicAdd(groupVertexCount, vertexCount);
+    barrier();
+
+    /* One global allocation per work group */
+    if (gl_LocalInvocationIndex == 0)
+        groupFirstVertex = atomicAdd(expandedDrawCommand.count, groupVertexCount);
+    barrier();
+
+    if (level == 0)
+        return;
+
+    vec3 leftControlPoint  = calculateControlPoint(corners[3].position, corners[0].position, corners[0].texCoord.w, corners[0].randoms.x);
+    vec3 rightControlPoint = calculateControlPoint(corners[2].position, corners[1].position, corners[0].texCoord.w, corners[0].randoms.x);
+    uint first = groupFirstVertex + localOffset;
+
+    /* Rows of the quad domain at the TES tessellation coordinates v = i / level, the edges are at u = 0 and u = 1 */
+    for (int i = 0; i <= level; i++)
+    {
+        float v = float(i) / float(level);
+        Spline leftSpline  = calculateSplinePosition(corners[0].position.xyz, leftControlPoint, corners[3].position.xyz, v);
+        Spline rightSpline = calculateSplinePosition(corners[1].position.xyz, rightControlPoint, corners[2].position.xyz, v);
+
+        vec3 bitangent   = rightSpline.position - leftSpline.position;
+        vec3 leftNormal  = normalize(cross(leftSpline.tangent, bitangent));
+        vec3 rightNormal = normalize(cross(rightSpline.tangent, bitangent));
+
+        if (i == 0)
+            writeVertex(first, leftSpline.position, leftNormal, vec2(0.0, v), bladeIndex);
+        writeVertex(first + 1 + 2 * i, leftSpline.position, leftNormal, vec2(0.0, v), bladeIndex);
+        writeVertex(first + 2 + 2 * i, rightSpline.position, rightNormal, vec2(1.0, v), bladeIndex);
+        if (i == level)
+            writeVertex(first + 3 + 2 * i, rightSpline.position, rightNormal, vec2(1.0, v), bladeIndex);
+    }
+}
+
+void main()
+{
+    uint patchCount = uPatchListCount < 0 ? grassDrawCommands[0].instanceCount : uint(uPatchListCount);
+    for (uint i = gl_WorkGroupID.x; i < patchCount; i += gl_NumWorkGroups.x)
+        expandPatch(visiblePatches[uPatchListOffset + int(i)]);
+}
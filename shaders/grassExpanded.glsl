@@ -0,0 +1,15 @@
+/* Blade strips written by grassExpandCS and drawn by grassExpandedVS */
+
+struct ExpandedVertex
+{
+    vec3 position;
+    uint texCoord;      // packUnorm2x16
+    vec3 normal;
+    int  bladeIndex;
+};
+layout(std430, binding=6) buffer expandedVerticesBuffer
+{
+    ExpandedVertex expandedVertices[];
+};
+
+layout(location = 1) uniform uint uVertexCapacity;  // vertices past the capacity are not written (buffer full)
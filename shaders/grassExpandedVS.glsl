@@ -0,0 +1,25 @@
+#version 450 core
+
+/* Near LOD tier strips expanded by grassExpandCS.glsl, shades with grassFS */
+
+out vec3 tePosition;
+out vec4 teTexCoord;
+out vec4 teRandoms;
+out vec3 teNormal;
+invariant gl_Position;
+
+#include "frameUniforms.glsl"
+#include "grassBlade.glsl"
+#include "grassExpanded.glsl"
+
+void main()
+{
+   /* The draw count is not clamped to the capacity - repeating the last vertex makes the remaining triangles degenerate */
+   ExpandedVertex vertex = expandedVertices[min(gl_VertexID, int(uVertexCapacity) - 1)];
+   gl_Position = uMVP * vec4(vertex.position, 1.0);
+
+   tePosition = vertex.position;
+   teTexCoord = vec4(unpackUnorm2x16(vertex.texCoord), 0.0, 0.0);
+   teRandoms  = grassBlades[vertex.bladeIndex].randoms1;
+   teNormal   = vertex.normal;
+}
@@ -1,10 +1,8 @@
 #version 450 core
 
-uniform sampler2D uAlphaTexture;
-uniform int uLightingEnabled;
-uniform vec3 uLightPos;
-uniform vec3 uLightColor;
-uniform vec3 uCameraPos;
+#include "frameUniforms.glsl"
+
+layout(binding=0) uniform sampler2D uAlphaTexture;
 
 in vec3 tePosition;
 in vec4 teTexCoord;
@@ -17,6 +15,9 @@ void main()
     vec4 texColor = texture(uAlphaTexture, teTexCoord.st);
     if(texColor.a < 0.1)
         discard;
+#ifndef DEPTH_ONLY      // pre-pass variant - only the alpha test, color writes are masked
+    else if (uOverdrawView == 1)
+        color = OVERDRAW_COLOR;
     else
     {
         vec4 top    = vec4(0.086, 0.837, 0.388, 1.0);
@@ -40,4 +41,5 @@ void main()
             color = vec4(result, 1.0);
         }
     }
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 450 core
+
+/* Mid LOD tier - flat 2-triangle blades without tessellation, shades with grassFS */
+
+out vec3 tePosition;
+out vec4 teCenterPosition;
+out vec4 teTexCoord;
+out vec4 teRandoms;
+out vec3 teNormal;
+invariant gl_Position;
+
+#include "frameUniforms.glsl"
+#include "grassBlade.glsl"
+
+const int triangleCorners[6] = int[](0, 1, 2, 0, 2, 3);
+
+void main()
+{
+   /* 6 vertices per blade, one instance per patch */
+   int patchIndex = visiblePatches[uPatchListOffset + gl_InstanceID];
+   BladeVertex blade = computeBladeVertex(patchIndex, gl_VertexID / 6, triangleCorners[gl_VertexID % 6]);
+
+   /* Same blade rejection as grassTCS.glsl - decided per blade so all corners agree */
+   float cameraDistance = length(blade.root - uCameraPos);
+   float r = abs(blade.centerPosition.w) + (cameraDistance / uMaxDistance);
+   if (blade.discardBlade == 1 || r > 1)
+   {
+      gl_Position = vec4(2.0, 2.0, 2.0, 1.0);   // degenerate, outside the clip volume
+      return;
+   }
+
+   gl_Position = uMVP * vec4(blade.position.xyz, 1.0);
+
+   tePosition       = blade.position.xyz;
+   teCenterPosition = blade.centerPosition;
+   teTexCoord       = blade.texCoord;
+   teRandoms        = blade.randoms;
+   teNormal         = blade.normal;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+/* Blade curve shared by the tessellation path (grassTCS/grassTES) and the compute expansion path (grassExpandCS) */
+
+struct Spline
+{
+	vec3 position;
+	vec3 tangent;
+	vec3 a;
+};
+
+/**
+	De Casteljau's algorithm
+	pb - bottom vertex
+	pt - top vertex
+	h  - additional control point
+	v  - domain coordinate
+*/
+Spline calculateSplinePosition(vec3 pb, vec3 h, vec3 pt, float v)
+{
+	Spline result;
+	
+	vec3 a = pb + v * (h - pb);
+	vec3 b = h + v * (pt - h);
+
+	result.position = a + v * (b - a);
+	result.tangent  = (b - a) / length(b - a);
+	result.a 	    = a;
+
+	return result;
+}
+
+/* r3 = texCoord.w, r4 = randoms.x of the blade */
+vec3 calculateControlPoint(vec4 lower, vec4 upper, float r3, float r4)
+{
+	float x = lower.x * r3 + upper.x * (1.0 - r3);
+	float y = lower.y * r4 + upper.y * (1.0 - r4);
+	float z = lower.z * r3 + upper.z * (1.0 - r3);
+
+	return vec3(x, y, z);
+}
+
+/* Tessellation level of a blade, 0 culls it. position - bottom left corner, centerRandom - centerPosition.w */
+float calculateTessellationLevel(vec4 position, float centerRandom, int discardBlade)
+{
+    /* Calculate distance to camera */
+    float cameraDistance = length(position.xyz - uCameraPos);
+
+    /* Determine blade's tessellation level */
+    float tessellationLevel = ceil(uMaxTessLevel * (1 - (cameraDistance / uMaxDistance)));
+
+    /* Randomly discard blades based on distance */
+    float r = abs(centerRandom) + (cameraDistance / uMaxDistance);
+    if (r > 1)
+        tessellationLevel = 0;
+
+    /* Density */
+    if (discardBlade == 1)
+        tessellationLevel = 0;
+
+    return tessellationLevel;
+}
@@ -0,0 +1,68 @@
+#version 450 core
+
+/*
+    Near LOD tier without tessellation - a fixed-segment triangle strip per blade, shades with grassFS.
+    Blade and strip vertex are derived from gl_VertexID, one instance per patch. Strips are joined by
+    degenerate triangles (first and last vertex of every blade are duplicated).
+    BLADE_ATTRIBUTES - blade data comes from vertex attributes (replicated for every strip vertex)
+    instead of being pulled from the blade SSBO, to compare the two fetch paths.
+*/
+
+#ifdef BLADE_ATTRIBUTES
+layout(location=0) in vec4 aPlacement;
+layout(location=1) in vec4 aRandoms0;
+layout(location=2) in vec4 aRandoms1;
+#endif
+
+out vec3 tePosition;
+out vec4 teTexCoord;
+out vec4 teRandoms;
+out vec3 teNormal;
+invariant gl_Position;
+
+#include "frameUniforms.glsl"
+#include "grassBlade.glsl"
+#include "grassSpline.glsl"
+
+layout(location = 2) uniform int uSegmentCount;
+
+void main()
+{
+   int verticesPerBlade = 2 * (uSegmentCount + 1) + 2;
+   int bladeIndex = gl_VertexID / verticesPerBlade;
+   int stripVertex = clamp(gl_VertexID % verticesPerBlade - 1, 0, 2 * uSegmentCount + 1);
+   int row  = stripVertex / 2;
+   int side = stripVertex % 2;   // 0 - left edge, 1 - right edge
+
+   int patchIndex = visiblePatches[uPatchListOffset + gl_InstanceID];
+#ifdef BLADE_ATTRIBUTES
+   Blade blade = Blade(aPlacement, aRandoms0, aRandoms1);
+#else
+   Blade blade = grassBlades[bladeIndex];
+#endif
+
+   /* Only the left edge is evaluated - the right edge of the grassTES quad domain is the same curve
+      moved by the blade width, so two of the four corners are enough for either side */
+   BladeVertex bottom = computeBladeVertex(patchIndex, bladeIndex, blade, 0, true);
+   BladeVertex top    = computeBladeVertex(patchIndex, bladeIndex, blade, 3, true);
+
+   /* Same blade rejection as grassTCS, every vertex of a rejected blade collapses to one point */
+   if (calculateTessellationLevel(bottom.position, bottom.centerPosition.w, bottom.discardBlade) <= 0)
+   {
+      gl_Position = vec4(2.0, 2.0, 2.0, 1.0);   // degenerate, outside the clip volume
+      return;
+   }
+
+   /* Edge u = side at v = row / uSegmentCount */
+   vec3 controlPoint = calculateControlPoint(top.position, bottom.position, bottom.texCoord.w, bottom.randoms.x);
+   float v = float(row) / float(uSegmentCount);
+   Spline spline = calculateSplinePosition(bottom.position.xyz, controlPoint, top.position.xyz, v);
+   vec3 position = spline.position + float(side) * bottom.width;
+
+   gl_Position = uMVP * vec4(position, 1.0);
+
+   tePosition = position;
+   teTexCoord = vec4(float(side), v, 0.0, 0.0);
+   teRandoms  = bottom.randoms;
+   teNormal   = normalize(cross(spline.tangent, bottom.width));
+}
@@ -15,39 +15,12 @@ out vec4 tcTexCoord[];
 out vec4 tcRandoms[];
 patch out vec3 controlPoints[2];
 
-uniform int uMaxTessLevel;
-uniform float uMaxDistance;
-uniform vec3 uCameraPos;
-uniform mat4 uMVP;
-
-vec3 calculateControlPoint(vec4 lower, vec4 upper)
-{
-	float r3 = vTexCoord[0].w;   // r3
-	float r4 = vRandoms[0].x;    // r4
-
-	float x = lower.x * r3 + upper.x * (1.0 - r3);
-	float y = lower.y * r4 + upper.y * (1.0 - r4);
-	float z = lower.z * r3 + upper.z * (1.0 - r3);
-
-	return vec3(x, y, z);
-}
+#include "frameUniforms.glsl"
+#include "grassSpline.glsl"
 
 void main()
 {
-    /* Calculate distance to camera */
-    float cameraDistance = length(vPosition[0].xyz - uCameraPos);
-
-    /* Determine blade's tessellation level */
-    float tessellationLevel = ceil(uMaxTessLevel * (1 - (cameraDistance / uMaxDistance)));
-
-    /* Randomly discard blades based on distance */
-    float r = abs(vCenterPosition[0].w) + (cameraDistance / uMaxDistance);
-    if (r > 1)
-        tessellationLevel = 0;
-
-    /* Density */
-    if (vDiscardBlade[0] == 1)
-        tessellationLevel = 0;
+    float tessellationLevel = calculateTessellationLevel(vPosition[0], vCenterPosition[0].w, vDiscardBlade[0]);
 
     if (gl_InvocationID == 0)
     {
@@ -60,8 +33,8 @@ void main()
         gl_TessLevelInner[0] = tessellationLevel;   // top and bottom
         gl_TessLevelInner[1] = tessellationLevel;   // left and right
         
-		controlPoints[0] = calculateControlPoint(vPosition[3], vPosition[0]);
-		controlPoints[1] = calculateControlPoint(vPosition[2], vPosition[1]);
+		controlPoints[0] = calculateControlPoint(vPosition[3], vPosition[0], vTexCoord[0].w, vRandoms[0].x);
+		controlPoints[1] = calculateControlPoint(vPosition[2], vPosition[1], vTexCoord[0].w, vRandoms[0].x);
     }
 
     tcPosition[gl_InvocationID]       = vPosition[gl_InvocationID];
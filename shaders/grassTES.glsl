@@ -13,36 +13,10 @@ out vec4 teCenterPosition;
 out vec4 teTexCoord;
 out vec4 teRandoms;
 out vec3 teNormal;
+invariant gl_Position;    // the depth pre-pass and the color pass must produce the same depth
 
-uniform mat4 uMVP;
-
-struct Spline
-{
-	vec3 position;
-	vec3 tangent;
-	vec3 a;
-};
-
-/**
-	De Casteljau's algorithm
-	pb - bottom vertex
-	pt - top vertex
-	h  - additional control point
-	v  - domain coordinate
-*/
-Spline calculateSplinePosition(vec3 pb, vec3 h, vec3 pt, float v)
-{
-	Spline result;
-	
-	vec3 a = pb + v * (h - pb);
-	vec3 b = h + v * (pt - h);
-
-	result.position = a + v * (b - a);
-	result.tangent  = (b - a) / length(b - a);
-	result.a 	    = a;
-
-	return result;
-}
+#include "frameUniforms.glsl"
+#include "grassSpline.glsl"
 
 void main()
 {
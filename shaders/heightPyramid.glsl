@@ -0,0 +1,36 @@
+/* Min/max pyramid of the terrain height (1 - b of uHeightMap), mirrors HeightField - see OpenGLWindow::createHeightPyramidSSBO */
+const int MAX_PYRAMID_LEVELS = 16;
+
+layout(std430, binding=9) readonly buffer heightPyramidBuffer
+{
+    ivec4 pyramidLevels[MAX_PYRAMID_LEVELS];  // width, height, first tile
+    ivec4 pyramidInfo;                        // height map width, height, tile size of level 0, level count
+    vec2 pyramidTiles[];                      // min, max per tile
+};
+
+/* Height range 0 - 1 over a height map coords rectangle, same as HeightField::getHeightRange */
+vec2 heightRange(vec2 minCoords, vec2 maxCoords)
+{
+    ivec2 size = pyramidInfo.xy;
+    ivec2 texel0 = clamp(ivec2(floor(minCoords * size - 0.5)), ivec2(0), size - 1);
+    ivec2 texel1 = clamp(ivec2(floor(maxCoords * size - 0.5)) + 1, ivec2(0), size - 1);
+
+    /* Tiles at least as large as the texel span - the span touches at most 2 x 2 of them */
+    int span = max(texel1.x - texel0.x, texel1.y - texel0.y) + 1;
+    int level = 0;
+    while ((pyramidInfo.z << level) < span && level < pyramidInfo.w - 1)
+        level++;
+
+    int tileSize = pyramidInfo.z << level;
+    ivec4 tiles = pyramidLevels[level];
+    vec2 range = vec2(1.0, 0.0);
+    for (int y = texel0.y / tileSize; y <= texel1.y / tileSize; y++)
+    {
+        for (int x = texel0.x / tileSize; x <= texel1.x / tileSize; x++)
+        {
+            vec2 tile = pyramidTiles[tiles.z + y * tiles.x + x];
+            range = vec2(min(range.x, tile.x), max(range.y, tile.y));
+        }
+    }
+    return range;
+}
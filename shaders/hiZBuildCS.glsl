@@ -0,0 +1,41 @@
+#version 450 core
+
+/*
+    One level of the hierarchical-Z pyramid - level 0 copies the depth buffer, every further level keeps
+    the farthest depth of the texels it covers (3 wide at odd edges), so a box behind the stored depth
+    is hidden in the whole footprint. Work group - 8 x 8 texels of the target level
+*/
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D uDepth;                   // depth buffer copy, level 0 only
+layout(r32f, binding = 0) readonly uniform image2D uSourceLevel;
+layout(r32f, binding = 1) writeonly uniform image2D uTargetLevel;
+
+uniform int uLevel;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(uTargetLevel);
+    if (texel.x >= size.x || texel.y >= size.y)
+        return;
+
+    if (uLevel == 0)
+    {
+        imageStore(uTargetLevel, texel, vec4(texelFetch(uDepth, texel, 0).r));
+        return;
+    }
+
+    /* Mip sizes round down - the last texel of an odd row or column also covers the remaining source texel */
+    ivec2 sourceSize = imageSize(uSourceLevel);
+    ivec2 first = texel * 2;
+    ivec2 last = min(first + 1 + ivec2(equal(first + 3, sourceSize)), sourceSize - 1);
+
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++)
+        for (int x = first.x; x <= last.x; x++)
+            depth = max(depth, imageLoad(uSourceLevel, ivec2(x, y)).r);
+
+    imageStore(uTargetLevel, texel, vec4(depth));
+}
@@ -0,0 +1,137 @@
+#version 450 core
+
+layout(local_size_x = 64) in;
+
+struct DrawArraysIndirectCommand
+{
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+};
+
+layout(std430, binding=0) buffer patchTranslationsBuffer
+{
+    mat4 patchTranslations[];
+};
+layout(std430, binding=3) buffer visiblePatchesBuffer
+{
+    int visiblePatches[];
+};
+layout(std430, binding=4) buffer drawCommandBuffer
+{
+    DrawArraysIndirectCommand drawCommands[3];   // near, mid, far LOD tier
+    uint expandDispatch[3];                      // near tier patches (at most uExpandGroupLimit) x blade chunks, for grassExpandCS
+    uint occlusionStats[2];                      // patches tested against the Hi-Z, occluded
+};
+
+#include "frameUniforms.glsl"
+#include "heightPyramid.glsl"
+
+uniform vec2 uPatchHalfExtent;    // x and z half extent of patch bounds (including blade reach)
+uniform float uPatchHalfSize;     // half of the patch square the blade roots lie in
+uniform float uBladeHeight;       // max. blade height above its root
+uniform int uPatchCount;
+uniform vec2 uLodDistances;       // near and mid tier end, patch list of tier t starts at t * uPatchCount
+uniform bool uOcclusionCulling;
+uniform int uHiZLevelCount;
+uniform uint uExpandGroupLimit;   // GL_MAX_COMPUTE_WORK_GROUP_COUNT x
+
+layout(binding = 2) uniform sampler2D uHiZ;     // farthest terrain depth per texel, see hiZBuildCS.glsl
+
+bool isBoxVisible(vec3 boxMin, vec3 boxMax)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        vec4 plane = uFrustumPlanes[i];
+        vec3 positive = mix(boxMin, boxMax, greaterThan(plane.xyz, vec3(0.0)));
+        if (dot(plane.xyz, positive) + plane.w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+/* The box is hidden if its nearest depth lies behind the farthest depth of the Hi-Z texels under its screen rectangle */
+bool isBoxOccluded(vec3 boxMin, vec3 boxMax)
+{
+    vec2 screenMin = vec2(1.0);
+    vec2 screenMax = vec2(0.0);
+    float nearestDepth = 1.0;
+    for (int i = 0; i < 8; i++)
+    {
+        vec4 clip = uMVP * vec4(mix(boxMin, boxMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1)), 1.0);
+        if (clip.w <= 0.0 || clip.z < -clip.w)
+            return false;   // crosses the near plane
+
+        vec3 ndc = clip.xyz / clip.w;
+        screenMin = min(screenMin, ndc.xy * 0.5 + 0.5);
+        screenMax = max(screenMax, ndc.xy * 0.5 + 0.5);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+    }
+
+    ivec2 size = textureSize(uHiZ, 0);
+    ivec2 pixel0 = clamp(ivec2(screenMin * size), ivec2(0), size - 1);
+    ivec2 pixel1 = clamp(ivec2(screenMax * size), ivec2(0), size - 1);
+
+    /* Texels at least as large as the rectangle - it touches at most 2 x 2 of them */
+    int span = max(pixel1.x - pixel0.x, pixel1.y - pixel0.y) + 1;
+    int level = 0;
+    while ((1 << level) < span && level < uHiZLevelCount - 1)
+        level++;
+
+    ivec2 levelSize = textureSize(uHiZ, level);
+    ivec2 texel0 = min(pixel0 >> level, levelSize - 1);
+    ivec2 texel1 = min(pixel1 >> level, levelSize - 1);
+    float farthestDepth = 0.0;
+    for (int y = texel0.y; y <= texel1.y; y++)
+        for (int x = texel0.x; x <= texel1.x; x++)
+            farthestDepth = max(farthestDepth, texelFetch(uHiZ, ivec2(x, y), level).r);
+
+    return nearestDepth > farthestDepth;
+}
+
+void main()
+{
+    int patchIndex = int(gl_GlobalInvocationID.x);
+    if (patchIndex >= uPatchCount)
+        return;
+
+    /* Patch bounds, same as GrassField::getPatchBounds - terrain heights under the patch square (mapped over the field
+       like grassBlade.glsl) up to the blade height above them */
+    vec3 center = patchTranslations[patchIndex][3].xyz;
+    vec2 coords0 = vec2(center.x - uPatchHalfSize + uFieldSize / 2, center.z + uPatchHalfSize + uFieldSize / 2) / uFieldSize;
+    vec2 coords1 = vec2(center.x + uPatchHalfSize + uFieldSize / 2, center.z - uPatchHalfSize + uFieldSize / 2) / uFieldSize;
+    coords0 = clamp(vec2(coords0.x, 1 - coords0.y), 0.01, 0.99);
+    coords1 = clamp(vec2(coords1.x, 1 - coords1.y), 0.01, 0.99);
+    vec2 heights = uMaxTerrainHeight * heightRange(coords0, coords1) + vec2(0.0, uBladeHeight);
+
+    vec3 boxMin = vec3(center.x - uPatchHalfExtent.x, heights.x, center.z - uPatchHalfExtent.y);
+    vec3 boxMax = vec3(center.x + uPatchHalfExtent.x, heights.y, center.z + uPatchHalfExtent.y);
+
+    /* Distance culling, every blade further than uMaxDistance is discarded in the TCS */
+    vec3 nearest = clamp(uCameraPos, boxMin, boxMax);
+    float distance = length(nearest - uCameraPos);
+    if (distance > uMaxDistance)
+        return;
+
+    if (!isBoxVisible(boxMin, boxMax))
+        return;
+
+    if (uOcclusionCulling)
+    {
+        atomicAdd(occlusionStats[0], 1u);
+        if (isBoxOccluded(boxMin, boxMax))
+        {
+            atomicAdd(occlusionStats[1], 1u);
+            return;
+        }
+    }
+
+    /* LOD tier from the distance to the bounds, same as OpenGLWindow::assignLodTiers */
+    int tier = distance < uLodDistances.x ? 0 : (distance < uLodDistances.y ? 1 : 2);
+
+    uint slot = atomicAdd(drawCommands[tier].instanceCount, 1u);
+    visiblePatches[tier * uPatchCount + slot] = patchIndex;
+    if (tier == 0 && slot < uExpandGroupLimit)
+        atomicAdd(expandDispatch[0], 1u);
+}
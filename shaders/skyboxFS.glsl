@@ -4,7 +4,7 @@ in vec3 vTexCoord;
 
 out vec4 color;
 
-uniform samplerCube uSkybox;
+layout(binding=0) uniform samplerCube uSkybox;
 
 void main()
 {
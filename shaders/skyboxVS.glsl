@@ -4,10 +4,10 @@ layout(location = 0) in vec3 position;
 
 out vec3 vTexCoord;
 
-uniform mat4 uMVP;
+#include "frameUniforms.glsl"
 
 void main()
 {
     vTexCoord = position;
-    gl_Position = uMVP * vec4(position, 1.0);
+    gl_Position = uSkyboxMVP * vec4(position, 1.0);
 } 
\ No newline at end of file
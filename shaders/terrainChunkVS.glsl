@@ -0,0 +1,16 @@
+#version 450 core
+
+layout(location = 0) in vec2 localPosition;   // 16-bit normalized, 0 - 1 within the chunk
+layout(location = 1) in vec4 chunkBounds;     // per instance, the draw's baseInstance is the chunk - min xz, max xz
+
+#include "frameUniforms.glsl"
+
+layout(binding=0) uniform sampler2D uHeightMap;
+
+#include "terrainHeight.glsl"
+
+void main()
+{
+    vec2 position = mix(chunkBounds.xy, chunkBounds.zw, localPosition);
+    gl_Position = uMVP * vec4(position.x, terrainHeight(position), position.y, 1.0f);
+}
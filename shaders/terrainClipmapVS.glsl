@@ -0,0 +1,39 @@
+#version 450 core
+
+layout(location = 0) in vec2 position;    // vertex of the clipmap piece in level grid units
+
+#include "frameUniforms.glsl"
+
+layout(binding=0) uniform sampler2D uHeightMap;
+
+#include "terrainHeight.glsl"
+
+const int MAX_CLIPMAP_LEVELS    = 8;
+const int MAX_CLIPMAP_INSTANCES = 256;
+
+/* Mirrors TerrainClipmap::Uniforms */
+layout(std140, binding=1) uniform ClipmapUniforms
+{
+    vec4  uClipmapLevels[MAX_CLIPMAP_LEVELS];         // world xz of vertex (0, 0), spacing, last vertex index (0 - no border morphing)
+    ivec4 uClipmapInstances[MAX_CLIPMAP_INSTANCES];   // offset in level vertices, level
+};
+
+uniform int uInstanceOffset;
+
+void main()
+{
+    ivec4 instance = uClipmapInstances[uInstanceOffset + gl_InstanceID];
+    vec4 level = uClipmapLevels[instance.z];
+    ivec2 gridPosition = instance.xy + ivec2(position);
+    vec2 worldPosition = level.xy + vec2(gridPosition) * level.z;
+    float height = terrainHeight(worldPosition);
+
+    /* Odd vertices on the outer border lie on an edge of the coarser level - take its height so there are no cracks */
+    int last = int(level.w);
+    if (last > 0 && (gridPosition.x & 1) == 1 && (gridPosition.y == 0 || gridPosition.y == last))
+        height = 0.5 * (terrainHeight(worldPosition - vec2(level.z, 0.0)) + terrainHeight(worldPosition + vec2(level.z, 0.0)));
+    else if (last > 0 && (gridPosition.y & 1) == 1 && (gridPosition.x == 0 || gridPosition.x == last))
+        height = 0.5 * (terrainHeight(worldPosition - vec2(0.0, level.z)) + terrainHeight(worldPosition + vec2(0.0, level.z)));
+
+    gl_Position = uMVP * vec4(worldPosition.x, height, worldPosition.y, 1.0f);
+}
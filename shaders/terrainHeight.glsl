@@ -0,0 +1,11 @@
+/* Terrain height at a world xz position, needs uHeightMap and the FrameUniforms block */
+float terrainHeight(vec2 position)
+{
+    float x =      (position.x + uTerrainWidth  / 2) / uTerrainWidth;     // normalize x (possitive x is pointing away from us)
+    float z = 1 - ((position.y + uTerrainHeight / 2) / uTerrainHeight);   // normalize z (possitive z is pointing towards us)
+    x = clamp(x, 0.01, 0.99);
+    z = clamp(z, 0.01, 0.99);
+    vec2 mapCoords = vec2(x, z);
+    vec4 heightSample = texture(uHeightMap, mapCoords);
+    return 0.0f + mix(0.0, uMaxTerrainHeight, 1 - heightSample.b);
+}
@@ -0,0 +1,10 @@
+#version 450 core
+
+layout(location = 0) in vec2 position;
+
+out vec2 vPosition;
+
+void main()
+{
+    vPosition = position;
+}
@@ -0,0 +1,83 @@
+#version 450 core
+
+// terrain quad patch, corners counter-clockwise
+layout(vertices = 4) out;
+
+in vec2 vPosition[];
+
+out vec2 tcPosition[];
+
+#include "frameUniforms.glsl"
+
+layout(binding=0) uniform sampler2D uHeightMap;
+
+#include "terrainHeight.glsl"
+#include "heightPyramid.glsl"
+
+uniform float uProjectionScale;     // projection[1][1]
+uniform float uViewportHeight;      // pixels
+uniform float uTargetEdgeLength;    // pixels per generated edge
+uniform float uMaxEdgeLevel;
+
+vec3 cornerPosition(int i)
+{
+    return vec3(vPosition[i].x, terrainHeight(vPosition[i]), vPosition[i].y);
+}
+
+/* Projected length of the edge in target lengths. Depends only on the end points (in either order),
+   so both patches sharing the edge pick the same level and the edge has no cracks. */
+float edgeLevel(vec3 a, vec3 b)
+{
+    vec3 center = 0.5 * (a + b);
+    float distance = max(length(center - uCameraPos), 1e-3);
+    float pixels = length(a - b) * uProjectionScale * 0.5 * uViewportHeight / distance;
+    return clamp(pixels / uTargetEdgeLength, 1.0, uMaxEdgeLevel);
+}
+
+bool isBoxVisible(vec3 boxMin, vec3 boxMax)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        vec4 plane = uFrustumPlanes[i];
+        vec3 positive = mix(boxMin, boxMax, greaterThan(plane.xyz, vec3(0.0)));
+        if (dot(plane.xyz, positive) + plane.w < 0.0)
+            return false;
+    }
+    return true;
+}
+
+void main()
+{
+    tcPosition[gl_InvocationID] = vPosition[gl_InvocationID];
+
+    if (gl_InvocationID == 0)
+    {
+        vec3 p0 = cornerPosition(0);
+        vec3 p1 = cornerPosition(1);
+        vec3 p2 = cornerPosition(2);
+        vec3 p3 = cornerPosition(3);
+
+        // if any of the outer levels is zero, the patch is culled; the bounds are tight to the heights under the patch
+        vec2 xzMin = min(min(vPosition[0], vPosition[1]), min(vPosition[2], vPosition[3]));
+        vec2 xzMax = max(max(vPosition[0], vPosition[1]), max(vPosition[2], vPosition[3]));
+        vec2 coords0 = clamp(vec2((xzMin.x + uTerrainWidth / 2) / uTerrainWidth, 1 - (xzMax.y + uTerrainHeight / 2) / uTerrainHeight), 0.01, 0.99);
+        vec2 coords1 = clamp(vec2((xzMax.x + uTerrainWidth / 2) / uTerrainWidth, 1 - (xzMin.y + uTerrainHeight / 2) / uTerrainHeight), 0.01, 0.99);
+        vec2 heights = uMaxTerrainHeight * heightRange(coords0, coords1);
+        if (!isBoxVisible(vec3(xzMin.x, heights.x, xzMin.y), vec3(xzMax.x, heights.y, xzMax.y)))
+        {
+            gl_TessLevelOuter[0] = 0.0;
+            gl_TessLevelOuter[1] = 0.0;
+            gl_TessLevelOuter[2] = 0.0;
+            gl_TessLevelOuter[3] = 0.0;
+            return;
+        }
+
+        gl_TessLevelOuter[0] = edgeLevel(p0, p3);   // u = 0
+        gl_TessLevelOuter[1] = edgeLevel(p0, p1);   // v = 0
+        gl_TessLevelOuter[2] = edgeLevel(p1, p2);   // u = 1
+        gl_TessLevelOuter[3] = edgeLevel(p3, p2);   // v = 1
+
+        gl_TessLevelInner[0] = max(gl_TessLevelOuter[1], gl_TessLevelOuter[3]);
+        gl_TessLevelInner[1] = max(gl_TessLevelOuter[0], gl_TessLevelOuter[2]);
+    }
+}
@@ -0,0 +1,38 @@
+#version 450 core
+
+layout(quads, fractional_even_spacing, ccw) in;
+
+in vec2 tcPosition[];
+
+#include "frameUniforms.glsl"
+
+layout(binding=0) uniform sampler2D uHeightMap;
+
+#include "terrainHeight.glsl"
+
+/* Interpolated from the lexicographically smaller end point, so both patches sharing the edge compute the same position */
+vec2 edgePoint(vec2 a, vec2 b, float t)
+{
+    if (a.x > b.x || (a.x == b.x && a.y > b.y))
+        return b + (a - b) * (1.0 - t);
+    return a + (b - a) * t;
+}
+
+void main()
+{
+    vec2 uv = gl_TessCoord.xy;
+    vec2 position;
+
+    if (uv.x == 0.0)
+        position = edgePoint(tcPosition[0], tcPosition[3], uv.y);
+    else if (uv.x == 1.0)
+        position = edgePoint(tcPosition[1], tcPosition[2], uv.y);
+    else if (uv.y == 0.0)
+        position = edgePoint(tcPosition[0], tcPosition[1], uv.x);
+    else if (uv.y == 1.0)
+        position = edgePoint(tcPosition[3], tcPosition[2], uv.x);
+    else
+        position = mix(mix(tcPosition[0], tcPosition[1], uv.x), mix(tcPosition[3], tcPosition[2], uv.x), uv.y);
+
+    gl_Position = uMVP * vec4(position.x, terrainHeight(position), position.y, 1.0f);
+}
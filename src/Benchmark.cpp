@@ -0,0 +1,253 @@
+#include "Benchmark.hpp"
+
+void Benchmark::bladeGenerationScaling(int bladeCount)
+{
+	GrassField::BladeDimensions bladeDimensions{ 0.1, 0.3, 1.0, 5.0 };
+	const unsigned int seed = 1234;
+	int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::cout << "Blade generation scaling (" << bladeCount << " blades)" << std::endl;
+
+	/* Single patch field, all the work is in the blade generation */
+	GrassField reference(1.0f, 1.0f, bladeCount, bladeDimensions, seed, 1);
+	double singleThreadTime = reference.getGenerationTime();
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		GrassField field(1.0f, 1.0f, bladeCount, bladeDimensions, seed, threads);
+		bool same = identical(*field.getBladeStore(), *reference.getBladeStore());
+
+		std::cout << "  threads: " << threads
+				  << "  time: " << field.getGenerationTime() << " ms"
+				  << "  speedup: " << singleThreadTime / field.getGenerationTime()
+				  << "  identical: " << (same ? "yes" : "NO") << std::endl;
+
+		if (threads < maxThreads && threads * 2 > maxThreads)
+			threads = maxThreads / 2;	// always finish with all hardware threads
+	}
+	std::cout << std::endl;
+}
+
+
+void Benchmark::bladeGenerationKernels()
+{
+	BladeGenerator::Parameters parameters{ Random::key(1234), 8.0f, 0.1f, 0.3f, 1.0f, 5.0f };
+	GrassField::BladeDimensions bladeDimensions{ parameters.wMin, parameters.wMax, parameters.hMin, parameters.hMax };
+
+	std::cout << "Blade generation kernels (single thread, legacy per-blade loop vs. scalar SoA vs. " << BladeGenerator::getKernelName() << ")" << std::endl;
+
+	for (size_t bladeCount : { 100000, 1000000, 10000000 })
+	{
+		LegacyGeometry legacyGeometry;
+		BladeStore scalarStore, simdStore;
+		scalarStore.resize(bladeCount);
+		simdStore.resize(bladeCount);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		generateLegacy(bladeCount, bladeDimensions, parameters.patchSize, legacyGeometry);
+		auto legacyEnd = std::chrono::high_resolution_clock::now();
+		BladeGenerator::generateScalar(scalarStore, 0, bladeCount, parameters);
+		auto middle = std::chrono::high_resolution_clock::now();
+		BladeGenerator::generate(simdStore, 0, bladeCount, parameters);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double legacyTime = std::chrono::duration<double, std::milli>(legacyEnd - start).count();
+		double scalarTime = std::chrono::duration<double, std::milli>(middle - legacyEnd).count();
+		double simdTime   = std::chrono::duration<double, std::milli>(end - middle).count();
+
+		std::cout << "  blades: " << bladeCount
+				  << "  legacy: " << legacyTime << " ms"
+				  << "  scalar: " << scalarTime << " ms"
+				  << "  " << BladeGenerator::getKernelName() << ": " << simdTime << " ms"
+				  << "  speedup vs. legacy: " << legacyTime / simdTime
+				  << "  scalar/SIMD identical: " << (identical(scalarStore, simdStore) ? "yes" : "NO") << std::endl;
+	}
+	std::cout << std::endl;
+}
+
+void Benchmark::patchCulling()
+{
+	GrassField::BladeDimensions bladeDimensions{ 0.1, 0.3, 1.0, 5.0 };
+	const float patchSize = 1.0f;
+	const float maxDistance = 500.0f;
+	const float maxTerrainHeight = 30.0f;
+	const float maxBendingFactor = 0.3f;
+	const int iterations = 20;
+	HeightField heightField(QImage("../res/height_map.png").mirrored());
+
+	std::cout << "Patch culling (flat scan vs. quadtree, average of " << iterations << " runs)" << std::endl;
+
+	for (int patchesInRowOrCol : { 100, 316, 1000 })
+	{
+		float fieldSize = patchesInRowOrCol * patchSize;
+		GrassField field(fieldSize, patchSize, 1, bladeDimensions);
+
+		/* Camera at the edge of the field looking across it */
+		Camera camera(glm::vec3(0.0f, 50.0f, fieldSize / 2), 45, 16.0f / 9.0f, 0.1f, 1000.0f);
+		camera.rotateCamera(900.0f, -270.0f);
+		Frustum frustum(camera.getProjectionMatrix() * camera.getViewMatrix());
+
+		std::vector<int> visible(field.getPatchCount());
+		float padding = field.getPatchReach(maxBendingFactor);
+		int flatCount = 0, treeCount = 0;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+			flatCount = field.cullPatches(frustum, camera.getPosition(), maxDistance, maxTerrainHeight, maxBendingFactor, visible.data());
+		auto middle = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; i++)
+			treeCount = field.getPatchQuadtree()->cull(frustum, camera.getPosition(), maxDistance, padding, maxTerrainHeight, bladeDimensions.hMax,
+													   visible.data());
+		auto end = std::chrono::high_resolution_clock::now();
+
+		/* Same cull with patch heights from the height map pyramid instead of the whole terrain height */
+		field.setHeightField(heightField);
+		int tightCount = field.getPatchQuadtree()->cull(frustum, camera.getPosition(), maxDistance, padding, maxTerrainHeight, bladeDimensions.hMax,
+														visible.data());
+
+		double flatTime = std::chrono::duration<double, std::milli>(middle - start).count() / iterations;
+		double treeTime = std::chrono::duration<double, std::milli>(end - middle).count() / iterations;
+
+		std::cout << "  patches: " << field.getPatchCount()
+				  << "  flat: " << flatTime << " ms (" << flatCount << " visible)"
+				  << "  quadtree: " << treeTime << " ms (" << treeCount << " visible, "
+				  << field.getPatchQuadtree()->getVisitedNodeCount() << "/" << field.getPatchQuadtree()->getNodeCount() << " nodes)"
+				  << "  height map bounds: " << tightCount << " visible" << std::endl;
+	}
+	std::cout << std::endl;
+}
+
+void Benchmark::referenceRenderer()
+{
+	/* Default scene of the application seen from the start position, all visible patches through the near blade chain */
+	GrassField::BladeDimensions bladeDimensions{ 0.1, 0.3, 1.0, 5.0 };
+	GrassField field(200.0f, 8.0f, 700, bladeDimensions);
+	HeightField heightField(QImage("../res/height_map.png").mirrored());
+	GrassReferenceRenderer renderer(&field, &heightField);
+	field.setHeightField(heightField);
+	int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	const int iterations = 5;
+
+	Camera camera(glm::vec3(0.0f, 125.0f, 230.0f), 45, 16.0f / 9.0f, 0.1f, 1000.0f);
+	camera.rotateCamera(900.0f, -270.0f);
+	Frustum frustum(camera.getProjectionMatrix() * camera.getViewMatrix());
+	GrassReferenceRenderer::Parameters parameters{ camera.getPosition(), 500.0f, 5, 0.3f, 30.0f, true, glm::vec3(1.0f, 1.0f, 0.5f), 5000 };
+
+	std::vector<int> visible(field.getPatchCount());
+	int visibleCount = field.getPatchQuadtree()->cull(frustum, camera.getPosition(), parameters.maxDistance, field.getPatchReach(parameters.maxBendingFactor),
+													  parameters.maxTerrainHeight, bladeDimensions.hMax, visible.data());
+
+	std::cout << "CPU reference renderer (" << visibleCount << " patches, average of " << iterations << " runs)" << std::endl;
+
+	auto run = [&](int threads, bool simd)
+	{
+		double time = 0.0;
+		for (int i = 0; i < iterations; i++)
+		{
+			renderer.render(visible.data(), visibleCount, parameters, threads, simd);
+			time += renderer.getRenderTime() / iterations;
+		}
+		return time;
+	};
+
+	double scalarTime = run(1, false);
+	std::vector<GrassReferenceRenderer::Vertex> scalarVertices = renderer.render(visible.data(), visibleCount, parameters, 1, false);
+	std::cout << "  scalar, 1 thread: " << scalarTime << " ms  blades: " << renderer.getBladeCount() << "  triangles: " << renderer.getTriangleCount()
+			  << "  " << renderer.getBladeCount() / scalarTime / 1000.0 << " M blades/s" << std::endl;
+
+	std::vector<GrassReferenceRenderer::Vertex> simdVertices = renderer.render(visible.data(), visibleCount, parameters, 1, true);
+	GrassReferenceRenderer::Comparison comparison = GrassReferenceRenderer::compare(scalarVertices, simdVertices);
+
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		double time = run(threads, true);
+		bool same = identical(renderer.render(visible.data(), visibleCount, parameters, threads, true), simdVertices);
+
+		std::cout << "  " << GrassReferenceRenderer::getKernelName() << ", " << threads << " threads: " << time << " ms"
+				  << "  speedup: " << scalarTime / time
+				  << "  " << renderer.getBladeCount() / time / 1000.0 << " M blades/s"
+				  << "  identical: " << (same ? "yes" : "NO") << std::endl;
+
+		if (threads < maxThreads && threads * 2 > maxThreads)
+			threads = maxThreads / 2;	// always finish with all hardware threads
+	}
+	std::cout << "  " << GrassReferenceRenderer::getKernelName() << " vs. scalar: max. difference " << comparison.maxError
+			  << (comparison.passed ? "" : " MISMATCH") << std::endl << std::endl;
+}
+
+void Benchmark::generateLegacy(size_t bladeCount, GrassField::BladeDimensions bladeDimensions, float patchSize, LegacyGeometry &geometry)
+{
+	/* The loop GrassField had before the per-blade records - rand() based glm randoms, a translation matrix per blade
+	   and four per-vertex streams with every value duplicated for each corner */
+	float randoms[11];
+	srand(1234);
+
+	for (size_t i = 0; i < bladeCount; i++)
+	{
+		randoms[0] = glm::linearRand(0.00f, 360.0f);
+		randoms[1] = glm::linearRand(-1.00f, 1.00f);
+		randoms[2] = glm::linearRand(-1.00f, 1.00f);
+		randoms[3] = glm::linearRand(-0.25f, 0.25f);
+		randoms[4] = glm::linearRand(0.75f, 1.25f);
+		randoms[5] = glm::linearRand(0.00f, 0.05f);
+		randoms[6] = glm::linearRand(0.00f, 0.05f);
+		randoms[7] = glm::linearRand(0.00f, 0.05f);
+		randoms[8]  = glm::linearRand(0.0f, 1.0f);
+		randoms[9]  = glm::linearRand(-patchSize / 2, patchSize / 2);
+		randoms[10] = glm::linearRand(-patchSize / 2, patchSize / 2);
+
+		float w =  bladeDimensions.wMin + randoms[8] * (bladeDimensions.wMax - bladeDimensions.wMin);
+		float h = (bladeDimensions.hMin + randoms[8] * (bladeDimensions.hMax - bladeDimensions.hMin));
+
+		glm::vec4 pc{ 0.0f, 0.0f, 0.0f, 1.0f };
+		glm::vec4 p1 = pc + glm::vec4(-0.5f * w, 0.0f, 0.0f, 0.0f);
+		glm::vec4 p2 = pc + glm::vec4( 0.5f * w, 0.0f, 0.0f, 0.0f);
+		glm::vec4 p3 = pc + glm::vec4( 0.5f * w,	h, 0.0f, 0.0f);
+		glm::vec4 p4 = pc + glm::vec4(-0.5f * w,	h, 0.0f, 0.0f);
+
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(randoms[9], 0.0f, randoms[10]));
+		p1 = model * p1;
+		p2 = model * p2;
+		p3 = model * p3;
+		p4 = model * p4;
+		pc = model * pc;
+
+		p1.w = p2.w = p3.w = p4.w = randoms[0];
+		geometry.vertexPositions.push_back(p1);
+		geometry.vertexPositions.push_back(p2);
+		geometry.vertexPositions.push_back(p3);
+		geometry.vertexPositions.push_back(p4);
+
+		geometry.centerPositions.push_back(glm::vec4(pc.x, 0.0f, pc.z, randoms[1]));
+		geometry.centerPositions.push_back(glm::vec4(pc.x, 0.0f, pc.z, randoms[1]));
+		geometry.centerPositions.push_back(glm::vec4(pc.x, 1.0f, pc.z, randoms[1]));
+		geometry.centerPositions.push_back(glm::vec4(pc.x, 1.0f, pc.z, randoms[1]));
+
+		geometry.textureCoords.push_back(glm::vec4(0.0f, 0.0f, randoms[2], randoms[3]));
+		geometry.textureCoords.push_back(glm::vec4(1.0f, 0.0f, randoms[2], randoms[3]));
+		geometry.textureCoords.push_back(glm::vec4(1.0f, 1.0f, randoms[2], randoms[3]));
+		geometry.textureCoords.push_back(glm::vec4(0.0f, 1.0f, randoms[2], randoms[3]));
+
+		for (int corner = 0; corner < 4; corner++)
+			geometry.randoms.push_back(glm::vec4(randoms[4], randoms[5], randoms[6], randoms[7]));
+	}
+}
+
+bool Benchmark::identical(const BladeStore &a, const BladeStore &b)
+{
+	bool same = identical(a.x, b.x) && identical(a.z, b.z) && identical(a.width, b.width) && identical(a.height, b.height) && identical(a.angle, b.angle);
+	for (int r = 0; r < 7; r++)
+		same = same && identical(a.randoms[r], b.randoms[r]);
+
+	return same;
+}
+
+bool Benchmark::identical(const std::vector<float> &a, const std::vector<float> &b)
+{
+	return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+bool Benchmark::identical(const std::vector<GrassReferenceRenderer::Vertex> &a, const std::vector<GrassReferenceRenderer::Vertex> &b)
+{
+	return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(GrassReferenceRenderer::Vertex)) == 0;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <chrono>
+#include <cstdlib>
+
+#include <glm/gtc/random.hpp>
+
+#include "GrassField.hpp"
+#include "Camera.hpp"
+#include "HeightField.hpp"
+#include "GrassReferenceRenderer.hpp"
+
+/* CPU micro-benchmarks started from the GUI on a worker thread (no GL calls), results are printed to the console */
+class Benchmark
+{
+public:
+    static void bladeGenerationScaling(int bladeCount);
+    static void bladeGenerationKernels();
+    static void patchCulling();
+    static void referenceRenderer();
+
+protected:
+    /* Four per-vertex streams of the original generation loop */
+    struct LegacyGeometry
+    {
+        std::vector<glm::vec4> vertexPositions;
+        std::vector<glm::vec4> centerPositions;
+        std::vector<glm::vec4> textureCoords;
+        std::vector<glm::vec4> randoms;
+    };
+
+    static void generateLegacy(size_t bladeCount, GrassField::BladeDimensions bladeDimensions, float patchSize, LegacyGeometry &geometry);
+    static bool identical(const BladeStore &a, const BladeStore &b);
+    static bool identical(const std::vector<float> &a, const std::vector<float> &b);
+    static bool identical(const std::vector<GrassReferenceRenderer::Vertex> &a, const std::vector<GrassReferenceRenderer::Vertex> &b);
+};
@@ -0,0 +1,118 @@
+#include "BenchmarkReport.hpp"
+
+BenchmarkReport::BenchmarkReport(std::vector<std::string> columns)
+	: columns{ columns }
+{
+}
+
+void BenchmarkReport::addFrame(std::vector<double> values)
+{
+	values.resize(columns.size(), 0.0);
+	frames.push_back(values);
+}
+
+BenchmarkReport::Summary BenchmarkReport::getSummary(int column)
+{
+	Summary summary{};
+	if (frames.empty())
+		return summary;
+
+	std::vector<double> sorted;
+	sorted.reserve(frames.size());
+	for (auto &frame : frames)
+		sorted.push_back(frame[column]);
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+	for (double value : sorted)
+		sum += value;
+
+	summary.mean = sum / sorted.size();
+	summary.min	 = sorted.front();
+	summary.max	 = sorted.back();
+	summary.p50	 = percentile(sorted, 50.0);
+	summary.p95	 = percentile(sorted, 95.0);
+	summary.p99	 = percentile(sorted, 99.0);
+
+	return summary;
+}
+
+int BenchmarkReport::getFrameCount()
+{
+	return frames.size();
+}
+
+int BenchmarkReport::getColumn(std::string name)
+{
+	auto column = std::find(columns.begin(), columns.end(), name);
+	return column == columns.end() ? -1 : (int)(column - columns.begin());
+}
+
+bool BenchmarkReport::writeCsv(std::string fileName)
+{
+	std::ofstream file(fileName);
+	if (!file.is_open())
+		return false;
+
+	file << "frame";
+	for (auto &column : columns)
+		file << "," << column;
+	file << "\n";
+
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		file << i;
+		for (double value : frames[i])
+			file << "," << value;
+		file << "\n";
+	}
+
+	return true;
+}
+
+bool BenchmarkReport::writeJson(std::string fileName)
+{
+	std::ofstream file(fileName);
+	if (!file.is_open())
+		return false;
+
+	file << "{\n  \"frames\": " << frames.size() << ",\n  \"summary\": {\n";
+	for (size_t c = 0; c < columns.size(); c++)
+	{
+		Summary s = getSummary(c);
+		file << "    \"" << columns[c] << "\": { "
+			 << "\"mean\": " << s.mean << ", \"min\": " << s.min << ", \"max\": " << s.max << ", "
+			 << "\"p50\": " << s.p50 << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99 << " }"
+			 << (c + 1 < columns.size() ? ",\n" : "\n");
+	}
+	file << "  },\n  \"perFrame\": {\n";
+	for (size_t c = 0; c < columns.size(); c++)
+	{
+		file << "    \"" << columns[c] << "\": [";
+		for (size_t i = 0; i < frames.size(); i++)
+			file << (i ? ", " : "") << frames[i][c];
+		file << "]" << (c + 1 < columns.size() ? ",\n" : "\n");
+	}
+	file << "  }\n}\n";
+
+	return true;
+}
+
+void BenchmarkReport::print()
+{
+	std::cout << "Benchmark summary (" << frames.size() << " frames)" << std::endl;
+	for (size_t c = 0; c < columns.size(); c++)
+	{
+		Summary s = getSummary(c);
+		std::cout << "  " << columns[c]
+				  << "  mean: " << s.mean << "  p50: " << s.p50 << "  p95: " << s.p95 << "  p99: " << s.p99
+				  << "  max: " << s.max << std::endl;
+	}
+}
+
+double BenchmarkReport::percentile(const std::vector<double> &sorted, double p)
+{
+	/* Nearest-rank */
+	size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+	return sorted[std::clamp(rank, (size_t)1, sorted.size()) - 1];
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+/* Per-frame timings of a benchmark run (one column per measured value) with percentile summaries */
+class BenchmarkReport
+{
+public:
+    struct Summary
+    {
+        double mean;
+        double min;
+        double max;
+        double p50;
+        double p95;
+        double p99;
+    };
+
+    BenchmarkReport(std::vector<std::string> columns);
+
+    void addFrame(std::vector<double> values);
+    Summary getSummary(int column);
+    int getFrameCount();
+    int getColumn(std::string name);    // -1 if there is no such column
+
+    bool writeCsv(std::string fileName);
+    bool writeJson(std::string fileName);
+    void print();
+
+protected:
+    static double percentile(const std::vector<double> &sorted, double p);
+
+private:
+    std::vector<std::string> columns;
+    std::vector<std::vector<double>> frames;
+};
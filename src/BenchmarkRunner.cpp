@@ -0,0 +1,329 @@
+#include "BenchmarkRunner.hpp"
+
+BenchmarkRunner::BenchmarkRunner(Settings settings)
+	: settings{ settings }
+{
+}
+
+int BenchmarkRunner::run()
+{
+	CameraPath cameraPath;
+	if (!cameraPath.load(settings.cameraPathFile))
+	{
+		std::cout << "Cannot load camera path: " << settings.cameraPathFile << std::endl;
+		return 1;
+	}
+
+	/* Offscreen context - needs no window when Qt runs with the offscreen platform plugin */
+	QOffscreenSurface surface;
+	surface.setFormat(QSurfaceFormat::defaultFormat());
+	surface.create();
+
+	QOpenGLContext context;
+	context.setFormat(QSurfaceFormat::defaultFormat());
+	if (!context.create() || !context.makeCurrent(&surface))
+	{
+		std::cout << "Cannot create an offscreen OpenGL context" << std::endl;
+		return 1;
+	}
+	initializeOpenGLFunctions();
+
+	std::cout << "Benchmark: " << context.format().majorVersion() << "." << context.format().minorVersion() << " "
+			  << (const char *)glGetString(GL_RENDERER) << ", " << settings.width << "x" << settings.height << ", "
+			  << settings.frameCount << " frames" << std::endl;
+
+	{
+		QOpenGLFramebufferObjectFormat framebufferFormat;
+		framebufferFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+		QOpenGLFramebufferObject framebuffer(settings.width, settings.height, framebufferFormat);
+
+		OpenGLWindow window(true);
+		window.initializeHeadless(framebuffer.handle(), settings.width, settings.height);
+		if (!terrainStatisticsPrinted)
+		{
+			window.printTerrainStatistics();
+			terrainStatisticsPrinted = true;
+		}
+		window.setMaxDistance(settings.maxDistance);
+		window.setLodEnabled(settings.lodEnabled);
+		window.setGrassPath(settings.grassPath);
+		window.setTerrainMode(settings.terrainMode);
+		window.setTerrainIndexFormat(settings.terrainIndexFormat);
+		window.setGrassDepthPrePass(settings.grassDepthPrePass);
+		window.setSortPatchesFrontToBack(settings.sortPatches);
+		window.setOverdrawView(settings.overdrawView);
+		window.setCullingMode(settings.cullingMode);
+		window.setOcclusionCulling(settings.occlusionCulling);
+		window.setSimulationEnabled(settings.simulationEnabled);
+
+		if (settings.verifySimulationSteps > 0)
+		{
+			/* The verification runs inside the next frame and prints its result */
+			window.requestSimulationVerification(settings.verifySimulationSteps);
+			window.renderHeadlessFrame(0);
+			float error = window.getSimulationError();
+			context.doneCurrent();
+			return error >= 0.0f && error <= BladeSimulation::TOLERANCE ? 0 : 1;
+		}
+
+		/* Whole-frame GPU time from timestamps - GL_TIME_ELAPSED is already used per pass and cannot nest */
+		int totalFrames = settings.warmupFrameCount + settings.frameCount;
+		std::vector<GLuint> queries(2 * totalFrames);
+		std::vector<double> cpuTimes(totalFrames);
+		std::vector<double> terrainTriangles(totalFrames);
+		std::vector<GLuint> occlusionTested(totalFrames), occlusionOccluded(totalFrames);
+		glGenQueries(2 * totalFrames, queries.data());
+
+		GpuTimer *gpuTimer = window.getGpuTimer();
+		gpuTimer->setRecording(true);
+		PipelineStatistics *grassStatistics = window.getGrassStatistics();
+		grassStatistics->setRecording(true);
+		PipelineStatistics *grassPrePassStatistics = window.getGrassPrePassStatistics();
+		grassPrePassStatistics->setRecording(true);
+		bool prePassColumns = settings.grassDepthPrePass && grassPrePassStatistics->getSupported();
+		PipelineStatistics *terrainStatistics = window.getTerrainStatistics();
+		terrainStatistics->setRecording(true);
+
+		QElapsedTimer cpuTimer;
+		for (int frame = 0; frame < totalFrames; frame++)
+		{
+			/* Warm-up frames replay the start of the path */
+			float time = std::max(frame - settings.warmupFrameCount, 0) * settings.timestep;
+			CameraPath::Keyframe keyframe = cameraPath.sample(time);
+			window.getCamera()->setPosition(keyframe.position);
+			window.getCamera()->setRotation(keyframe.yaw, keyframe.pitch);
+
+			cpuTimer.start();
+			glQueryCounter(queries[2 * frame], GL_TIMESTAMP);
+			window.renderHeadlessFrame((int)(time * 1000.0f));
+			glQueryCounter(queries[2 * frame + 1], GL_TIMESTAMP);
+			cpuTimes[frame] = cpuTimer.nsecsElapsed() / 1e6;
+			terrainTriangles[frame] = window.getTerrainTriangleCount();
+			window.getOcclusionStats(occlusionTested[frame], occlusionOccluded[frame]);
+		}
+
+		/* Results are read back only at the end, so the measured frames never wait for the GPU */
+		glFinish();
+		gpuTimer->flush();
+		grassStatistics->flush();
+		grassPrePassStatistics->flush();
+		terrainStatistics->flush();
+
+		std::vector<std::string> columns{ "cpu_ms", "gpu_ms" };
+		for (int pass = 0; pass < gpuTimer->getPassCount(); pass++)
+			columns.push_back("gpu_" + gpuTimer->getPassName(pass) + "_ms");
+		if (grassStatistics->getSupported())
+		{
+			for (int i = 0; i < PipelineStatistics::COUNTER_COUNT; i++)
+				columns.push_back(std::string("grass_") + PipelineStatistics::getCounterName((PipelineStatistics::Counter)i));
+		}
+		if (prePassColumns)
+		{
+			for (int i = 0; i < PipelineStatistics::COUNTER_COUNT; i++)
+				columns.push_back(std::string("grass_prepass_") + PipelineStatistics::getCounterName((PipelineStatistics::Counter)i));
+		}
+		columns.push_back("terrain_triangles");
+		if (settings.occlusionCulling)
+		{
+			columns.push_back("occlusion_tested");
+			columns.push_back("occlusion_occluded");
+		}
+
+		BenchmarkReport report(columns);
+		const std::vector<std::vector<float>> &passTimes = gpuTimer->getRecords();
+		const std::vector<std::vector<GLuint64>> &grassCounters = grassStatistics->getRecords();
+		const std::vector<std::vector<GLuint64>> &prePassCounters = grassPrePassStatistics->getRecords();
+		const std::vector<std::vector<GLuint64>> &terrainCounters = terrainStatistics->getRecords();
+		for (int frame = settings.warmupFrameCount; frame < totalFrames; frame++)
+		{
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(queries[2 * frame], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(queries[2 * frame + 1], GL_QUERY_RESULT, &end);
+
+			std::vector<double> values{ cpuTimes[frame], (end - begin) / 1e6 };
+			if (frame < (int)passTimes.size())
+				values.insert(values.end(), passTimes[frame].begin(), passTimes[frame].end());
+			else
+				values.resize(values.size() + gpuTimer->getPassCount(), 0.0);
+			if (frame < (int)grassCounters.size())
+				values.insert(values.end(), grassCounters[frame].begin(), grassCounters[frame].end());
+			else if (grassStatistics->getSupported())
+				values.resize(values.size() + PipelineStatistics::COUNTER_COUNT, 0.0);
+			if (prePassColumns && frame < (int)prePassCounters.size())
+				values.insert(values.end(), prePassCounters[frame].begin(), prePassCounters[frame].end());
+			else if (prePassColumns)
+				values.resize(values.size() + PipelineStatistics::COUNTER_COUNT, 0.0);
+
+			/* Triangles reaching the clipper when the counters are available - the tessellated terrain is known only to the GPU */
+			if (frame < (int)terrainCounters.size())
+				values.push_back(terrainCounters[frame][(int)PipelineStatistics::Counter::CLIPPING_INPUT_PRIMITIVES]);
+			else
+				values.push_back(terrainTriangles[frame]);
+
+			/* Read without stalling, so they lag the frame by occlusionStatsLatency frames */
+			if (settings.occlusionCulling)
+			{
+				values.push_back(occlusionTested[frame]);
+				values.push_back(occlusionOccluded[frame]);
+			}
+			report.addFrame(values);
+		}
+		glDeleteQueries(2 * totalFrames, queries.data());
+
+		if (!settings.screenshotFile.empty() && !framebuffer.toImage().save(QString::fromStdString(settings.screenshotFile)))
+			std::cout << "Cannot write screenshot: " << settings.screenshotFile << std::endl;
+
+		/* Last frame once more with the strips read back and compared */
+		bool referenceMatched = true;
+		if (settings.compareReference)
+		{
+			window.requestReferenceComparison();
+			window.renderHeadlessFrame((int)(std::max(totalFrames - 1 - settings.warmupFrameCount, 0) * settings.timestep * 1000.0f));
+			referenceMatched = window.getReferenceComparison().passed;
+		}
+
+		report.print();
+		lastReport = std::make_unique<BenchmarkReport>(report);
+		if (!report.writeCsv(settings.outputPrefix + ".csv") || !report.writeJson(settings.outputPrefix + ".json"))
+		{
+			std::cout << "Cannot write benchmark results: " << settings.outputPrefix << std::endl;
+			return 1;
+		}
+		std::cout << "Results written to " << settings.outputPrefix << ".csv/.json" << std::endl;
+
+		if (!referenceMatched)
+		{
+			context.doneCurrent();
+			return 1;
+		}
+	}
+
+	context.doneCurrent();
+	return 0;
+}
+
+int BenchmarkRunner::runCpuReference()
+{
+	CameraPath cameraPath;
+	if (!cameraPath.load(settings.cameraPathFile))
+	{
+		std::cout << "Cannot load camera path: " << settings.cameraPathFile << std::endl;
+		return 1;
+	}
+
+	std::cout << "CPU reference: " << GrassReferenceRenderer::getKernelName() << ", " << settings.width << "x" << settings.height << ", "
+			  << settings.frameCount << " frames" << std::endl;
+
+	/* The window is only used for its scene and frame state, it is never shown or made current */
+	OpenGLWindow window(true);
+	window.getCamera()->setAspectRatio((float)settings.width / (float)settings.height);
+	window.setMaxDistance(settings.maxDistance);
+
+	BenchmarkReport report({ "cpu_ms", "blades", "triangles" });
+	GrassReferenceRenderer *renderer = nullptr;
+	int totalFrames = settings.warmupFrameCount + settings.frameCount;
+	for (int frame = 0; frame < totalFrames; frame++)
+	{
+		float time = std::max(frame - settings.warmupFrameCount, 0) * settings.timestep;
+		CameraPath::Keyframe keyframe = cameraPath.sample(time);
+		window.getCamera()->setPosition(keyframe.position);
+		window.getCamera()->setRotation(keyframe.yaw, keyframe.pitch);
+
+		renderer = window.renderReferenceFrame(time * 1000.0f, settings.threadCount);
+		if (frame >= settings.warmupFrameCount)
+			report.addFrame({ renderer->getRenderTime(), (double)renderer->getBladeCount(), (double)renderer->getTriangleCount() });
+	}
+
+	report.print();
+	if (!report.writeCsv(settings.outputPrefix + ".csv") || !report.writeJson(settings.outputPrefix + ".json"))
+	{
+		std::cout << "Cannot write benchmark results: " << settings.outputPrefix << std::endl;
+		return 1;
+	}
+	std::cout << "Results written to " << settings.outputPrefix << ".csv/.json" << std::endl;
+
+	if (renderer && !settings.referenceObjFile.empty() && !writeObj(settings.referenceObjFile, renderer->getTriangles()))
+	{
+		std::cout << "Cannot write triangles: " << settings.referenceObjFile << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+int BenchmarkRunner::runTerrainComparison()
+{
+	const std::pair<OpenGLWindow::TerrainMode, std::string> modes[] =
+	{
+		{ OpenGLWindow::TerrainMode::STRIP, "strip" },
+		{ OpenGLWindow::TerrainMode::CHUNKED, "chunked" },
+		{ OpenGLWindow::TerrainMode::CLIPMAP, "clipmap" },
+		{ OpenGLWindow::TerrainMode::TESSELLATED, "tessellated" }
+	};
+
+	Settings baseSettings = settings;
+	std::vector<std::unique_ptr<BenchmarkReport>> reports;
+	for (const auto &mode : modes)
+	{
+		std::cout << "Terrain mode: " << mode.second << std::endl;
+		settings = baseSettings;
+		settings.terrainMode  = mode.first;
+		settings.outputPrefix = baseSettings.outputPrefix + "_" + mode.second;
+		if (!baseSettings.screenshotFile.empty())
+		{
+			size_t extension = baseSettings.screenshotFile.find_last_of('.');
+			settings.screenshotFile = baseSettings.screenshotFile.substr(0, extension) + "_" + mode.second
+									+ (extension == std::string::npos ? "" : baseSettings.screenshotFile.substr(extension));
+		}
+
+		int result = run();
+		if (result != 0)
+		{
+			settings = baseSettings;
+			return result;
+		}
+		reports.push_back(std::move(lastReport));
+	}
+	settings = baseSettings;
+
+	/* Strip grid is the baseline */
+	std::cout << std::endl << "Terrain comparison (p50 / p95)" << std::endl;
+	std::cout << std::left << std::setw(14) << "mode" << std::setw(22) << "frame gpu ms" << std::setw(22) << "terrain gpu ms"
+			  << "terrain triangles" << std::endl;
+	double stripTriangles = 0.0;
+	for (size_t i = 0; i < reports.size(); i++)
+	{
+		BenchmarkReport &report = *reports[i];
+		BenchmarkReport::Summary frame = report.getSummary(report.getColumn("gpu_ms"));
+		BenchmarkReport::Summary terrain = report.getSummary(report.getColumn("gpu_Terrain_ms"));
+		BenchmarkReport::Summary triangles = report.getSummary(report.getColumn("terrain_triangles"));
+		if (i == 0)
+			stripTriangles = triangles.mean;
+
+		std::ostringstream frameTimes, terrainTimes;
+		frameTimes << std::fixed << std::setprecision(3) << frame.p50 << " / " << frame.p95;
+		terrainTimes << std::fixed << std::setprecision(3) << terrain.p50 << " / " << terrain.p95;
+		std::cout << std::left << std::setw(14) << modes[i].second << std::setw(22) << frameTimes.str() << std::setw(22) << terrainTimes.str()
+				  << (long long)triangles.mean;
+		if (stripTriangles > 0.0)
+			std::cout << " (" << std::fixed << std::setprecision(1) << 100.0 * triangles.mean / stripTriangles << " %)" << std::defaultfloat;
+		std::cout << std::endl;
+	}
+
+	return 0;
+}
+
+bool BenchmarkRunner::writeObj(std::string fileName, const std::vector<glm::vec3> &triangles)
+{
+	std::ofstream file(fileName);
+	if (!file)
+		return false;
+
+	file << "# CPU reference renderer, " << triangles.size() / 3 << " triangles" << std::endl;
+	for (const glm::vec3 &vertex : triangles)
+		file << "v " << vertex.x << " " << vertex.y << " " << vertex.z << "\n";
+	for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+		file << "f " << i + 1 << " " << i + 2 << " " << i + 3 << "\n";
+
+	return file.good();
+}
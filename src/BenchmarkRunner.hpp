@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QElapsedTimer>
+
+#include "OpenGLWindow.hpp"
+#include "CameraPath.hpp"
+#include "BenchmarkReport.hpp"
+
+/*
+	Headless benchmark (--benchmark): renders into an offscreen FBO, replays a camera path
+	at a fixed timestep and writes per-frame CPU/GPU times to <prefix>.csv and <prefix>.json.
+	--cpu-reference replays the path through GrassReferenceRenderer instead, for machines without a GPU.
+	--compare-terrain replays it once per terrain mode and compares their frame times and triangle counts.
+*/
+class BenchmarkRunner : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    struct Settings
+    {
+        std::string cameraPathFile;
+        std::string outputPrefix = "benchmark";
+        int frameCount = 1000;
+        int warmupFrameCount = 10;
+        float timestep = 1.0f / 60.0f;  // seconds
+        int width = 1920;
+        int height = 1080;
+        float maxDistance = 500.0f;     // grass draw distance
+        bool lodEnabled = true;
+        OpenGLWindow::GrassPath grassPath = OpenGLWindow::GrassPath::TESSELLATION;
+        OpenGLWindow::TerrainMode terrainMode = OpenGLWindow::TerrainMode::STRIP;
+        Terrain::IndexFormat terrainIndexFormat = Terrain::IndexFormat::STRIP;     // of the strip mode grid
+        bool grassDepthPrePass = false; // adds the grass_prepass_ counters
+        bool sortPatches = false;       // front to back within each LOD tier
+        bool overdrawView = false;
+        OpenGLWindow::CullingMode cullingMode = OpenGLWindow::CullingMode::CPU;
+        bool occlusionCulling = false;  // GPU culling only, adds the occlusion_ columns
+        std::string screenshotFile;     // last frame, for comparing the grass paths
+        bool simulationEnabled = false;
+        int verifySimulationSteps = 0;  // > 0 - compare the blade simulation with the CPU reference instead of benchmarking
+        bool compareReference = false;  // compare the last frame with the CPU reference renderer (compute path)
+        int threadCount = 0;            // CPU reference renderer, 0 - all hardware threads
+        std::string referenceObjFile;   // last frame of the CPU reference renderer
+    };
+
+    BenchmarkRunner(Settings settings);
+
+    /* Returns the process exit code */
+    int run();
+
+    /* --cpu-reference: the camera path through the CPU reference renderer, no GL context needed */
+    int runCpuReference();
+
+    /* --compare-terrain: run() for every terrain mode, results go to <prefix>_<mode>.csv/.json */
+    int runTerrainComparison();
+
+protected:
+    static bool writeObj(std::string fileName, const std::vector<glm::vec3> &triangles);
+
+private:
+    Settings settings;
+    std::unique_ptr<BenchmarkReport> lastReport;    // of the last run()
+    bool terrainStatisticsPrinted = false;          // by the first run() only
+};
@@ -0,0 +1,162 @@
+#include "BladeGenerator.hpp"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+	#include <immintrin.h>
+#endif
+
+namespace
+{
+	/* Value ranges of r1 - r7 */
+	const float randomRanges[7][2] =
+	{
+		{ -1.00f, 1.00f },	// x offset
+		{ -1.00f, 1.00f },	// z offset
+		{ -0.25f, 0.25f },	// TCS
+		{  0.75f, 1.25f },	// TCS
+		{  0.00f, 0.05f },	// R
+		{  0.00f, 0.05f },	// G
+		{  0.00f, 0.05f }	// B
+	};
+
+#if defined(__AVX2__)
+	/* 8 lanes */
+	struct Lanes
+	{
+		using I = __m256i;
+		using F = __m256;
+		static constexpr int count = 8;
+
+		static I set1(uint32_t v)						{ return _mm256_set1_epi32((int)v); }
+		static I indices(uint32_t first)				{ return _mm256_add_epi32(set1(first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)); }
+		static I add(I a, I b)							{ return _mm256_add_epi32(a, b); }
+		static I mul(I a, I b)							{ return _mm256_mullo_epi32(a, b); }
+		static I bitXor(I a, I b)						{ return _mm256_xor_si256(a, b); }
+		template<int S> static I shiftRight(I a)		{ return _mm256_srli_epi32(a, S); }
+		static F toFloat(I a)							{ return _mm256_cvtepi32_ps(a); }
+		static F set1f(float v)							{ return _mm256_set1_ps(v); }
+		static F addf(F a, F b)							{ return _mm256_add_ps(a, b); }
+		static F mulf(F a, F b)							{ return _mm256_mul_ps(a, b); }
+		static void store(float *p, F v)				{ _mm256_storeu_ps(p, v); }
+	};
+#elif defined(__SSE4_1__)
+	/* 4 lanes */
+	struct Lanes
+	{
+		using I = __m128i;
+		using F = __m128;
+		static constexpr int count = 4;
+
+		static I set1(uint32_t v)						{ return _mm_set1_epi32((int)v); }
+		static I indices(uint32_t first)				{ return _mm_add_epi32(set1(first), _mm_setr_epi32(0, 1, 2, 3)); }
+		static I add(I a, I b)							{ return _mm_add_epi32(a, b); }
+		static I mul(I a, I b)							{ return _mm_mullo_epi32(a, b); }
+		static I bitXor(I a, I b)						{ return _mm_xor_si128(a, b); }
+		template<int S> static I shiftRight(I a)		{ return _mm_srli_epi32(a, S); }
+		static F toFloat(I a)							{ return _mm_cvtepi32_ps(a); }
+		static F set1f(float v)							{ return _mm_set1_ps(v); }
+		static F addf(F a, F b)							{ return _mm_add_ps(a, b); }
+		static F mulf(F a, F b)							{ return _mm_mul_ps(a, b); }
+		static void store(float *p, F v)				{ _mm_storeu_ps(p, v); }
+	};
+#endif
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+	/* Same operations in the same order as Random::hash */
+	inline Lanes::I hash(Lanes::I x)
+	{
+		x = Lanes::bitXor(x, Lanes::shiftRight<16>(x));
+		x = Lanes::mul(x, Lanes::set1(0x7feb352dU));
+		x = Lanes::bitXor(x, Lanes::shiftRight<15>(x));
+		x = Lanes::mul(x, Lanes::set1(0x846ca68bU));
+		x = Lanes::bitXor(x, Lanes::shiftRight<16>(x));
+		return x;
+	}
+
+	/* Same operations in the same order as Random::uniform */
+	inline Lanes::F uniform(Lanes::I state, uint32_t stream, float min, float max)
+	{
+		Lanes::I bits = hash(Lanes::add(state, Lanes::set1(stream * 0x9e3779b9U)));
+		Lanes::F t = Lanes::mulf(Lanes::toFloat(Lanes::shiftRight<8>(bits)), Lanes::set1f(1.0f / 16777216.0f));
+		return Lanes::addf(Lanes::set1f(min), Lanes::mulf(t, Lanes::set1f(max - min)));
+	}
+
+	/* Returns the first blade which was not generated */
+	size_t generateSimd(BladeStore &store, size_t first, size_t last, const BladeGenerator::Parameters &parameters)
+	{
+		const float halfPatch = parameters.patchSize / 2;
+		size_t i = first;
+
+		for (; i + Lanes::count <= last; i += Lanes::count)
+		{
+			Lanes::I state = hash(Lanes::bitXor(Lanes::indices((uint32_t)i), Lanes::set1(parameters.randomKey)));
+
+			Lanes::store(&store.angle[i], uniform(state, BladeGenerator::ANGLE, 0.0f, 360.0f));
+			for (int r = 0; r < 7; r++)
+				Lanes::store(&store.randoms[r][i], uniform(state, BladeGenerator::RANDOMS + r, randomRanges[r][0], randomRanges[r][1]));
+
+			Lanes::F size = uniform(state, BladeGenerator::SIZE, 0.0f, 1.0f);
+			Lanes::store(&store.width[i],  Lanes::addf(Lanes::set1f(parameters.wMin), Lanes::mulf(size, Lanes::set1f(parameters.wMax - parameters.wMin))));
+			Lanes::store(&store.height[i], Lanes::addf(Lanes::set1f(parameters.hMin), Lanes::mulf(size, Lanes::set1f(parameters.hMax - parameters.hMin))));
+			Lanes::store(&store.x[i], uniform(state, BladeGenerator::OFFSET_X, -halfPatch, halfPatch));
+			Lanes::store(&store.z[i], uniform(state, BladeGenerator::OFFSET_Z, -halfPatch, halfPatch));
+		}
+
+		return i;
+	}
+#endif
+}
+
+void BladeStore::resize(size_t count)
+{
+	x.resize(count);
+	z.resize(count);
+	width.resize(count);
+	height.resize(count);
+	angle.resize(count);
+	for (auto &random : randoms)
+		random.resize(count);
+}
+
+size_t BladeStore::size() const
+{
+	return x.size();
+}
+
+void BladeGenerator::generate(BladeStore &store, size_t first, size_t last, const Parameters &parameters)
+{
+#if defined(__AVX2__) || defined(__SSE4_1__)
+	first = generateSimd(store, first, last, parameters);
+#endif
+	generateScalar(store, first, last, parameters);
+}
+
+void BladeGenerator::generateScalar(BladeStore &store, size_t first, size_t last, const Parameters &parameters)
+{
+	const float halfPatch = parameters.patchSize / 2;
+
+	for (size_t i = first; i < last; i++)
+	{
+		uint32_t state = Random::counterState(parameters.randomKey, (uint32_t)i);
+
+		store.angle[i] = Random::uniform(state, ANGLE, 0.0f, 360.0f);
+		for (int r = 0; r < 7; r++)
+			store.randoms[r][i] = Random::uniform(state, RANDOMS + r, randomRanges[r][0], randomRanges[r][1]);
+
+		float size = Random::uniform(state, SIZE, 0.0f, 1.0f);
+		store.width[i]  = parameters.wMin + size * (parameters.wMax - parameters.wMin);
+		store.height[i] = parameters.hMin + size * (parameters.hMax - parameters.hMin);
+		store.x[i] = Random::uniform(state, OFFSET_X, -halfPatch, halfPatch);
+		store.z[i] = Random::uniform(state, OFFSET_Z, -halfPatch, halfPatch);
+	}
+}
+
+const char *BladeGenerator::getKernelName()
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(__SSE4_1__)
+	return "SSE4.1";
+#else
+	return "scalar";
+#endif
+}
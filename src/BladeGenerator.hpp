@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Random.hpp"
+
+/* Structure-of-arrays blade storage, one contiguous array per blade attribute */
+struct BladeStore
+{
+    std::vector<float> x;           // x offset within a patch
+    std::vector<float> z;           // z offset within a patch
+    std::vector<float> width;
+    std::vector<float> height;
+    std::vector<float> angle;       // r0
+    std::vector<float> randoms[7];  // r1 - r7
+
+    void resize(size_t count);
+    size_t size() const;
+};
+
+/*
+	Fills a range of a BladeStore from the counter-based RNG.
+	The SIMD kernel (AVX2 - 8 blades, SSE4.1 - 4 blades per iteration) is selected at compile time,
+	the scalar kernel handles the remainder and produces bit-identical values.
+*/
+class BladeGenerator
+{
+public:
+    struct Parameters
+    {
+        uint32_t randomKey;
+        float patchSize;
+        float wMin;
+        float wMax;
+        float hMin;
+        float hMax;
+    };
+
+    static void generate(BladeStore &store, size_t first, size_t last, const Parameters &parameters);
+    static void generateScalar(BladeStore &store, size_t first, size_t last, const Parameters &parameters);
+    static const char *getKernelName();
+
+    /* Random streams of a blade */
+    enum Stream { ANGLE = 0, RANDOMS = 1, SIZE = 8, OFFSET_X = 9, OFFSET_Z = 10 };
+};
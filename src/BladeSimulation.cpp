@@ -0,0 +1,116 @@
+#include "BladeSimulation.hpp"
+
+/* Point p pushed out of the collider, zero when p is outside */
+static glm::vec3 collide(glm::vec3 p, const BladeSimulation::Collider &collider)
+{
+	glm::vec3 ab = collider.b - collider.a;
+	float abLength2 = glm::dot(ab, ab);
+	float t = abLength2 > 0.0f ? std::clamp(glm::dot(p - collider.a, ab) / abLength2, 0.0f, 1.0f) : 0.0f;
+	glm::vec3 d = p - (collider.a + t * ab);
+	float distance = glm::length(d);
+
+	if (distance >= collider.radius || distance == 0.0f)
+		return glm::vec3(0.0f);
+	return d * ((collider.radius - distance) / distance);
+}
+
+void BladeSimulation::step(const std::vector<Rest> &rest, std::vector<State> &states, const Parameters &parameters)
+{
+	for (size_t i = 0; i < states.size(); i++)
+		step(rest[i], states[i], parameters);
+}
+
+void BladeSimulation::step(const Rest &rest, State &state, const Parameters &parameters)
+{
+	/* Same operations in the same order as bladeSimulationCS.glsl */
+	float height = rest.root.w;
+	if (height <= 0.0f)
+		return;
+
+	const glm::vec3 up(0.0f, 1.0f, 0.0f);
+	glm::vec3 v0 = glm::vec3(rest.root);
+	glm::vec3 v1 = glm::vec3(state.v1);
+	glm::vec3 v2 = glm::vec3(state.v2);
+	float collision = state.v2.w;
+	float dt = parameters.deltaTime;
+
+	/* Gravity - environmental plus a front component that bends the blade along its facing */
+	glm::vec3 gravity = glm::vec3(0.0f, -parameters.gravity, 0.0f) + 0.25f * parameters.gravity * glm::vec3(rest.front);
+
+	/* Recovery towards the rest pose, weakened while the blade is pressed down */
+	glm::vec3 recovery = (glm::vec3(rest.tip) - v2) * rest.front.w * std::max(1.0f - collision, 0.1f);
+
+	/* Wind, strongest on upright blades standing across it */
+	glm::vec3 wind = windForce(v0, parameters);
+	float windLength = glm::length(wind);
+	if (windLength > 0.0f)
+	{
+		float directionalAlignment = 1.0f - std::abs(glm::dot(wind / windLength, glm::normalize(v2 - v0)));
+		float heightRatio = glm::dot(v2 - v0, up) / height;
+		wind = wind * (directionalAlignment * heightRatio);
+	}
+
+	v2 += (gravity + recovery + wind) * dt;
+
+	/* Collisions of the tip and of the curve midpoint */
+	for (size_t i = 0; i < parameters.colliders.size() && i < MAX_COLLIDERS; i++)
+	{
+		glm::vec3 m = 0.25f * v0 + 0.5f * v1 + 0.25f * v2;
+		glm::vec3 push = collide(v2, parameters.colliders[i]) + 4.0f * collide(m, parameters.colliders[i]);
+		v2 += push;
+		collision += glm::length(push);
+	}
+	collision = std::clamp(collision - parameters.collisionDecay * dt, 0.0f, 1.0f);
+
+	/* Validation - keep v2 above the ground, place v1 and restore the blade length */
+	v2 -= up * std::min(glm::dot(up, v2 - v0), 0.0f);
+	float projectedLength = glm::length(v2 - v0 - up * glm::dot(v2 - v0, up));
+	v1 = v0 + height * up * std::max(1.0f - projectedLength / height, 0.05f * std::max(projectedLength / height, 1.0f));
+
+	float l0 = glm::length(v2 - v0);
+	float l1 = glm::length(v2 - v1) + glm::length(v1 - v0);
+	float ratio = height / ((2.0f * l0 + l1) / 3.0f);	// curve length estimate for degree 2
+	glm::vec3 v1Corrected = v0 + ratio * (v1 - v0);
+	v2 = v1Corrected + ratio * (v2 - v1);
+	v1 = v1Corrected;
+
+	state.v1 = glm::vec4(v1, 0.0f);
+	state.v2 = glm::vec4(v2, collision);
+}
+
+glm::vec3 BladeSimulation::windForce(glm::vec3 p, const Parameters &parameters)
+{
+	if (!parameters.windEnabled)
+		return glm::vec3(0.0f);
+
+	/* Same field as the analytic wind in grassBlade.glsl (w() plus the Horizon Zero Dawn terms), except that the
+	   pole of the cos() term is clamped - near it float32 sin/cos of the huge phase differ between CPU and GPU */
+	const float pi = 3.1415926535897932384626433832795f;
+	float c1 = parameters.windParams.x;
+	float c2 = 2.0f;
+	float c3 = parameters.windParams.y;
+	float a = pi * p.x + 10.0f * (parameters.windParams.z + 1.0f) + (pi / 4) / std::max(std::abs(std::cos(c2 * pi * p.z)), WIND_POLE_CLAMP);
+	float w = std::sin(c1 * a) * std::cos(c3 * a);
+
+	float phase = p.x + p.y + p.z;
+	float x = (1.0f * std::sin(0.03f * (phase + parameters.time / 30))) + 1.0f + w;	// integer division as in GLSL
+	float z = (0.5f * std::sin(0.03f * (phase + parameters.time / 100))) + 0.5f + w;
+
+	return glm::vec3(x, 0.0f, z) * parameters.windStrength;
+}
+
+float BladeSimulation::maxDifference(const std::vector<State> &a, const std::vector<State> &b)
+{
+	float difference = a.size() == b.size() ? 0.0f : INFINITY;
+
+	for (size_t i = 0; i < std::min(a.size(), b.size()); i++)
+	{
+		glm::vec4 d1 = glm::abs(a[i].v1 - b[i].v1);
+		glm::vec4 d2 = glm::abs(a[i].v2 - b[i].v2);
+		if (glm::any(glm::isnan(d1)) || glm::any(glm::isnan(d2)))
+			return INFINITY;
+		difference = std::max({ difference, d1.x, d1.y, d1.z, d2.x, d2.y, d2.z, d2.w });
+	}
+
+	return difference;
+}
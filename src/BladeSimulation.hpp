@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+/*
+	Physical blade model after Jahrmann & Wimmer 2017 (Responsive Real-Time Grass Rendering for General 3D Scenes).
+	Every blade instance (patch x blade) keeps its control points v1/v2 between frames and is moved by gravity,
+	stiffness recovery towards the rest pose, wind and sphere/capsule collisions, then corrected to stay above the
+	ground and keep its length. The GPU pass is shaders/bladeSimulationCS.glsl, step() is its CPU reference.
+*/
+class BladeSimulation
+{
+public:
+    /* std430 layouts of the bladeStatesBuffer and bladeRestBuffer SSBOs */
+    struct State
+    {
+        glm::vec4 v1;       // xyz, w unused
+        glm::vec4 v2;       // xyz, w = collision strength
+    };
+    struct Rest
+    {
+        glm::vec4 root;     // v0, w = blade height (0 - blade is discarded)
+        glm::vec4 tip;      // rest position of v2, w unused
+        glm::vec4 front;    // facing direction, w = stiffness
+    };
+
+    /* Capsule from a to b, a sphere when a == b */
+    struct Collider
+    {
+        glm::vec3 a;
+        float radius;
+        glm::vec3 b;
+        float padding;
+    };
+
+    struct Parameters
+    {
+        float gravity = 9.81f;
+        float windStrength = 2.0f;
+        bool windEnabled = true;
+        glm::vec3 windParams{ 1.0f, 1.0f, 0.0f };
+        float collisionDecay = 0.5f;    // collision strength lost per second
+        int time = 0;                   // ms, drives the wind like FrameUniforms::time
+        float deltaTime = 1.0f / 60.0f; // s
+        std::vector<Collider> colliders;
+    };
+
+    static const int MAX_COLLIDERS = 8;
+    static constexpr float TOLERANCE = 1e-3f;  // CPU/GPU verification, world units
+    static constexpr float WIND_POLE_CLAMP = 0.05f;   // smallest |cos| divisor of the wind phase, bladeSimulationCS.glsl
+
+    static void step(const std::vector<Rest> &rest, std::vector<State> &states, const Parameters &parameters);
+    static void step(const Rest &rest, State &state, const Parameters &parameters);
+    static glm::vec3 windForce(glm::vec3 p, const Parameters &parameters);
+
+    /* Largest component difference of v1 and v2 (collision strength included) */
+    static float maxDifference(const std::vector<State> &a, const std::vector<State> &b);
+};
@@ -60,13 +60,7 @@ void Camera::rotateCamera(float horizontalDelta, float verticalDelta)
 	if (pitch < -89.0f)
 		pitch = -89.0f;
 
-	glm::vec3 direction;
-	direction.x = cos(glm::radians(-yaw)) * cos(glm::radians(pitch));
-	direction.y = sin(glm::radians(pitch));
-	direction.z = sin(glm::radians(-yaw)) * cos(glm::radians(pitch));
-
-	frontVector = glm::normalize(direction);
-
+	calculateFrontVector();
 	calculateViewMatrix();
 }
 
@@ -99,6 +93,37 @@ void Camera::moveCamera(Direction direction, float speed)
 	calculateViewMatrix();
 }
 
+void Camera::setPosition(glm::vec3 position)
+{
+	cameraPosition = position;
+	calculateViewMatrix();
+}
+
+void Camera::setRotation(float yaw, float pitch)
+{
+	this->yaw	= yaw;
+	this->pitch = glm::clamp(pitch, -89.0f, 89.0f);
+
+	calculateFrontVector();
+	calculateViewMatrix();
+}
+
+void Camera::setAspectRatio(float aspectRatio)
+{
+	this->aspectRatio = aspectRatio;
+	calculateProjectionMatrix();
+}
+
+void Camera::calculateFrontVector()
+{
+	glm::vec3 direction;
+	direction.x = cos(glm::radians(-yaw)) * cos(glm::radians(pitch));
+	direction.y = sin(glm::radians(pitch));
+	direction.z = sin(glm::radians(-yaw)) * cos(glm::radians(pitch));
+
+	frontVector = glm::normalize(direction);
+}
+
 void Camera::calculateViewMatrix()
 {
 	viewMatrix = glm::lookAt(cameraPosition, cameraPosition + frontVector, upVector);
@@ -17,9 +17,13 @@ public:
 	void decreaseFov(float fovDelta);
 	void rotateCamera(float horizontalDelta, float verticalDelta);
 	void moveCamera(Direction direction, float speed);
+	void setPosition(glm::vec3 position);
+	void setRotation(float yaw, float pitch);
+	void setAspectRatio(float aspectRatio);
 
 
 protected:
+	void calculateFrontVector();
 	void calculateViewMatrix();
 	void calculateProjectionMatrix();
 
@@ -0,0 +1,81 @@
+#include "CameraPath.hpp"
+
+bool CameraPath::load(std::string fileName)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open())
+		return false;
+
+	keyframes.clear();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream stream(line);
+		Keyframe keyframe;
+		if (stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> keyframe.yaw >> keyframe.pitch)
+			addKeyframe(keyframe);
+	}
+
+	return !keyframes.empty();
+}
+
+void CameraPath::addKeyframe(Keyframe keyframe)
+{
+	/* Keep keyframes sorted by time */
+	auto it = keyframes.begin();
+	while (it != keyframes.end() && it->time <= keyframe.time)
+		it++;
+	keyframes.insert(it, keyframe);
+}
+
+CameraPath::Keyframe CameraPath::sample(float time)
+{
+	if (keyframes.size() == 1 || time <= keyframes.front().time)
+		return keyframes.front();
+	if (time >= keyframes.back().time)
+		return keyframes.back();
+
+	/* Segment k1 -> k2, neighbours clamped at the ends */
+	int i = 0;
+	while (keyframes[i + 1].time < time)
+		i++;
+
+	const Keyframe &k0 = keyframes[std::max(i - 1, 0)];
+	const Keyframe &k1 = keyframes[i];
+	const Keyframe &k2 = keyframes[i + 1];
+	const Keyframe &k3 = keyframes[std::min(i + 2, (int)keyframes.size() - 1)];
+
+	float t = (time - k1.time) / (k2.time - k1.time);
+
+	Keyframe result;
+	result.time		  = time;
+	result.position.x = catmullRom(k0.position.x, k1.position.x, k2.position.x, k3.position.x, t);
+	result.position.y = catmullRom(k0.position.y, k1.position.y, k2.position.y, k3.position.y, t);
+	result.position.z = catmullRom(k0.position.z, k1.position.z, k2.position.z, k3.position.z, t);
+	result.yaw		  = catmullRom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, t);
+	result.pitch	  = catmullRom(k0.pitch, k1.pitch, k2.pitch, k3.pitch, t);
+
+	return result;
+}
+
+float CameraPath::getDuration()
+{
+	return keyframes.empty() ? 0.0f : keyframes.back().time - keyframes.front().time;
+}
+
+int CameraPath::getKeyframeCount()
+{
+	return keyframes.size();
+}
+
+float CameraPath::catmullRom(float p0, float p1, float p2, float p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+
+	return 0.5f * ((2.0f * p1) + (-p0 + p2) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+/*
+	Camera spline for scripted fly-throughs.
+	File format - one keyframe per line: time[s] x y z yaw pitch[deg], lines starting with # are comments.
+	Keyframes are interpolated with a Catmull-Rom spline, times outside the path are clamped.
+*/
+class CameraPath
+{
+public:
+    struct Keyframe
+    {
+        float time;
+        glm::vec3 position;
+        float yaw;
+        float pitch;
+    };
+
+    bool load(std::string fileName);
+    void addKeyframe(Keyframe keyframe);
+    Keyframe sample(float time);
+
+    float getDuration();
+    int getKeyframeCount();
+
+protected:
+    static float catmullRom(float p0, float p1, float p2, float p3, float t);
+
+private:
+    std::vector<Keyframe> keyframes;
+};
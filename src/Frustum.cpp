@@ -0,0 +1,54 @@
+#include "Frustum.hpp"
+
+Frustum::Frustum()
+{
+	for (auto &plane : planes)
+		plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum::Frustum(glm::mat4 viewProjection)
+{
+	/* Gribb-Hartmann plane extraction (glm matrices are column major) */
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[3] + rows[2];
+	planes[5] = rows[3] - rows[2];
+
+	for (auto &plane : planes)
+		plane = plane / glm::length(glm::vec3(plane.x, plane.y, plane.z));
+}
+
+Frustum::Result Frustum::testBox(glm::vec3 min, glm::vec3 max)
+{
+	Result result = Result::INSIDE;
+
+	for (auto &plane : planes)
+	{
+		/* Corners furthest along and against the plane normal */
+		glm::vec3 positive(plane.x > 0 ? max.x : min.x, plane.y > 0 ? max.y : min.y, plane.z > 0 ? max.z : min.z);
+		glm::vec3 negative(plane.x > 0 ? min.x : max.x, plane.y > 0 ? min.y : max.y, plane.z > 0 ? min.z : max.z);
+
+		if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), positive) + plane.w < 0)
+			return Result::OUTSIDE;
+		if (glm::dot(glm::vec3(plane.x, plane.y, plane.z), negative) + plane.w < 0)
+			result = Result::INTERSECTS;
+	}
+
+	return result;
+}
+
+bool Frustum::isBoxVisible(glm::vec3 min, glm::vec3 max)
+{
+	return testBox(min, max) != Result::OUTSIDE;
+}
+
+glm::vec4 *Frustum::getPlanes()
+{
+	return planes;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+class Frustum
+{
+public:
+    enum class Result { OUTSIDE, INTERSECTS, INSIDE };
+
+    Frustum();
+    Frustum(glm::mat4 viewProjection);
+
+    Result testBox(glm::vec3 min, glm::vec3 max);
+    bool isBoxVisible(glm::vec3 min, glm::vec3 max);
+    glm::vec4 *getPlanes();
+
+private:
+    /* left, right, bottom, top, near, far - normals point inside */
+    glm::vec4 planes[6];
+};
@@ -0,0 +1,137 @@
+#include "GpuTimer.hpp"
+
+GpuTimer::GpuTimer(std::vector<std::string> passNames, int historyLength, int frameLatency)
+	: passNames{ passNames }, frameLatency{ frameLatency }
+{
+	initializeOpenGLFunctions();
+
+	int passCount = passNames.size();
+
+	queries.assign(frameLatency, std::vector<GLuint>(passCount));
+	issued.assign(frameLatency, std::vector<bool>(passCount, false));
+	pending.assign(frameLatency, false);
+	for (auto &frameQueries : queries)
+		glGenQueries(passCount, frameQueries.data());
+
+	times.assign(passCount, 0.0f);
+	history.assign(passCount, std::vector<float>(historyLength, 0.0f));
+
+	historyOffset = 0;
+	frame		  = 0;
+	recording	  = false;
+}
+
+GpuTimer::~GpuTimer()
+{
+	for (auto &frameQueries : queries)
+		glDeleteQueries(frameQueries.size(), frameQueries.data());
+}
+
+void GpuTimer::beginFrame()
+{
+	frame = (frame + 1) % frameLatency;
+
+	/* The query set about to be reused was issued frameLatency frames ago */
+	if (pending[frame])
+		resolve(frame, recording);
+
+	for (int pass = 0; pass < getPassCount(); pass++)
+		issued[frame][pass] = false;
+}
+
+void GpuTimer::begin(int pass)
+{
+	glBeginQuery(GL_TIME_ELAPSED, queries[frame][pass]);
+}
+
+void GpuTimer::end(int pass)
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	issued[frame][pass] = true;
+	pending[frame]		= true;
+}
+
+void GpuTimer::flush()
+{
+	/* Oldest frame first so records stay in submission order */
+	for (int i = 1; i <= frameLatency; i++)
+	{
+		int frameIndex = (frame + i) % frameLatency;
+		if (pending[frameIndex])
+			resolve(frameIndex, true);
+	}
+}
+
+void GpuTimer::setRecording(bool recording)
+{
+	this->recording = recording;
+	records.clear();
+}
+
+const std::vector<std::vector<float>> &GpuTimer::getRecords()
+{
+	return records;
+}
+
+int GpuTimer::getPassCount()
+{
+	return passNames.size();
+}
+
+const std::string &GpuTimer::getPassName(int pass)
+{
+	return passNames[pass];
+}
+
+float GpuTimer::getTime(int pass)
+{
+	return times[pass];
+}
+
+const std::vector<float> &GpuTimer::getHistory(int pass)
+{
+	return history[pass];
+}
+
+int GpuTimer::getHistoryOffset()
+{
+	return historyOffset;
+}
+
+void GpuTimer::resolve(int frameIndex, bool wait)
+{
+	/* The last issued query finishes last - if it is not ready, keep the previous results */
+	if (!wait)
+	{
+		for (int pass = getPassCount() - 1; pass >= 0; pass--)
+		{
+			if (!issued[frameIndex][pass])
+				continue;
+
+			GLint available = 0;
+			glGetQueryObjectiv(queries[frameIndex][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+			{
+				pending[frameIndex] = false;
+				return;
+			}
+			break;
+		}
+	}
+
+	for (int pass = 0; pass < getPassCount(); pass++)
+	{
+		GLuint64 elapsed = 0;
+		if (issued[frameIndex][pass])
+			glGetQueryObjectui64v(queries[frameIndex][pass], GL_QUERY_RESULT, &elapsed);
+
+		times[pass] = elapsed / 1e6;
+		history[pass][historyOffset] = times[pass];
+	}
+	historyOffset = (historyOffset + 1) % history[0].size();
+
+	if (recording)
+		records.push_back(times);
+
+	pending[frameIndex] = false;
+}
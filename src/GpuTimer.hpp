@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <QOpenGLFunctions_4_5_Core>
+
+/*
+	Per-pass GPU times measured with GL_TIME_ELAPSED queries.
+	Query sets are reused after frameLatency frames, results are only read when available,
+	so the CPU never waits for the GPU (unless recording every frame for the benchmark).
+*/
+class GpuTimer : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    GpuTimer(std::vector<std::string> passNames, int historyLength = 240, int frameLatency = 2);
+    ~GpuTimer();
+
+    void beginFrame();
+    void begin(int pass);
+    void end(int pass);
+
+    /* Resolve all pending frames (blocking), used at the end of a benchmark run */
+    void flush();
+
+    /* Benchmark mode - keep the results of every frame, waits for them if needed */
+    void setRecording(bool recording);
+    const std::vector<std::vector<float>> &getRecords();
+
+    int getPassCount();
+    const std::string &getPassName(int pass);
+    float getTime(int pass);                        // ms, last resolved frame
+    const std::vector<float> &getHistory(int pass); // ms, rolling buffer
+    int getHistoryOffset();                         // oldest value in the rolling buffer
+
+protected:
+    void resolve(int frameIndex, bool wait);
+
+private:
+    std::vector<std::string> passNames;
+    std::vector<std::vector<GLuint>> queries;   // [frame][pass]
+    std::vector<std::vector<bool>> issued;      // [frame][pass]
+    std::vector<bool> pending;                  // [frame]
+    std::vector<float> times;
+    std::vector<std::vector<float>> history;
+    std::vector<std::vector<float>> records;
+    int historyOffset;
+    int frameLatency;
+    int frame;
+    bool recording;
+};
@@ -1,21 +1,22 @@
 #include "GrassField.hpp"
 
-GrassField::GrassField(float fieldSize, float patchSize, int grassBladeCount, BladeDimensions bladeDimensions)
-	: fieldSize{ fieldSize }, patchSize{ patchSize }, grassBladeCount{ grassBladeCount }
+GrassField::GrassField(float fieldSize, float patchSize, int grassBladeCount, BladeDimensions bladeDimensions, unsigned int seed, int threadCount)
+	: fieldSize{ fieldSize }, patchSize{ patchSize }, grassBladeCount{ grassBladeCount }, seed{ seed }, bladeDimensions{ bladeDimensions }
 {
 	worldCenterPos = { 0.0f, 0.0f, 0.0f };
-	patchCount = pow(fieldSize / patchSize, 2);
+	patchCount = pow((int)(fieldSize / patchSize), 2);	// whole patches only, matches generatePatchPositions
+	randomKey = Random::key(seed);
 	generatePatchPositions();
-	generateGrassGeometry(bladeDimensions);
+	patchHeights.assign(patchCount, glm::vec2(0.0f, 1.0f));
+	patchQuadtree = new PatchQuadtree(patchPositions, fieldSize / patchSize, patchSize);
+	generateGrassGeometry(bladeDimensions, threadCount);
 }
 
 GrassField::~GrassField()
 {
+	delete patchQuadtree;
 	delete patchPositions;
-	delete grassVertexPositions;
-	delete grassCenterPositions;
-	delete grassTextureCoords;
-	delete grassRandoms;
+	delete bladeStore;
 }
 
 int GrassField::getFieldSize()
@@ -23,6 +24,16 @@ int GrassField::getFieldSize()
 	return fieldSize;
 }
 
+float GrassField::getPatchSize()
+{
+	return patchSize;
+}
+
+GrassField::BladeDimensions GrassField::getBladeDimensions()
+{
+	return bladeDimensions;
+}
+
 int GrassField::getGrassBladeCount()
 {
 	return grassBladeCount;
@@ -33,29 +44,87 @@ int GrassField::getPatchCount()
 	return patchCount;
 }
 
-std::vector<glm::vec3> *GrassField::getPatchPositions()
+unsigned int GrassField::getSeed()
 {
-	return patchPositions;
+	return seed;
+}
+
+double GrassField::getGenerationTime()
+{
+	return generationTime;
+}
+
+float GrassField::getPatchReach(float maxBendingFactor)
+{
+	/* Blade tips leave the patch by at most the bending offset, the wind offset (see grassVS) and half of the blade width */
+	return (2.0f * maxBendingFactor + 1.0f) + 3.0f + bladeDimensions.wMax / 2;
+}
+
+void GrassField::setHeightField(const HeightField &heightField)
+{
+	/* Blade roots stay within the patch square, the reach only moves the tips sideways */
+	for (int i = 0; i < patchCount; i++)
+	{
+		glm::vec3 center = patchPositions->at(i);
+		glm::vec2 a((center.x - patchSize / 2 + fieldSize / 2) / fieldSize, 1.0f - (center.z - patchSize / 2 + fieldSize / 2) / fieldSize);
+		glm::vec2 b((center.x + patchSize / 2 + fieldSize / 2) / fieldSize, 1.0f - (center.z + patchSize / 2 + fieldSize / 2) / fieldSize);
+		a = glm::clamp(a, glm::vec2(0.01f), glm::vec2(0.99f));
+		b = glm::clamp(b, glm::vec2(0.01f), glm::vec2(0.99f));
+		patchHeights[i] = heightField.getHeightRange(glm::min(a, b), glm::max(a, b));
+	}
+
+	patchQuadtree->setPatchHeights(patchHeights);
+}
+
+glm::vec2 GrassField::getPatchHeightRange(int patchIndex, float maxTerrainHeight)
+{
+	return maxTerrainHeight * patchHeights[patchIndex] + glm::vec2(0.0f, bladeDimensions.hMax);
+}
+
+void GrassField::getPatchBounds(int patchIndex, float maxTerrainHeight, float maxBendingFactor, glm::vec3 &min, glm::vec3 &max)
+{
+	float reach = getPatchReach(maxBendingFactor);
+	glm::vec2 heightRange = getPatchHeightRange(patchIndex, maxTerrainHeight);
+	glm::vec3 center = patchPositions->at(patchIndex);
+
+	min = glm::vec3(center.x - patchSize / 2 - reach, heightRange.x, center.z - patchSize / 2 - reach);
+	max = glm::vec3(center.x + patchSize / 2 + reach, heightRange.y, center.z + patchSize / 2 + reach);
 }
 
-std::vector<glm::vec4> *GrassField::getGrassVertexPositions()
+int GrassField::cullPatches(Frustum &frustum, glm::vec3 cameraPos, float maxDistance, float maxTerrainHeight, float maxBendingFactor, int *visiblePatches)
 {
-	return grassVertexPositions;
+	/* Flat scan over all patches - test bounds against the view frustum and max. distance */
+	glm::vec3 min, max;
+	int count = 0;
+
+	for (int i = 0; i < patchCount; i++)
+	{
+		getPatchBounds(i, maxTerrainHeight, maxBendingFactor, min, max);
+
+		glm::vec3 nearest = glm::clamp(cameraPos, min, max);
+		if (glm::length(nearest - cameraPos) > maxDistance)
+			continue;
+
+		if (frustum.isBoxVisible(min, max))
+			visiblePatches[count++] = i;
+	}
+
+	return count;
 }
 
-std::vector<glm::vec4> *GrassField::getGrassCenterPositions()
+PatchQuadtree *GrassField::getPatchQuadtree()
 {
-	return grassCenterPositions;
+	return patchQuadtree;
 }
 
-std::vector<glm::vec4> *GrassField::getGrassTextureCoords()
+std::vector<glm::vec3> *GrassField::getPatchPositions()
 {
-	return grassTextureCoords;
+	return patchPositions;
 }
 
-std::vector<glm::vec4> *GrassField::getGrassRandoms()
+BladeStore *GrassField::getBladeStore()
 {
-	return grassRandoms;
+	return bladeStore;
 }
 
 std::shared_ptr<ge::gl::Buffer> GrassField::getPatchTransSSBO()
@@ -75,69 +144,97 @@ std::shared_ptr<ge::gl::Buffer> GrassField::getPatchTransSSBO()
 	return patchTransSSBO;
 }
 
-std::shared_ptr<ge::gl::Buffer> GrassField::getPatchRandomsSSBO()
+std::vector<int> GrassField::getPatchRandoms()
 {
-	std::shared_ptr<ge::gl::Buffer> patchRandomsSSBO;
 	std::vector<int> patchRandoms;
 
+	/* Patch randoms use their own key so they are independent of the blade randoms */
+	uint32_t patchKey = Random::key(seed, 1);
 	for (size_t i = 0; i < patchCount; i++)
 	{
-		int random = rand();
+		int random = Random::bits(Random::counterState(patchKey, i), 0) >> 1;	// non-negative
 		patchRandoms.push_back(random);
 	}
 
+	return patchRandoms;
+}
+
+std::shared_ptr<ge::gl::Buffer> GrassField::getPatchRandomsSSBO()
+{
+	std::shared_ptr<ge::gl::Buffer> patchRandomsSSBO;
+	std::vector<int> patchRandoms = getPatchRandoms();
+
 	patchRandomsSSBO = std::make_shared<ge::gl::Buffer>(patchRandoms.size() * sizeof(int), patchRandoms.data());
 	return patchRandomsSSBO;
 }
 
-std::shared_ptr<ge::gl::Buffer> GrassField::getGrassVertexBuffer()
+std::shared_ptr<ge::gl::Buffer> GrassField::getPatchIndicesSSBO()
 {
-	std::shared_ptr<ge::gl::Buffer> grassVertexBuffer;
-	grassVertexBuffer = std::make_shared<ge::gl::Buffer>(grassVertexPositions->size() * sizeof(float) * 4, grassVertexPositions->data());
+	/* Identity list of patch indices, used when all patches are drawn */
+	std::shared_ptr<ge::gl::Buffer> patchIndicesSSBO;
+	std::vector<int> patchIndices(patchCount);
+
+	for (size_t i = 0; i < patchCount; i++)
+		patchIndices[i] = i;
 
-	return grassVertexBuffer;
+	patchIndicesSSBO = std::make_shared<ge::gl::Buffer>(std::max<size_t>(1, patchIndices.size()) * sizeof(int), patchIndices.data());
+	return patchIndicesSSBO;
 }
 
-std::shared_ptr<ge::gl::Buffer> GrassField::getGrassCenterBuffer()
+std::shared_ptr<ge::gl::Buffer> GrassField::getGrassBladeBuffer()
 {
-	std::shared_ptr<ge::gl::Buffer> grassCenterBuffer;
-	grassCenterBuffer = std::make_shared<ge::gl::Buffer>(grassCenterPositions->size() * sizeof(float) * 4, grassCenterPositions->data());
+	std::shared_ptr<ge::gl::Buffer> grassBladeBuffer;
+	std::vector<Blade> grassBlades = interleaveBlades();
+
+	grassBladeBuffer = std::make_shared<ge::gl::Buffer>(grassBlades.size() * sizeof(Blade), grassBlades.data());
 
-	return grassCenterBuffer;
+	return grassBladeBuffer;
 }
 
-std::shared_ptr<ge::gl::Buffer> GrassField::getGrassTexCoordBuffer()
+std::shared_ptr<ge::gl::VertexArray> GrassField::getGrassVAO()
 {
-	std::shared_ptr<ge::gl::Buffer> grassTexCoordBuffer;
-	grassTexCoordBuffer = std::make_shared<ge::gl::Buffer>(grassTextureCoords->size() * sizeof(float) * 4, grassTextureCoords->data());
+	/* Blade corners are reconstructed from gl_VertexID in the vertex shader, no attributes are needed */
+	std::shared_ptr<ge::gl::VertexArray> grassVAO;
+	grassVAO = std::make_shared<ge::gl::VertexArray>();
 
-	return grassTexCoordBuffer;
+	return grassVAO;
 }
 
-std::shared_ptr<ge::gl::Buffer> GrassField::getGrassRandomsBuffer()
+std::shared_ptr<ge::gl::VertexArray> GrassField::getBladeAttributeVAO(int verticesPerBlade)
 {
-	std::shared_ptr<ge::gl::Buffer> grassRandomsBuffer;
-	grassRandomsBuffer = std::make_shared<ge::gl::Buffer>(grassRandoms->size() * sizeof(float) * 4, grassRandoms->data());
+	/* Attribute fetch variant of the strip path - every strip vertex gets its own copy of the blade record */
+	std::shared_ptr<ge::gl::VertexArray> bladeAttributeVAO;
+	std::vector<Blade> grassBlades = interleaveBlades();
+	std::vector<Blade> bladeAttributes;
+	bladeAttributes.reserve(grassBlades.size() * verticesPerBlade);
+
+	for (size_t i = 0; i < grassBlades.size(); i++)
+		bladeAttributes.insert(bladeAttributes.end(), verticesPerBlade, grassBlades[i]);
+
+	std::shared_ptr<ge::gl::Buffer> bladeAttributeBuffer;
+	bladeAttributeBuffer = std::make_shared<ge::gl::Buffer>(std::max<size_t>(1, bladeAttributes.size()) * sizeof(Blade), bladeAttributes.data());
 
-	return grassRandomsBuffer;
+	bladeAttributeVAO = std::make_shared<ge::gl::VertexArray>();
+	bladeAttributeVAO->addAttrib(bladeAttributeBuffer, 0, 4, GL_FLOAT, sizeof(Blade), offsetof(Blade, placement));
+	bladeAttributeVAO->addAttrib(bladeAttributeBuffer, 1, 4, GL_FLOAT, sizeof(Blade), offsetof(Blade, randoms0));
+	bladeAttributeVAO->addAttrib(bladeAttributeBuffer, 2, 4, GL_FLOAT, sizeof(Blade), offsetof(Blade, randoms1));
+
+	return bladeAttributeVAO;
 }
 
-std::shared_ptr<ge::gl::VertexArray> GrassField::getGrassVAO()
+std::vector<GrassField::Blade> GrassField::interleaveBlades()
 {
-	std::shared_ptr<ge::gl::VertexArray> grassVAO;
-	grassVAO = std::make_shared<ge::gl::VertexArray>();
+	std::vector<Blade> grassBlades(bladeStore->size());
 
-	std::shared_ptr<ge::gl::Buffer> grassPositionBuffer = getGrassVertexBuffer();
-	std::shared_ptr<ge::gl::Buffer> grassCenterPositionBuffer = getGrassCenterBuffer();
-	std::shared_ptr<ge::gl::Buffer> grassTexCoordBuffer = getGrassTexCoordBuffer();
-	std::shared_ptr<ge::gl::Buffer> grassRandomsBuffer = getGrassRandomsBuffer();
-
-	grassVAO->addAttrib(grassPositionBuffer, 0, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassCenterPositionBuffer, 1, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassTexCoordBuffer, 2, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassRandomsBuffer, 3, 4, GL_FLOAT);
+	/* Interleave the blade store into the GPU layout */
+	for (size_t i = 0; i < grassBlades.size(); i++)
+	{
+		grassBlades[i].placement = glm::vec4(bladeStore->x[i], bladeStore->z[i], bladeStore->width[i], bladeStore->height[i]);
+		grassBlades[i].randoms0  = glm::vec4(bladeStore->angle[i], bladeStore->randoms[0][i], bladeStore->randoms[1][i], bladeStore->randoms[2][i]);
+		grassBlades[i].randoms1  = glm::vec4(bladeStore->randoms[3][i], bladeStore->randoms[4][i], bladeStore->randoms[5][i], bladeStore->randoms[6][i]);
+	}
 
-	return grassVAO;
+	return grassBlades;
 }
 
 void GrassField::generatePatchPositions()
@@ -158,83 +255,33 @@ void GrassField::generatePatchPositions()
 	}
 }
 
-void GrassField::generateRandoms()
+void GrassField::generateGrassGeometry(BladeDimensions bladeDimensions, int threadCount)
 {
-	/* Rendering pipeline random values */
-	randoms[0] = glm::linearRand(0.00f, 360.0f);	// angle
-	randoms[1] = glm::linearRand(-1.00f, 1.00f);	// x offset
-	randoms[2] = glm::linearRand(-1.00f, 1.00f);	// z offset
-	randoms[3] = glm::linearRand(-0.25f, 0.25f);	// TCS
-	randoms[4] = glm::linearRand(0.75f, 1.25f);		// TCS
-	randoms[5] = glm::linearRand(0.00f, 0.05f);		// R
-	randoms[6] = glm::linearRand(0.00f, 0.05f);		// G
-	randoms[7] = glm::linearRand(0.00f, 0.05f);		// B
+	auto start = std::chrono::high_resolution_clock::now();
 
-	/* Values for blade generation */
-	randoms[8]  = glm::linearRand(0.0f, 1.0f);						// w, h
-	randoms[9]  = glm::linearRand(-patchSize / 2, patchSize / 2);	// x offset
-	randoms[10] = glm::linearRand(-patchSize / 2, patchSize / 2);	// z offset
-}
+	bladeStore = new BladeStore();
+	bladeStore->resize(grassBladeCount);
+	BladeGenerator::Parameters parameters{ randomKey, patchSize, bladeDimensions.wMin, bladeDimensions.wMax, bladeDimensions.hMin, bladeDimensions.hMax };
 
-void GrassField::generateGrassGeometry(BladeDimensions bladeDimensions)
-{
-	grassVertexPositions = new std::vector<glm::vec4>();
-	grassCenterPositions = new std::vector<glm::vec4>();
-	grassTextureCoords   = new std::vector<glm::vec4>();
-	grassRandoms		 = new std::vector<glm::vec4>();
-	srand(time(0));	// reset generator seed
+	if (threadCount <= 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::max(1, std::min(threadCount, grassBladeCount));
 
-	for (size_t i = 0; i < grassBladeCount; i++)
+	/* Every thread fills its own contiguous range of blades, ranges are multiples of 8 to keep the SIMD kernel busy */
+	std::vector<std::thread> threads;
+	size_t bladesPerThread = (grassBladeCount + threadCount - 1) / threadCount;
+	bladesPerThread = (bladesPerThread + 7) / 8 * 8;
+	for (int i = 1; i < threadCount; i++)
 	{
-		generateRandoms();
-
-		float w =  bladeDimensions.wMin + randoms[8] * (bladeDimensions.wMax - bladeDimensions.wMin);
-		float h = (bladeDimensions.hMin + randoms[8] * (bladeDimensions.hMax - bladeDimensions.hMin));
-
-		glm::vec4 pc{ 0.0f, 0.0f, 0.0f, 1.0f };	// bottom center
-
-		/* Grass blade vertices */
-		glm::vec4 p1 = pc + glm::vec4(-0.5f * w, 0.0f, 0.0f, 0.0f);
-		glm::vec4 p2 = pc + glm::vec4( 0.5f * w, 0.0f, 0.0f, 0.0f);
-		glm::vec4 p3 = pc + glm::vec4( 0.5f * w,	h, 0.0f, 0.0f);
-		glm::vec4 p4 = pc + glm::vec4(-0.5f * w,	h, 0.0f, 0.0f);
-
-		/* Move within a patch */
-		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(randoms[9], 0.0f, randoms[10]));
-		p1 = model * p1;
-		p2 = model * p2;
-		p3 = model * p3;
-		p4 = model * p4;
-		pc = model * pc;
-
-		/* Add random value (x,y,z,r0) */
-		p1.w = randoms[0];
-		p2.w = randoms[0];
-		p3.w = randoms[0];
-		p4.w = randoms[0];
-
-		/* Add to list */
-		grassVertexPositions->push_back(p1);
-		grassVertexPositions->push_back(p2);
-		grassVertexPositions->push_back(p3);
-		grassVertexPositions->push_back(p4);
-
-		/* Blade's center positions (x,y,z,r1) */
-		grassCenterPositions->push_back(glm::vec4(pc.x, 0.0f, pc.z, randoms[1]));
-		grassCenterPositions->push_back(glm::vec4(pc.x, 0.0f, pc.z, randoms[1]));
-		grassCenterPositions->push_back(glm::vec4(pc.x, 1.0f, pc.z, randoms[1]));
-		grassCenterPositions->push_back(glm::vec4(pc.x, 1.0f, pc.z, randoms[1]));
-
-		/* Blade's texture coordinates (s,t,r2,r3) */
-		grassTextureCoords->push_back(glm::vec4(0.0f, 0.0f, randoms[2], randoms[3]));
-		grassTextureCoords->push_back(glm::vec4(1.0f, 0.0f, randoms[2], randoms[3]));
-		grassTextureCoords->push_back(glm::vec4(1.0f, 1.0f, randoms[2], randoms[3]));
-		grassTextureCoords->push_back(glm::vec4(0.0f, 1.0f, randoms[2], randoms[3]));
-
-		/* Additional random values */
-		grassRandoms->push_back(glm::vec4(randoms[4], randoms[5], randoms[6], randoms[7]));
-		grassRandoms->push_back(glm::vec4(randoms[4], randoms[5], randoms[6], randoms[7]));
-		grassRandoms->push_back(glm::vec4(randoms[4], randoms[5], randoms[6], randoms[7]));
-		grassRandoms->push_back(glm::vec4(randoms[4], randoms[5], randoms[6], randoms[7]));
+		size_t first = std::min<size_t>(i * bladesPerThread, grassBladeCount);
+		size_t last  = std::min<size_t>(first + bladesPerThread, grassBladeCount);
+		threads.emplace_back(BladeGenerator::generate, std::ref(*bladeStore), first, last, parameters);
 	}
+	BladeGenerator::generate(*bladeStore, 0, std::min<size_t>(bladesPerThread, grassBladeCount), parameters);
+
+	for (auto &thread : threads)
+		thread.join();
+
+	auto end = std::chrono::high_resolution_clock::now();
+	generationTime = std::chrono::duration<double, std::milli>(end - start).count();
 }
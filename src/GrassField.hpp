@@ -1,8 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <algorithm>
 #include <iostream>
 #include <vector>
+#include <thread>
+#include <chrono>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,6 +15,10 @@
 #include <geGL/geGL.h>
 
 #include "Terrain.hpp"
+#include "Random.hpp"
+#include "BladeGenerator.hpp"
+#include "Frustum.hpp"
+#include "PatchQuadtree.hpp"
 
 
 class GrassField
@@ -25,44 +32,65 @@ public:
         float hMax;
     };
 
-    GrassField(float fieldSize, float patchSize, int grassBladeCount, BladeDimensions bladeDimensions);
+    /* GPU per-blade record shared by all four corners of the blade (std430 compatible) */
+    struct Blade
+    {
+        glm::vec4 placement;    // x offset, z offset, width, height
+        glm::vec4 randoms0;     // r0 (angle), r1, r2, r3
+        glm::vec4 randoms1;     // r4, r5, r6, r7
+    };
+
+    /* threadCount = 0 uses all hardware threads, the result does not depend on the thread count */
+    GrassField(float fieldSize, float patchSize, int grassBladeCount, BladeDimensions bladeDimensions, unsigned int seed = 0, int threadCount = 0);
     ~GrassField();
 
     int getFieldSize();
+    float getPatchSize();
+    BladeDimensions getBladeDimensions();
     int getGrassBladeCount();
     int getPatchCount();
+    unsigned int getSeed();
+    double getGenerationTime();
+    float getPatchReach(float maxBendingFactor);
+
+    /* Terrain heights (0 - 1) under every patch square from the height field pyramid, mapped over the field like grassBlade.glsl.
+       Without a height field the patches span the whole terrain height. */
+    void setHeightField(const HeightField &heightField);
+    glm::vec2 getPatchHeightRange(int patchIndex, float maxTerrainHeight);     // world y of the blade roots and tips
+    void getPatchBounds(int patchIndex, float maxTerrainHeight, float maxBendingFactor, glm::vec3 &min, glm::vec3 &max);
+    int cullPatches(Frustum &frustum, glm::vec3 cameraPos, float maxDistance, float maxTerrainHeight, float maxBendingFactor, int *visiblePatches);
+    PatchQuadtree *getPatchQuadtree();
 
 
     std::vector<glm::vec3> *getPatchPositions();
-    std::vector<glm::vec4> *getGrassVertexPositions();
-    std::vector<glm::vec4> *getGrassCenterPositions();
-    std::vector<glm::vec4> *getGrassTextureCoords();
-    std::vector<glm::vec4> *getGrassRandoms();
+    BladeStore *getBladeStore();
+    std::vector<int> getPatchRandoms();     // patch rotation (random % 4 quarter turns), contents of getPatchRandomsSSBO
 
     std::shared_ptr<ge::gl::Buffer> getPatchTransSSBO();
     std::shared_ptr<ge::gl::Buffer> getPatchRandomsSSBO();
-    std::shared_ptr<ge::gl::Buffer> getGrassVertexBuffer();
-    std::shared_ptr<ge::gl::Buffer> getGrassCenterBuffer();
-    std::shared_ptr<ge::gl::Buffer> getGrassTexCoordBuffer();
-    std::shared_ptr<ge::gl::Buffer> getGrassRandomsBuffer();
+    std::shared_ptr<ge::gl::Buffer> getPatchIndicesSSBO();
+    std::shared_ptr<ge::gl::Buffer> getGrassBladeBuffer();
     std::shared_ptr<ge::gl::VertexArray> getGrassVAO();
+    std::shared_ptr<ge::gl::VertexArray> getBladeAttributeVAO(int verticesPerBlade);
 
 protected:
     void generatePatchPositions();
-    void generateRandoms();
-    void generateGrassGeometry(BladeDimensions bladeDimensions);
+    void generateGrassGeometry(BladeDimensions bladeDimensions, int threadCount);
+    std::vector<Blade> interleaveBlades();
 
 private:
     float fieldSize;
     float patchSize;
-    float randoms[11];
     int grassBladeCount;
     int patchCount;
+    unsigned int seed;
+    uint32_t randomKey;
+    BladeDimensions bladeDimensions;
+    double generationTime;
     glm::vec3 worldCenterPos;
 
     std::vector<glm::vec3> *patchPositions;
-    std::vector<glm::vec4> *grassVertexPositions;
-    std::vector<glm::vec4> *grassCenterPositions;
-    std::vector<glm::vec4> *grassTextureCoords;
-    std::vector<glm::vec4> *grassRandoms;
+    std::vector<glm::vec2> patchHeights;    // terrain height range 0 - 1 per patch
+    PatchQuadtree *patchQuadtree;
+    BladeStore *bladeStore;
 };
\ No newline at end of file
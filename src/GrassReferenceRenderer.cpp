@@ -0,0 +1,632 @@
+#include "GrassReferenceRenderer.hpp"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+	#include <immintrin.h>
+#endif
+
+namespace
+{
+	const float pi = 3.1415926535897932384626433832795f;
+
+	/* GLSL packUnorm2x16 */
+	inline uint32_t packUnorm2x16(float x, float y)
+	{
+		uint32_t packedX = (uint32_t)std::round(std::clamp(x, 0.0f, 1.0f) * 65535.0f);
+		uint32_t packedY = (uint32_t)std::round(std::clamp(y, 0.0f, 1.0f) * 65535.0f);
+		return packedX | (packedY << 16);
+	}
+
+	/* calculateControlPoint in grassSpline.glsl */
+	inline glm::vec3 controlPoint(glm::vec3 lower, glm::vec3 upper, float r3, float r4)
+	{
+		return glm::vec3(lower.x * r3 + upper.x * (1.0f - r3), lower.y * r4 + upper.y * (1.0f - r4), lower.z * r3 + upper.z * (1.0f - r3));
+	}
+
+	/* calculateSplinePosition in grassSpline.glsl */
+	inline glm::vec3 splinePosition(glm::vec3 pb, glm::vec3 h, glm::vec3 pt, float v, glm::vec3 &tangent)
+	{
+		glm::vec3 a = pb + v * (h - pb);
+		glm::vec3 b = h + v * (pt - h);
+		tangent = (b - a) / glm::length(b - a);
+		return a + v * (b - a);
+	}
+
+	/* w() in grassBlade.glsl, p.y is not used */
+	inline float windWave(float x, float z, glm::vec3 windParams)
+	{
+		float c1 = windParams.x;
+		float c2 = 2.0f;
+		float c3 = windParams.y;
+		float a = pi * x + 10.0f * (windParams.z + 1.0f) + (pi / 4) / (std::abs(std::cos(c2 * pi * z)) + 0.00001f);
+		return std::sin(c1 * a) * std::cos(c3 * a);
+	}
+
+#if defined(__AVX2__)
+	/* 8 lanes */
+	struct Lanes
+	{
+		using I = __m256i;
+		using F = __m256;
+		static constexpr int count = 8;
+
+		static I set1(int v)							{ return _mm256_set1_epi32(v); }
+		static I add(I a, I b)							{ return _mm256_add_epi32(a, b); }
+		static I mul(I a, I b)							{ return _mm256_mullo_epi32(a, b); }
+		static I min(I a, I b)							{ return _mm256_min_epi32(a, b); }
+		static I max(I a, I b)							{ return _mm256_max_epi32(a, b); }
+		static I bitAnd(I a, I b)						{ return _mm256_and_si256(a, b); }
+		static F equal(I a, I b)						{ return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)); }
+		static I toInt(F a)								{ return _mm256_cvttps_epi32(a); }
+		static F gather(const float *p, I indices)		{ return _mm256_i32gather_ps(p, indices, 4); }
+
+		static F set1f(float v)							{ return _mm256_set1_ps(v); }
+		static F load(const float *p)					{ return _mm256_loadu_ps(p); }
+		static void store(float *p, F v)				{ _mm256_storeu_ps(p, v); }
+		static F addf(F a, F b)							{ return _mm256_add_ps(a, b); }
+		static F subf(F a, F b)							{ return _mm256_sub_ps(a, b); }
+		static F mulf(F a, F b)							{ return _mm256_mul_ps(a, b); }
+		static F divf(F a, F b)							{ return _mm256_div_ps(a, b); }
+		static F minf(F a, F b)							{ return _mm256_min_ps(a, b); }
+		static F maxf(F a, F b)							{ return _mm256_max_ps(a, b); }
+		static F sqrt(F a)								{ return _mm256_sqrt_ps(a); }
+		static F abs(F a)								{ return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+		static F floor(F a)								{ return _mm256_floor_ps(a); }
+		static F ceil(F a)								{ return _mm256_ceil_ps(a); }
+		static F round(F a)								{ return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static F greater(F a, F b)						{ return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static F lessEqual(F a, F b)					{ return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static F maskOr(F a, F b)						{ return _mm256_or_ps(a, b); }
+		static F select(F mask, F a, F b)				{ return _mm256_blendv_ps(b, a, mask); }
+	};
+#elif defined(__SSE4_1__)
+	/* 4 lanes */
+	struct Lanes
+	{
+		using I = __m128i;
+		using F = __m128;
+		static constexpr int count = 4;
+
+		static I set1(int v)							{ return _mm_set1_epi32(v); }
+		static I add(I a, I b)							{ return _mm_add_epi32(a, b); }
+		static I mul(I a, I b)							{ return _mm_mullo_epi32(a, b); }
+		static I min(I a, I b)							{ return _mm_min_epi32(a, b); }
+		static I max(I a, I b)							{ return _mm_max_epi32(a, b); }
+		static I bitAnd(I a, I b)						{ return _mm_and_si128(a, b); }
+		static F equal(I a, I b)						{ return _mm_castsi128_ps(_mm_cmpeq_epi32(a, b)); }
+		static I toInt(F a)								{ return _mm_cvttps_epi32(a); }
+		static F gather(const float *p, I indices)		{ return _mm_setr_ps(p[_mm_extract_epi32(indices, 0)], p[_mm_extract_epi32(indices, 1)],
+																			 p[_mm_extract_epi32(indices, 2)], p[_mm_extract_epi32(indices, 3)]); }
+
+		static F set1f(float v)							{ return _mm_set1_ps(v); }
+		static F load(const float *p)					{ return _mm_loadu_ps(p); }
+		static void store(float *p, F v)				{ _mm_storeu_ps(p, v); }
+		static F addf(F a, F b)							{ return _mm_add_ps(a, b); }
+		static F subf(F a, F b)							{ return _mm_sub_ps(a, b); }
+		static F mulf(F a, F b)							{ return _mm_mul_ps(a, b); }
+		static F divf(F a, F b)							{ return _mm_div_ps(a, b); }
+		static F minf(F a, F b)							{ return _mm_min_ps(a, b); }
+		static F maxf(F a, F b)							{ return _mm_max_ps(a, b); }
+		static F sqrt(F a)								{ return _mm_sqrt_ps(a); }
+		static F abs(F a)								{ return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+		static F floor(F a)								{ return _mm_floor_ps(a); }
+		static F ceil(F a)								{ return _mm_ceil_ps(a); }
+		static F round(F a)								{ return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+		static F greater(F a, F b)						{ return _mm_cmpgt_ps(a, b); }
+		static F lessEqual(F a, F b)					{ return _mm_cmple_ps(a, b); }
+		static F maskOr(F a, F b)						{ return _mm_or_ps(a, b); }
+		static F select(F mask, F a, F b)				{ return _mm_blendv_ps(b, a, mask); }
+	};
+#endif
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+	using F = Lanes::F;
+	using I = Lanes::I;
+
+	/* sin(x + quadrants * pi/2) - Cody-Waite reduction to [-pi/4, pi/4] and the Cephes sinf/cosf polynomials */
+	inline F sinQuadrant(F x, int quadrants)
+	{
+		F j = Lanes::round(Lanes::mulf(x, Lanes::set1f(2.0f / pi)));
+		I q = Lanes::add(Lanes::toInt(j), Lanes::set1(quadrants));
+
+		F r = Lanes::subf(x, Lanes::mulf(j, Lanes::set1f(1.5703125f)));
+		r = Lanes::subf(r, Lanes::mulf(j, Lanes::set1f(4.837512969970703125e-4f)));
+		r = Lanes::subf(r, Lanes::mulf(j, Lanes::set1f(7.54978995489188216e-8f)));
+		F r2 = Lanes::mulf(r, r);
+
+		F sinPolynomial = Lanes::addf(Lanes::mulf(Lanes::set1f(-1.9515295891e-4f), r2), Lanes::set1f(8.3321608736e-3f));
+		sinPolynomial = Lanes::addf(Lanes::mulf(sinPolynomial, r2), Lanes::set1f(-1.6666654611e-1f));
+		sinPolynomial = Lanes::addf(Lanes::mulf(Lanes::mulf(sinPolynomial, r2), r), r);
+
+		F cosPolynomial = Lanes::addf(Lanes::mulf(Lanes::set1f(2.443315711809948e-5f), r2), Lanes::set1f(-1.388731625493765e-3f));
+		cosPolynomial = Lanes::addf(Lanes::mulf(cosPolynomial, r2), Lanes::set1f(4.166664568298827e-2f));
+		cosPolynomial = Lanes::mulf(Lanes::mulf(cosPolynomial, r2), r2);
+		cosPolynomial = Lanes::addf(Lanes::subf(Lanes::set1f(1.0f), Lanes::mulf(Lanes::set1f(0.5f), r2)), cosPolynomial);
+
+		F odd	   = Lanes::equal(Lanes::bitAnd(q, Lanes::set1(1)), Lanes::set1(1));
+		F negative = Lanes::equal(Lanes::bitAnd(q, Lanes::set1(2)), Lanes::set1(2));
+		F result   = Lanes::select(odd, cosPolynomial, sinPolynomial);
+		return Lanes::select(negative, Lanes::subf(Lanes::set1f(0.0f), result), result);
+	}
+
+	inline F sin(F x) { return sinQuadrant(x, 0); }
+	inline F cos(F x) { return sinQuadrant(x, 1); }
+
+	/* Texel indices and weights of a HeightField::sample */
+	struct Bilinear
+	{
+		I texel00, texel01, texel10, texel11;
+		F fx, fy;
+	};
+
+	inline Bilinear bilinear(F u, F v, int width, int height)
+	{
+		Bilinear result;
+		F x = Lanes::subf(Lanes::mulf(u, Lanes::set1f((float)width)), Lanes::set1f(0.5f));
+		F y = Lanes::subf(Lanes::mulf(v, Lanes::set1f((float)height)), Lanes::set1f(0.5f));
+		F x0 = Lanes::floor(x);
+		F y0 = Lanes::floor(y);
+		result.fx = Lanes::subf(x, x0);
+		result.fy = Lanes::subf(y, y0);
+
+		I zero = Lanes::set1(0);
+		I column0 = Lanes::toInt(x0);
+		I row0	  = Lanes::toInt(y0);
+		I column1 = Lanes::min(Lanes::max(Lanes::add(column0, Lanes::set1(1)), zero), Lanes::set1(width - 1));
+		I row1	  = Lanes::min(Lanes::max(Lanes::add(row0, Lanes::set1(1)), zero), Lanes::set1(height - 1));
+		column0 = Lanes::min(Lanes::max(column0, zero), Lanes::set1(width - 1));
+		row0	= Lanes::min(Lanes::max(row0, zero), Lanes::set1(height - 1));
+		row0 = Lanes::mul(row0, Lanes::set1(width));
+		row1 = Lanes::mul(row1, Lanes::set1(width));
+
+		result.texel00 = Lanes::add(row0, column0);
+		result.texel01 = Lanes::add(row0, column1);
+		result.texel10 = Lanes::add(row1, column0);
+		result.texel11 = Lanes::add(row1, column1);
+		return result;
+	}
+
+	inline F sample(const float *texels, const Bilinear &b)
+	{
+		F t00 = Lanes::gather(texels, b.texel00);
+		F t01 = Lanes::gather(texels, b.texel01);
+		F t10 = Lanes::gather(texels, b.texel10);
+		F t11 = Lanes::gather(texels, b.texel11);
+		F bottom = Lanes::addf(t00, Lanes::mulf(b.fx, Lanes::subf(t01, t00)));
+		F top	 = Lanes::addf(t10, Lanes::mulf(b.fx, Lanes::subf(t11, t10)));
+		return Lanes::addf(bottom, Lanes::mulf(b.fy, Lanes::subf(top, bottom)));
+	}
+#endif
+}
+
+void GrassReferenceRenderer::Corners::resize(size_t count)
+{
+	for (int c = 0; c < 4; c++)
+	{
+		x[c].resize(count);
+		y[c].resize(count);
+		z[c].resize(count);
+	}
+	level.resize(count);
+}
+
+GrassReferenceRenderer::GrassReferenceRenderer(GrassField *grassField, const HeightField *heightField)
+	: grassField{ grassField }, heightField{ heightField }
+{
+	patchRandoms = grassField->getPatchRandoms();
+
+	/* The rotation of a blade around its center does not depend on the patch */
+	const BladeStore &store = *grassField->getBladeStore();
+	cosAngle.resize(store.size());
+	sinAngle.resize(store.size());
+	for (size_t i = 0; i < store.size(); i++)
+	{
+		cosAngle[i] = std::cos(glm::radians(store.angle[i]));
+		sinAngle[i] = std::sin(glm::radians(store.angle[i]));
+	}
+}
+
+const std::vector<GrassReferenceRenderer::Vertex> &GrassReferenceRenderer::render(const int *patches, int patchCount, const Parameters &parameters, int threadCount, bool simd)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (threadCount <= 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = std::max(1, std::min(threadCount, patchCount));
+
+	threadVertices.resize(threadCount);
+	threadCorners.resize(threadCount);
+	std::vector<int> threadBladeCounts(threadCount, 0);
+
+	/* Every thread renders a contiguous range of the patch list into its own strips */
+	std::vector<std::thread> threads;
+	int patchesPerThread = (patchCount + threadCount - 1) / threadCount;
+	for (int i = 1; i < threadCount; i++)
+	{
+		int first = std::min(i * patchesPerThread, patchCount);
+		int last  = std::min(first + patchesPerThread, patchCount);
+		threads.emplace_back(&GrassReferenceRenderer::renderPatches, this, patches + first, last - first, std::cref(parameters), simd,
+							 std::ref(threadCorners[i]), std::ref(threadVertices[i]), std::ref(threadBladeCounts[i]));
+	}
+	renderPatches(patches, std::min(patchesPerThread, patchCount), parameters, simd, threadCorners[0], threadVertices[0], threadBladeCounts[0]);
+
+	for (auto &thread : threads)
+		thread.join();
+
+	/* Joined in list order, the result does not depend on the thread count */
+	vertices.clear();
+	bladeCount = 0;
+	for (int i = 0; i < threadCount; i++)
+	{
+		vertices.insert(vertices.end(), threadVertices[i].begin(), threadVertices[i].end());
+		bladeCount += threadBladeCounts[i];
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	renderTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+	return vertices;
+}
+
+int GrassReferenceRenderer::getBladeCount()
+{
+	return bladeCount;
+}
+
+int GrassReferenceRenderer::getTriangleCount()
+{
+	/* 2 * (level + 1) + 2 vertices and 2 * level triangles per blade */
+	return vertices.size() - 4 * bladeCount;
+}
+
+double GrassReferenceRenderer::getRenderTime()
+{
+	return renderTime;
+}
+
+std::vector<glm::vec3> GrassReferenceRenderer::getTriangles()
+{
+	std::vector<glm::vec3> triangles;
+	triangles.reserve(3 * getTriangleCount());
+
+	/* Every blade strip has an even vertex count, so the strip parity is the same for all blades */
+	for (size_t i = 2; i < vertices.size(); i++)
+	{
+		glm::vec3 a = vertices[i - 2].position;
+		glm::vec3 b = vertices[i - 1].position;
+		glm::vec3 c = vertices[i].position;
+		if (a == b || b == c || a == c)
+			continue;	// joins between blades
+
+		if (i % 2)
+			std::swap(a, b);
+		triangles.push_back(a);
+		triangles.push_back(b);
+		triangles.push_back(c);
+	}
+
+	return triangles;
+}
+
+GrassReferenceRenderer::Comparison GrassReferenceRenderer::compare(const std::vector<Vertex> &reference, const std::vector<Vertex> &vertices)
+{
+	Comparison result{ (int)reference.size(), (int)vertices.size(), 0, 0.0f, false };
+
+	/* Reference vertices in a hash grid with TOLERANCE cells, one grid per blade index */
+	auto cellKey = [](int bladeIndex, glm::ivec3 cell)
+	{
+		uint64_t key = (uint64_t)(uint32_t)bladeIndex * 0x9e3779b97f4a7c15ULL;
+		key ^= ((uint64_t)(cell.x & 0xfffff) << 40) | ((uint64_t)(cell.y & 0xfffff) << 20) | (uint64_t)(cell.z & 0xfffff);
+		return key;
+	};
+	auto cellOf = [](glm::vec3 position) { return glm::ivec3(glm::floor(position / TOLERANCE)); };
+
+	std::unordered_map<uint64_t, std::vector<int>> grid;
+	for (size_t i = 0; i < reference.size(); i++)
+		grid[cellKey(reference[i].bladeIndex, cellOf(reference[i].position))].push_back(i);
+
+	for (const Vertex &vertex : vertices)
+	{
+		glm::ivec3 cell = cellOf(vertex.position);
+		float nearest = INFINITY;
+
+		for (int dz = -1; dz <= 1; dz++)
+			for (int dy = -1; dy <= 1; dy++)
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					auto found = grid.find(cellKey(vertex.bladeIndex, cell + glm::ivec3(dx, dy, dz)));
+					if (found == grid.end())
+						continue;
+					for (int i : found->second)
+					{
+						if (reference[i].bladeIndex == vertex.bladeIndex)
+							nearest = std::min(nearest, glm::length(reference[i].position - vertex.position));
+					}
+				}
+
+		if (nearest <= TOLERANCE)
+		{
+			result.matchedVertexCount++;
+			result.maxError = std::max(result.maxError, nearest);
+		}
+	}
+
+	int larger = std::max(result.referenceVertexCount, result.vertexCount);
+	result.passed = result.matchedVertexCount >= MATCHED_FRACTION * larger;
+	return result;
+}
+
+const char *GrassReferenceRenderer::getKernelName()
+{
+#if defined(__AVX2__)
+	return "AVX2";
+#elif defined(__SSE4_1__)
+	return "SSE4.1";
+#else
+	return "scalar";
+#endif
+}
+
+void GrassReferenceRenderer::renderPatches(const int *patches, int patchCount, const Parameters &parameters, bool simd, Corners &corners, std::vector<Vertex> &vertices, int &bladeCount)
+{
+	size_t bladesPerPatch = grassField->getGrassBladeCount();
+	corners.resize(bladesPerPatch);
+	vertices.clear();
+	bladeCount = 0;
+
+	for (int i = 0; i < patchCount; i++)
+	{
+		size_t first = simd ? transformBladesSimd(patches[i], 0, bladesPerPatch, parameters, corners) : 0;
+		transformBladesScalar(patches[i], first, bladesPerPatch, parameters, corners);
+		emitStrips(corners, vertices, bladeCount);
+	}
+}
+
+void GrassReferenceRenderer::getPatchFrame(int patchIndex, glm::vec3 &translation, float &cosPatch, float &sinPatch)
+{
+	/* Quarter turns of the patch, evaluated like rotate() in grassBlade.glsl */
+	float patchAngle = glm::radians((float)((patchRandoms[patchIndex] % 4) * 90));
+	translation = grassField->getPatchPositions()->at(patchIndex);
+	cosPatch = std::cos(patchAngle);
+	sinPatch = std::sin(patchAngle);
+}
+
+size_t GrassReferenceRenderer::transformBladesSimd(int patchIndex, size_t first, size_t last, const Parameters &parameters, Corners &corners)
+{
+#if defined(__AVX2__) || defined(__SSE4_1__)
+	const BladeStore &store = *grassField->getBladeStore();
+	glm::vec3 patch;
+	float cosPatch, sinPatch;
+	getPatchFrame(patchIndex, patch, cosPatch, sinPatch);
+
+	const float fieldSize = grassField->getFieldSize();
+	const F zero = Lanes::set1f(0.0f);
+	const F one	 = Lanes::set1f(1.0f);
+	const F half = Lanes::set1f(0.5f);
+	const F patchX = Lanes::set1f(patch.x);
+	const F patchY = Lanes::set1f(patch.y);
+	const F patchZ = Lanes::set1f(patch.z);
+	const F patchCos = Lanes::set1f(cosPatch);
+	const F patchSin = Lanes::set1f(sinPatch);
+	const F maxBendingFactor = Lanes::set1f(parameters.maxBendingFactor);
+
+	size_t i = first;
+	for (; i + Lanes::count <= last; i += Lanes::count)
+	{
+		F x = Lanes::load(&store.x[i]);
+		F z = Lanes::load(&store.z[i]);
+		F width	 = Lanes::load(&store.width[i]);
+		F height = Lanes::load(&store.height[i]);
+		F r1 = Lanes::load(&store.randoms[0][i]);
+		F r2 = Lanes::load(&store.randoms[1][i]);
+		F angleCos = Lanes::load(&cosAngle[i]);
+		F angleSin = Lanes::load(&sinAngle[i]);
+
+		/* Blade center rotated with the patch */
+		F centerX = Lanes::subf(Lanes::mulf(x, patchCos), Lanes::mulf(z, patchSin));
+		F centerZ = Lanes::addf(Lanes::mulf(x, patchSin), Lanes::mulf(z, patchCos));
+		F centerWorldX = Lanes::addf(patchX, centerX);
+		F centerWorldZ = Lanes::addf(patchZ, centerZ);
+
+		/* Height map */
+		F u = Lanes::divf(Lanes::addf(centerWorldX, Lanes::set1f(fieldSize / 2)), Lanes::set1f(fieldSize));
+		F v = Lanes::subf(one, Lanes::divf(Lanes::addf(centerWorldZ, Lanes::set1f(fieldSize / 2)), Lanes::set1f(fieldSize)));
+		u = Lanes::minf(Lanes::maxf(u, Lanes::set1f(0.01f)), Lanes::set1f(0.99f));
+		v = Lanes::minf(Lanes::maxf(v, Lanes::set1f(0.01f)), Lanes::set1f(0.99f));
+		Bilinear texels = bilinear(u, v, heightField->getWidth(), heightField->getHeight());
+		F density = sample(heightField->getChannel(0), texels);
+		F size	  = sample(heightField->getChannel(1), texels);
+		F terrainHeight = Lanes::mulf(Lanes::set1f(parameters.maxTerrainHeight), Lanes::subf(one, sample(heightField->getChannel(2), texels)));
+		F inverseSize = Lanes::subf(one, size);
+
+		F discard = Lanes::greater(Lanes::addf(Lanes::abs(r1), Lanes::subf(one, density)), one);
+		discard = Lanes::maskOr(discard, Lanes::lessEqual(size, Lanes::set1f(0.1f)));
+
+		/* Bending and wind of the upper corners */
+		F offsetX = Lanes::mulf(size, Lanes::subf(Lanes::mulf(maxBendingFactor, Lanes::mulf(Lanes::set1f(2.0f), r1)), one));
+		F offsetZ = Lanes::mulf(size, Lanes::subf(Lanes::mulf(maxBendingFactor, Lanes::mulf(Lanes::set1f(2.0f), r2)), one));
+		F windX = zero, windZ = zero, wave = zero;
+		if (parameters.windEnabled)
+		{
+			F phase = Lanes::addf(Lanes::addf(centerWorldX, Lanes::addf(patchY, one)), centerWorldZ);
+			windX = Lanes::addf(sin(Lanes::mulf(Lanes::set1f(0.03f), Lanes::addf(phase, Lanes::set1f((float)(parameters.time / 30))))), one);
+			windZ = Lanes::addf(Lanes::mulf(half, sin(Lanes::mulf(Lanes::set1f(0.03f), Lanes::addf(phase, Lanes::set1f((float)(parameters.time / 100)))))), half);
+
+			F a = Lanes::addf(Lanes::mulf(Lanes::set1f(pi), centerWorldX), Lanes::set1f(10.0f * (parameters.windParams.z + 1.0f)));
+			a = Lanes::addf(a, Lanes::divf(Lanes::set1f(pi / 4), Lanes::addf(Lanes::abs(cos(Lanes::mulf(Lanes::set1f(2.0f * pi), centerWorldZ))), Lanes::set1f(0.00001f))));
+			wave = Lanes::mulf(sin(Lanes::mulf(Lanes::set1f(parameters.windParams.x), a)), cos(Lanes::mulf(Lanes::set1f(parameters.windParams.y), a)));
+		}
+
+		for (int c = 0; c < 4; c++)
+		{
+			float s = (c == 1 || c == 2) ? 1.0f : 0.0f;
+			bool upper = c >= 2;
+
+			/* Corner rotated with the patch and then around the blade center */
+			F cornerX = Lanes::addf(x, Lanes::mulf(Lanes::set1f(s - 0.5f), width));
+			F rotatedX = Lanes::subf(Lanes::mulf(cornerX, patchCos), Lanes::mulf(z, patchSin));
+			F rotatedZ = Lanes::addf(Lanes::mulf(cornerX, patchSin), Lanes::mulf(z, patchCos));
+			F dx = Lanes::subf(rotatedX, centerX);
+			F dz = Lanes::subf(rotatedZ, centerZ);
+			F newX = Lanes::subf(Lanes::addf(centerX, Lanes::mulf(dx, angleCos)), Lanes::mulf(dz, angleSin));
+			F newZ = Lanes::addf(Lanes::addf(centerZ, Lanes::mulf(dx, angleSin)), Lanes::mulf(dz, angleCos));
+			F newY = Lanes::addf(upper ? height : zero, terrainHeight);
+
+			/* Blade size from the height map */
+			newX = Lanes::addf(newX, Lanes::mulf(Lanes::subf(centerX, newX), inverseSize));
+			newZ = Lanes::addf(newZ, Lanes::mulf(Lanes::subf(centerZ, newZ), inverseSize));
+			if (upper)
+			{
+				newY = Lanes::subf(newY, Lanes::mulf(inverseSize, Lanes::subf(newY, terrainHeight)));
+				newX = Lanes::addf(newX, offsetX);
+				newZ = Lanes::addf(newZ, offsetZ);
+				if (parameters.windEnabled)
+				{
+					newX = Lanes::addf(newX, Lanes::mulf(size, windX));
+					newZ = Lanes::addf(newZ, Lanes::mulf(size, windZ));
+					newX = Lanes::addf(newX, Lanes::mulf(size, wave));
+					newZ = Lanes::addf(newZ, Lanes::mulf(size, wave));
+				}
+			}
+
+			Lanes::store(&corners.x[c][i], Lanes::addf(newX, patchX));
+			Lanes::store(&corners.y[c][i], Lanes::addf(newY, patchY));
+			Lanes::store(&corners.z[c][i], Lanes::addf(newZ, patchZ));
+		}
+
+		/* Tessellation level from the bottom left corner (calculateTessellationLevel) */
+		F dx = Lanes::subf(Lanes::load(&corners.x[0][i]), Lanes::set1f(parameters.cameraPos.x));
+		F dy = Lanes::subf(Lanes::load(&corners.y[0][i]), Lanes::set1f(parameters.cameraPos.y));
+		F dz = Lanes::subf(Lanes::load(&corners.z[0][i]), Lanes::set1f(parameters.cameraPos.z));
+		F relativeDistance = Lanes::divf(Lanes::sqrt(Lanes::addf(Lanes::addf(Lanes::mulf(dx, dx), Lanes::mulf(dy, dy)), Lanes::mulf(dz, dz))), Lanes::set1f(parameters.maxDistance));
+		F level = Lanes::ceil(Lanes::mulf(Lanes::set1f((float)parameters.maxTessLevel), Lanes::subf(one, relativeDistance)));
+		discard = Lanes::maskOr(discard, Lanes::greater(Lanes::addf(Lanes::abs(r1), relativeDistance), one));
+		Lanes::store(&corners.level[i], Lanes::maxf(Lanes::select(discard, zero, level), zero));
+	}
+
+	return i;
+#else
+	return first;
+#endif
+}
+
+void GrassReferenceRenderer::transformBladesScalar(int patchIndex, size_t first, size_t last, const Parameters &parameters, Corners &corners)
+{
+	/* Same operations in the same order as computeBladeVertex in grassBlade.glsl */
+	const BladeStore &store = *grassField->getBladeStore();
+	glm::vec3 patch;
+	float cosPatch, sinPatch;
+	getPatchFrame(patchIndex, patch, cosPatch, sinPatch);
+	const float fieldSize = grassField->getFieldSize();
+
+	for (size_t i = first; i < last; i++)
+	{
+		/* Blade center rotated with the patch */
+		float centerX = store.x[i] * cosPatch - store.z[i] * sinPatch;
+		float centerZ = store.x[i] * sinPatch + store.z[i] * cosPatch;
+		float centerWorldX = patch.x + centerX;
+		float centerWorldZ = patch.z + centerZ;
+
+		/* Height map */
+		float u = std::clamp((centerWorldX + fieldSize / 2) / fieldSize, 0.01f, 0.99f);
+		float v = std::clamp(1 - ((centerWorldZ + fieldSize / 2) / fieldSize), 0.01f, 0.99f);
+		glm::vec4 heightSample = heightField->sample(glm::vec2(u, v));
+		float terrainHeight = parameters.maxTerrainHeight * (1 - heightSample.b);
+		bool discard = std::abs(store.randoms[0][i]) + (1 - heightSample.r) > 1 || !(heightSample.g > 0.1f);
+
+		/* Bending and wind of the upper corners */
+		float offsetX = heightSample.g * (parameters.maxBendingFactor * (2 * store.randoms[0][i]) - 1.0f);
+		float offsetZ = heightSample.g * (parameters.maxBendingFactor * (2 * store.randoms[1][i]) - 1.0f);
+		float windX = 0.0f, windZ = 0.0f, wave = 0.0f;
+		if (parameters.windEnabled)
+		{
+			float phase = centerWorldX + (patch.y + 1.0f) + centerWorldZ;
+			windX = (1.0f * std::sin(0.03f * (phase + parameters.time / 30))) + 1.0f;	// integer division as in GLSL
+			windZ = (0.5f * std::sin(0.03f * (phase + parameters.time / 100))) + 0.5f;
+			wave = windWave(centerWorldX, centerWorldZ, parameters.windParams);
+		}
+
+		for (int c = 0; c < 4; c++)
+		{
+			float s = (c == 1 || c == 2) ? 1.0f : 0.0f;
+			bool upper = c >= 2;
+
+			/* Corner rotated with the patch and then around the blade center */
+			float cornerX = store.x[i] + (s - 0.5f) * store.width[i];
+			float rotatedX = cornerX * cosPatch - store.z[i] * sinPatch;
+			float rotatedZ = cornerX * sinPatch + store.z[i] * cosPatch;
+			float newX = centerX + (rotatedX - centerX) * cosAngle[i] - (rotatedZ - centerZ) * sinAngle[i];
+			float newZ = centerZ + (rotatedX - centerX) * sinAngle[i] + (rotatedZ - centerZ) * cosAngle[i];
+			float newY = (upper ? store.height[i] : 0.0f) + terrainHeight;
+
+			/* Blade size from the height map */
+			newX = newX + (centerX - newX) * (1 - heightSample.g);
+			newZ = newZ + (centerZ - newZ) * (1 - heightSample.g);
+			if (upper)
+			{
+				newY = newY - ((1 - heightSample.g) * (newY - terrainHeight));
+				newX = newX + offsetX;
+				newZ = newZ + offsetZ;
+				if (parameters.windEnabled)
+				{
+					newX = newX + heightSample.g * windX;
+					newZ = newZ + heightSample.g * windZ;
+					newX = newX + heightSample.g * wave;
+					newZ = newZ + heightSample.g * wave;
+				}
+			}
+
+			corners.x[c][i] = newX + patch.x;
+			corners.y[c][i] = newY + patch.y;
+			corners.z[c][i] = newZ + patch.z;
+		}
+
+		/* Tessellation level from the bottom left corner (calculateTessellationLevel) */
+		glm::vec3 position(corners.x[0][i], corners.y[0][i], corners.z[0][i]);
+		float relativeDistance = glm::length(position - parameters.cameraPos) / parameters.maxDistance;
+		float level = std::ceil(parameters.maxTessLevel * (1 - relativeDistance));
+		if (discard || std::abs(store.randoms[0][i]) + relativeDistance > 1)
+			level = 0.0f;
+		corners.level[i] = std::max(level, 0.0f);
+	}
+}
+
+void GrassReferenceRenderer::emitStrips(const Corners &corners, std::vector<Vertex> &vertices, int &bladeCount)
+{
+	/* Rows of grassExpandCS - left and right edge at v = row / level, the first and last vertex are duplicated for the joins */
+	const BladeStore &store = *grassField->getBladeStore();
+
+	for (size_t i = 0; i < corners.level.size(); i++)
+	{
+		int level = (int)corners.level[i];
+		if (level <= 0)
+			continue;
+
+		glm::vec3 p[4];
+		for (int c = 0; c < 4; c++)
+			p[c] = glm::vec3(corners.x[c][i], corners.y[c][i], corners.z[c][i]);
+
+		/* r3 = texCoord.w, r4 = randoms.x */
+		glm::vec3 leftControlPoint	= controlPoint(p[3], p[0], store.randoms[2][i], store.randoms[3][i]);
+		glm::vec3 rightControlPoint = controlPoint(p[2], p[1], store.randoms[2][i], store.randoms[3][i]);
+
+		for (int row = 0; row <= level; row++)
+		{
+			float v = (float)row / (float)level;
+			glm::vec3 leftTangent, rightTangent;
+			glm::vec3 left	= splinePosition(p[0], leftControlPoint, p[3], v, leftTangent);
+			glm::vec3 right = splinePosition(p[1], rightControlPoint, p[2], v, rightTangent);
+
+			glm::vec3 bitangent = right - left;
+			Vertex leftVertex{ left, packUnorm2x16(0.0f, v), glm::normalize(glm::cross(leftTangent, bitangent)), (int)i };
+			Vertex rightVertex{ right, packUnorm2x16(1.0f, v), glm::normalize(glm::cross(rightTangent, bitangent)), (int)i };
+
+			if (row == 0)
+				vertices.push_back(leftVertex);
+			vertices.push_back(leftVertex);
+			vertices.push_back(rightVertex);
+			if (row == level)
+				vertices.push_back(rightVertex);
+		}
+		bladeCount++;
+	}
+}
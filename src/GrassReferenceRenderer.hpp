@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "GrassField.hpp"
+#include "HeightField.hpp"
+
+/*
+	CPU reference of the near blade chain: blade corners (grassBlade.glsl - patch rotation, height map,
+	bending, wind), tessellation level and control points (grassTCS) and the De Casteljau rows (grassTES).
+	The output are the joined triangle strips grassExpandCS writes, so the two can be compared directly.
+	Blades are transformed by the SIMD kernel (AVX2 - 8, SSE4.1 - 4 blades per iteration), patches are
+	split between threads. The blade simulation is not part of the reference, blades use the analytic wind.
+*/
+class GrassReferenceRenderer
+{
+public:
+    /* The FrameUniforms the blades depend on */
+    struct Parameters
+    {
+        glm::vec3 cameraPos;
+        float maxDistance;
+        int maxTessLevel;
+        float maxBendingFactor;
+        float maxTerrainHeight;
+        bool windEnabled;
+        glm::vec3 windParams;
+        int time;               // ms
+    };
+
+    /* Mirrors ExpandedVertex in shaders/grassExpanded.glsl */
+    struct Vertex
+    {
+        glm::vec3 position;
+        uint32_t texCoord;      // packUnorm2x16
+        glm::vec3 normal;
+        int bladeIndex;
+    };
+
+    struct Comparison
+    {
+        int referenceVertexCount;
+        int vertexCount;
+        int matchedVertexCount; // closer than TOLERANCE to a reference vertex of the same blade
+        float maxError;         // of the matched vertices
+        bool passed;
+    };
+
+    static constexpr float TOLERANCE = 1e-2f;           // world units - texture filtering precision, GPU sin/cos
+    static constexpr float MATCHED_FRACTION = 0.999f;   // blades on a tessellation level or discard boundary may differ
+
+    GrassReferenceRenderer(GrassField *grassField, const HeightField *heightField);
+
+    /* Strips of the listed patches in list order. threadCount = 0 uses all hardware threads, simd = false runs the scalar kernel. */
+    const std::vector<Vertex> &render(const int *patches, int patchCount, const Parameters &parameters, int threadCount = 0, bool simd = true);
+
+    /* Of the last render */
+    int getBladeCount();
+    int getTriangleCount();     // without the degenerate joins
+    double getRenderTime();     // ms
+    std::vector<glm::vec3> getTriangles();
+
+    /* Order independent - GPU strips are appended in work group order */
+    static Comparison compare(const std::vector<Vertex> &reference, const std::vector<Vertex> &vertices);
+    static const char *getKernelName();
+
+    /* Blade corners of one patch, structure of arrays */
+    struct Corners
+    {
+        std::vector<float> x[4];
+        std::vector<float> y[4];
+        std::vector<float> z[4];
+        std::vector<float> level;
+
+        void resize(size_t count);
+    };
+
+protected:
+    void renderPatches(const int *patches, int patchCount, const Parameters &parameters, bool simd, Corners &corners, std::vector<Vertex> &vertices, int &bladeCount);
+    void getPatchFrame(int patchIndex, glm::vec3 &translation, float &cosPatch, float &sinPatch);
+    size_t transformBladesSimd(int patchIndex, size_t first, size_t last, const Parameters &parameters, Corners &corners);   // returns the first blade left
+    void transformBladesScalar(int patchIndex, size_t first, size_t last, const Parameters &parameters, Corners &corners);
+    void emitStrips(const Corners &corners, std::vector<Vertex> &vertices, int &bladeCount);
+
+private:
+    GrassField *grassField;
+    const HeightField *heightField;
+    std::vector<int> patchRandoms;
+    std::vector<float> cosAngle;    // per blade rotation around its center (r0), same for all patches
+    std::vector<float> sinAngle;
+
+    std::vector<Vertex> vertices;
+    std::vector<std::vector<Vertex>> threadVertices;
+    std::vector<Corners> threadCorners;
+    int bladeCount = 0;
+    double renderTime = 0.0;
+};
@@ -0,0 +1,206 @@
+#include "HeightField.hpp"
+
+HeightField::HeightField(const QImage &image)
+{
+	/* Same 8-bit values as the RGBA8 texture QOpenGLTexture creates from the image */
+	QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+	width  = std::max(1, rgba.width());
+	height = std::max(1, rgba.height());
+
+	for (auto &channel : channels)
+		channel.assign(width * height, 0.0f);
+
+	for (int y = 0; y < rgba.height(); y++)
+	{
+		const uchar *row = rgba.constScanLine(y);
+		for (int x = 0; x < rgba.width(); x++)
+		{
+			for (int c = 0; c < 4; c++)
+				channels[c][y * width + x] = row[4 * x + c] / 255.0f;
+		}
+	}
+
+	heights.resize(width * height);
+	for (int i = 0; i < width * height; i++)
+		heights[i] = 1.0f - channels[2][i];
+
+	/* Central differences, one-sided on the border */
+	gradients.resize(width * height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int left  = std::max(x - 1, 0);
+			int right = std::min(x + 1, width - 1);
+			int below = std::max(y - 1, 0);
+			int above = std::min(y + 1, height - 1);
+			float du = std::max(right - left, 1) / (float)width;
+			float dv = std::max(above - below, 1) / (float)height;
+			gradients[y * width + x] = glm::vec2((heights[y * width + right] - heights[y * width + left]) / du,
+												 (heights[above * width + x] - heights[below * width + x]) / dv);
+		}
+	}
+
+	generatePyramid();
+}
+
+int HeightField::getWidth() const
+{
+	return width;
+}
+
+int HeightField::getHeight() const
+{
+	return height;
+}
+
+glm::vec4 HeightField::sample(glm::vec2 coords) const
+{
+	/* Texel centers are at (i + 0.5) / size */
+	float x = coords.x * width - 0.5f;
+	float y = coords.y * height - 0.5f;
+	float x0 = std::floor(x);
+	float y0 = std::floor(y);
+	float fx = x - x0;
+	float fy = y - y0;
+
+	int column0 = std::clamp((int)x0, 0, width - 1);
+	int column1 = std::clamp((int)x0 + 1, 0, width - 1);
+	int row0 = std::clamp((int)y0, 0, height - 1) * width;
+	int row1 = std::clamp((int)y0 + 1, 0, height - 1) * width;
+
+	glm::vec4 result;
+	for (int c = 0; c < 4; c++)
+	{
+		const float *texels = channels[c].data();
+		float bottom = texels[row0 + column0] + fx * (texels[row0 + column1] - texels[row0 + column0]);
+		float top	 = texels[row1 + column0] + fx * (texels[row1 + column1] - texels[row1 + column0]);
+		result[c] = bottom + fy * (top - bottom);
+	}
+
+	return result;
+}
+
+const float *HeightField::getChannel(int channel) const
+{
+	return channels[channel].data();
+}
+
+float HeightField::sampleHeight(glm::vec2 coords) const
+{
+	return bilinear(heights, coords);
+}
+
+glm::vec2 HeightField::sampleGradient(glm::vec2 coords) const
+{
+	return bilinear(gradients, coords);
+}
+
+glm::vec2 HeightField::getHeightRange(glm::vec2 minCoords, glm::vec2 maxCoords) const
+{
+	/* Texels the bilinear filter reads anywhere in the rectangle */
+	int x0 = std::clamp((int)std::floor(minCoords.x * width - 0.5f), 0, width - 1);
+	int y0 = std::clamp((int)std::floor(minCoords.y * height - 0.5f), 0, height - 1);
+	int x1 = std::clamp((int)std::floor(maxCoords.x * width - 0.5f) + 1, 0, width - 1);
+	int y1 = std::clamp((int)std::floor(maxCoords.y * height - 0.5f) + 1, 0, height - 1);
+
+	/* Tiles at least as large as the texel span - the span touches at most 2 x 2 of them */
+	int span = std::max(x1 - x0, y1 - y0) + 1;
+	int level = 0;
+	while ((TILE_SIZE << level) < span && level < (int)pyramid.size() - 1)
+		level++;
+
+	const PyramidLevel &tiles = pyramid[level];
+	int tileSize = TILE_SIZE << level;
+	glm::vec2 range(FLT_MAX, -FLT_MAX);
+	for (int y = y0 / tileSize; y <= y1 / tileSize; y++)
+	{
+		for (int x = x0 / tileSize; x <= x1 / tileSize; x++)
+		{
+			glm::vec2 tile = tiles.ranges[y * tiles.width + x];
+			range = glm::vec2(std::min(range.x, tile.x), std::max(range.y, tile.y));
+		}
+	}
+
+	return range;
+}
+
+const std::vector<HeightField::PyramidLevel> &HeightField::getPyramid() const
+{
+	return pyramid;
+}
+
+void HeightField::setTerrainSize(float terrainWidth, float terrainLength, float maxTerrainHeight)
+{
+	this->terrainWidth	   = terrainWidth;
+	this->terrainLength	   = terrainLength;
+	this->maxTerrainHeight = maxTerrainHeight;
+}
+
+float HeightField::getTerrainHeight(glm::vec2 position) const
+{
+	return maxTerrainHeight * sampleHeight(toCoords(position));
+}
+
+glm::vec3 HeightField::getTerrainNormal(glm::vec2 position) const
+{
+	/* x grows with s, z against t */
+	glm::vec2 gradient = sampleGradient(toCoords(position));
+	float dx =	maxTerrainHeight * gradient.x / terrainWidth;
+	float dz = -maxTerrainHeight * gradient.y / terrainLength;
+	return glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+}
+
+glm::vec2 HeightField::getTerrainHeightRange(glm::vec2 min, glm::vec2 max) const
+{
+	glm::vec2 a = toCoords(min);
+	glm::vec2 b = toCoords(max);
+	return maxTerrainHeight * getHeightRange(glm::min(a, b), glm::max(a, b));
+}
+
+void HeightField::generatePyramid()
+{
+	pyramid.clear();
+
+	PyramidLevel level;
+	level.width	 = (width + TILE_SIZE - 1) / TILE_SIZE;
+	level.height = (height + TILE_SIZE - 1) / TILE_SIZE;
+	level.ranges.assign(level.width * level.height, glm::vec2(FLT_MAX, -FLT_MAX));
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			glm::vec2 &range = level.ranges[(y / TILE_SIZE) * level.width + x / TILE_SIZE];
+			float value = heights[y * width + x];
+			range = glm::vec2(std::min(range.x, value), std::max(range.y, value));
+		}
+	}
+	pyramid.push_back(level);
+
+	/* 2 x 2 reduction down to a single tile */
+	while (pyramid.back().width > 1 || pyramid.back().height > 1)
+	{
+		const PyramidLevel &finer = pyramid.back();
+		PyramidLevel coarser;
+		coarser.width  = (finer.width + 1) / 2;
+		coarser.height = (finer.height + 1) / 2;
+		coarser.ranges.assign(coarser.width * coarser.height, glm::vec2(FLT_MAX, -FLT_MAX));
+		for (int y = 0; y < finer.height; y++)
+		{
+			for (int x = 0; x < finer.width; x++)
+			{
+				glm::vec2 &range = coarser.ranges[(y / 2) * coarser.width + x / 2];
+				glm::vec2 tile = finer.ranges[y * finer.width + x];
+				range = glm::vec2(std::min(range.x, tile.x), std::max(range.y, tile.y));
+			}
+		}
+		pyramid.push_back(std::move(coarser));
+	}
+}
+
+glm::vec2 HeightField::toCoords(glm::vec2 position) const
+{
+	float s =		 (position.x + terrainWidth	 / 2) / terrainWidth;
+	float t = 1.0f - (position.y + terrainLength / 2) / terrainLength;
+	return glm::clamp(glm::vec2(s, t), glm::vec2(0.01f), glm::vec2(0.99f));
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#include <QImage>
+
+#include <glm/glm.hpp>
+
+/*
+	CPU copy of the height map texture (uHeightMap) for code that runs without a GL context.
+	Channels: r - blade density, g - blade size, b - inverted terrain height.
+	sample() filters like the texture (GL_LINEAR, GL_CLAMP_TO_EDGE, base level).
+	For culling, LOD and the camera it also keeps the terrain height (1 - b) with its per-texel gradients and a min/max
+	pyramid over tiles of TILE_SIZE^2 texels, and maps world positions like terrainHeight.glsl once setTerrainSize is called.
+*/
+class HeightField
+{
+public:
+    /* image as uploaded to the texture, i.e. already mirrored - row 0 is t = 0 */
+    HeightField(const QImage &image);
+
+    int getWidth() const;
+    int getHeight() const;
+    glm::vec4 sample(glm::vec2 coords) const;
+
+    /* Texel channel in row-major order, values 0 - 1 */
+    const float *getChannel(int channel) const;
+
+    static constexpr int TILE_SIZE = 8;     // texels per side of a tile of the finest pyramid level
+
+    /* Level l + 1 halves level l (rounded up), a tile of level l covers TILE_SIZE << l texels per side */
+    struct PyramidLevel
+    {
+        int width;
+        int height;
+        std::vector<glm::vec2> ranges;      // min, max per tile
+    };
+
+    /* Terrain height 0 - 1 and its derivatives by coords (central differences), both filtered like sample() */
+    float sampleHeight(glm::vec2 coords) const;
+    glm::vec2 sampleGradient(glm::vec2 coords) const;
+
+    /* Min and max of the filtered height over a coords rectangle, conservative to whole pyramid tiles. O(1) - read from
+       the finest level whose tiles are at least as large as the rectangle, where it touches at most 2 x 2 tiles.
+       shaders/heightPyramid.glsl does the same on the GPU. */
+    glm::vec2 getHeightRange(glm::vec2 minCoords, glm::vec2 maxCoords) const;
+    const std::vector<PyramidLevel> &getPyramid() const;
+
+    /* World space, same mapping and clamping as terrainHeight.glsl */
+    void setTerrainSize(float terrainWidth, float terrainLength, float maxTerrainHeight);
+    float getTerrainHeight(glm::vec2 position) const;                       // xz
+    glm::vec3 getTerrainNormal(glm::vec2 position) const;
+    glm::vec2 getTerrainHeightRange(glm::vec2 min, glm::vec2 max) const;    // xz rectangle
+
+protected:
+    void generatePyramid();
+    glm::vec2 toCoords(glm::vec2 position) const;
+
+    template<typename T>
+    T bilinear(const std::vector<T> &texels, glm::vec2 coords) const;
+
+private:
+    int width;
+    int height;
+    std::vector<float> channels[4];
+
+    std::vector<float> heights;             // 1 - b
+    std::vector<glm::vec2> gradients;       // d height / d coords
+    std::vector<PyramidLevel> pyramid;
+
+    float terrainWidth = 1.0f;
+    float terrainLength = 1.0f;
+    float maxTerrainHeight = 1.0f;
+};
+
+template<typename T>
+T HeightField::bilinear(const std::vector<T> &texels, glm::vec2 coords) const
+{
+	/* Texel centers are at (i + 0.5) / size */
+	float x = coords.x * width - 0.5f;
+	float y = coords.y * height - 0.5f;
+	float x0 = std::floor(x);
+	float y0 = std::floor(y);
+	float fx = x - x0;
+	float fy = y - y0;
+
+	int column0 = std::clamp((int)x0, 0, width - 1);
+	int column1 = std::clamp((int)x0 + 1, 0, width - 1);
+	int row0 = std::clamp((int)y0, 0, height - 1) * width;
+	int row1 = std::clamp((int)y0 + 1, 0, height - 1) * width;
+
+	T bottom = texels[row0 + column0] + fx * (texels[row0 + column1] - texels[row0 + column0]);
+	T top	 = texels[row1 + column0] + fx * (texels[row1 + column1] - texels[row1 + column0]);
+	return bottom + fy * (top - bottom);
+}
@@ -1,8 +1,10 @@
 #include "OpenGLWindow.hpp"
 
-OpenGLWindow::OpenGLWindow()
-	: QOpenGLWidget()
+OpenGLWindow::OpenGLWindow(bool headless)
+	: QOpenGLWidget(), headless{ headless }
 {
+	guiEnabled = !headless;
+
 	/* Create camera */
 	camera = new Camera(glm::vec3(0.0f, 125.0f, 230.0f), 45, (float)width() / (float)height(), 0.1f, 1000.0f);
 	camera->rotateCamera(900.0f, -270.0f);	// reset rotation
@@ -11,12 +13,27 @@ OpenGLWindow::OpenGLWindow()
 	GrassField::BladeDimensions bladeDimensions{0.1, 0.3, 1.0, 5.0};
 	grassField = std::make_shared<GrassField>(200.0f, 8.0f, 700, bladeDimensions);
 	terrain = std::make_shared<Terrain>(200.0f, 200.0f, 100, 100);
+
+	/* CPU copy of the height map texture, loaded here so the reference renderer works without GL */
+	heightField = std::make_unique<HeightField>(QImage("../res/height_map.png").mirrored());
+	grassField->setHeightField(*heightField);
 }
 
 OpenGLWindow::~OpenGLWindow()
 {
 	makeCurrent();
 	delete camera;
+	frameRing.reset();
+	gpuTimer.reset();
+	grassStatistics.reset();
+	grassPrePassStatistics.reset();
+	terrainStatistics.reset();
+	if (hiZTexture)
+	{
+		gl->glDeleteFramebuffers(1, &hiZDepthFramebuffer);
+		gl->glDeleteTextures(1, &hiZDepthTexture);
+		gl->glDeleteTextures(1, &hiZTexture);
+	}
 	doneCurrent();
 }
 
@@ -25,7 +42,8 @@ void OpenGLWindow::initializeGL()
 	initializeOpenGLFunctions();
 
 	/* Initialize QtImGui */
-	QtImGui::initialize(this);
+	if (!headless)
+		QtImGui::initialize(this);
 
 	/* Initialize GPUEngine */
 	ge::gl::init();
@@ -35,22 +53,120 @@ void OpenGLWindow::initializeGL()
 	gl->glEnable(GL_DEPTH_TEST);
 
 	/* Shaders */
-	std::shared_ptr<ge::gl::Shader> grassVS		= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER		    , ge::util::loadTextFile("../shaders/grassVS.glsl"));
-	std::shared_ptr<ge::gl::Shader> grassTCS	= std::make_shared<ge::gl::Shader>(GL_TESS_CONTROL_SHADER   , ge::util::loadTextFile("../shaders/grassTCS.glsl"));
-	std::shared_ptr<ge::gl::Shader> grassTES	= std::make_shared<ge::gl::Shader>(GL_TESS_EVALUATION_SHADER, ge::util::loadTextFile("../shaders/grassTES.glsl"));
-	std::shared_ptr<ge::gl::Shader> grassFS		= std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, ge::util::loadTextFile("../shaders/grassFS.glsl"));
-	std::shared_ptr<ge::gl::Shader> terrainVS	= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER			, ge::util::loadTextFile("../shaders/terrainVS.glsl"));
-	std::shared_ptr<ge::gl::Shader> terrainFS	= std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, ge::util::loadTextFile("../shaders/terrainFS.glsl"));
-	std::shared_ptr<ge::gl::Shader> dummyVS		= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER			, ge::util::loadTextFile("../shaders/dummyVS.glsl"));
-	std::shared_ptr<ge::gl::Shader> dummyFS		= std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, ge::util::loadTextFile("../shaders/dummyFS.glsl"));
-	std::shared_ptr<ge::gl::Shader> skyboxVS	= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER			, ge::util::loadTextFile("../shaders/skyboxVS.glsl"));
-	std::shared_ptr<ge::gl::Shader> skyboxFS	= std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, ge::util::loadTextFile("../shaders/skyboxFS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassVS		= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER		    , loadShaderSource("../shaders/grassVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassTCS	= std::make_shared<ge::gl::Shader>(GL_TESS_CONTROL_SHADER   , loadShaderSource("../shaders/grassTCS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassTES	= std::make_shared<ge::gl::Shader>(GL_TESS_EVALUATION_SHADER, loadShaderSource("../shaders/grassTES.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassFS		= std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, loadShaderSource("../shaders/grassFS.glsl"));
+	std::shared_ptr<ge::gl::Shader> terrainVS	= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER			, loadShaderSource("../shaders/terrainVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> terrainFS	= std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, loadShaderSource("../shaders/terrainFS.glsl"));
+	std::shared_ptr<ge::gl::Shader> terrainClipmapVS = std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER	, loadShaderSource("../shaders/terrainClipmapVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> terrainChunkVS	 = std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER	, loadShaderSource("../shaders/terrainChunkVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> terrainPatchVS	 = std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER	, loadShaderSource("../shaders/terrainPatchVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> terrainTCS		 = std::make_shared<ge::gl::Shader>(GL_TESS_CONTROL_SHADER	, loadShaderSource("../shaders/terrainTCS.glsl"));
+	std::shared_ptr<ge::gl::Shader> terrainTES		 = std::make_shared<ge::gl::Shader>(GL_TESS_EVALUATION_SHADER, loadShaderSource("../shaders/terrainTES.glsl"));
+	std::shared_ptr<ge::gl::Shader> dummyVS		= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER			, loadShaderSource("../shaders/dummyVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> dummyFS		= std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, loadShaderSource("../shaders/dummyFS.glsl"));
+	std::shared_ptr<ge::gl::Shader> skyboxVS	= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER			, loadShaderSource("../shaders/skyboxVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> skyboxFS	= std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, loadShaderSource("../shaders/skyboxFS.glsl"));
+	std::shared_ptr<ge::gl::Shader> patchCullCS = std::make_shared<ge::gl::Shader>(GL_COMPUTE_SHADER		, loadShaderSource("../shaders/patchCullCS.glsl"));
+	std::shared_ptr<ge::gl::Shader> hiZBuildCS	= std::make_shared<ge::gl::Shader>(GL_COMPUTE_SHADER		, loadShaderSource("../shaders/hiZBuildCS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassLowVS	= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER			, loadShaderSource("../shaders/grassLowVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassCardVS = std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER			, loadShaderSource("../shaders/grassCardVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassCardFS = std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER		, loadShaderSource("../shaders/grassCardFS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassCardBakeVS = std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER		, loadShaderSource("../shaders/grassCardBakeVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassCardBakeFS = std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER	, loadShaderSource("../shaders/grassCardBakeFS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassExpandCS	= std::make_shared<ge::gl::Shader>(GL_COMPUTE_SHADER		, loadShaderSource("../shaders/grassExpandCS.glsl"));
+	std::shared_ptr<ge::gl::Shader> grassExpandedVS = std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER		, loadShaderSource("../shaders/grassExpandedVS.glsl"));
+	std::shared_ptr<ge::gl::Shader> bladeRestCS		  = std::make_shared<ge::gl::Shader>(GL_COMPUTE_SHADER		, loadShaderSource("../shaders/bladeRestCS.glsl"));
+	std::shared_ptr<ge::gl::Shader> bladeSimulationCS = std::make_shared<ge::gl::Shader>(GL_COMPUTE_SHADER		, loadShaderSource("../shaders/bladeSimulationCS.glsl"));
+	std::string grassStripSource = loadShaderSource("../shaders/grassStripVS.glsl");
+	std::string grassStripAttribSource = grassStripSource;
+	grassStripAttribSource.insert(grassStripAttribSource.find('\n') + 1, "#define BLADE_ATTRIBUTES\n");	// after #version
+	std::shared_ptr<ge::gl::Shader> grassStripVS		= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER, grassStripSource);
+	std::shared_ptr<ge::gl::Shader> grassStripAttribVS	= std::make_shared<ge::gl::Shader>(GL_VERTEX_SHADER, grassStripAttribSource);
+	std::string grassDepthSource	 = loadShaderSource("../shaders/grassFS.glsl");
+	std::string grassCardDepthSource = loadShaderSource("../shaders/grassCardFS.glsl");
+	grassDepthSource.insert(grassDepthSource.find('\n') + 1, "#define DEPTH_ONLY\n");
+	grassCardDepthSource.insert(grassCardDepthSource.find('\n') + 1, "#define DEPTH_ONLY\n");
+	std::shared_ptr<ge::gl::Shader> grassDepthFS	 = std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER, grassDepthSource);
+	std::shared_ptr<ge::gl::Shader> grassCardDepthFS = std::make_shared<ge::gl::Shader>(GL_FRAGMENT_SHADER, grassCardDepthSource);
 
 	/* Shader programs */
 	grassShaderProgram	 = std::make_shared<ge::gl::Program>(grassVS, grassTCS, grassTES, grassFS);
 	terrainShaderProgram = std::make_shared<ge::gl::Program>(terrainVS, terrainFS);
+	terrainClipmapShaderProgram = std::make_shared<ge::gl::Program>(terrainClipmapVS, terrainFS);
+	terrainChunkShaderProgram	= std::make_shared<ge::gl::Program>(terrainChunkVS, terrainFS);
+	terrainTessShaderProgram	= std::make_shared<ge::gl::Program>(terrainPatchVS, terrainTCS, terrainTES, terrainFS);
 	dummyShaderProgram	 = std::make_shared<ge::gl::Program>(dummyVS, dummyFS);
 	skyboxShaderProgram	 = std::make_shared<ge::gl::Program>(skyboxVS, skyboxFS);
+	patchCullShaderProgram = std::make_shared<ge::gl::Program>(patchCullCS);
+	hiZBuildShaderProgram  = std::make_shared<ge::gl::Program>(hiZBuildCS);
+	grassLowShaderProgram  = std::make_shared<ge::gl::Program>(grassLowVS, grassFS);
+	grassCardShaderProgram = std::make_shared<ge::gl::Program>(grassCardVS, grassCardFS);
+	grassCardBakeShaderProgram = std::make_shared<ge::gl::Program>(grassCardBakeVS, grassCardBakeFS);
+	grassExpandShaderProgram   = std::make_shared<ge::gl::Program>(grassExpandCS);
+	grassExpandedShaderProgram = std::make_shared<ge::gl::Program>(grassExpandedVS, grassFS);
+	grassStripShaderProgram[0] = std::make_shared<ge::gl::Program>(grassStripVS, grassFS);
+	grassStripShaderProgram[1] = std::make_shared<ge::gl::Program>(grassStripAttribVS, grassFS);
+	bladeRestShaderProgram		 = std::make_shared<ge::gl::Program>(bladeRestCS);
+	bladeSimulationShaderProgram = std::make_shared<ge::gl::Program>(bladeSimulationCS);
+
+	/* Depth-only variants for the grass pre-pass, uniform locations are explicit and match the color programs */
+	grassDepthShaderProgram			= std::make_shared<ge::gl::Program>(grassVS, grassTCS, grassTES, grassDepthFS);
+	grassLowDepthShaderProgram		= std::make_shared<ge::gl::Program>(grassLowVS, grassDepthFS);
+	grassCardDepthShaderProgram		= std::make_shared<ge::gl::Program>(grassCardVS, grassCardDepthFS);
+	grassExpandedDepthShaderProgram = std::make_shared<ge::gl::Program>(grassExpandedVS, grassDepthFS);
+	grassStripDepthShaderProgram[0] = std::make_shared<ge::gl::Program>(grassStripVS, grassDepthFS);
+	grassStripDepthShaderProgram[1] = std::make_shared<ge::gl::Program>(grassStripAttribVS, grassDepthFS);
+
+	/* Uniform locations of per-program uniforms (per-frame data lives in the FrameUniforms block) */
+	uPatchHalfExtentLocation  = gl->glGetUniformLocation(patchCullShaderProgram->getId(), "uPatchHalfExtent");
+	uPatchHalfSizeLocation	  = gl->glGetUniformLocation(patchCullShaderProgram->getId(), "uPatchHalfSize");
+	uPatchBladeHeightLocation = gl->glGetUniformLocation(patchCullShaderProgram->getId(), "uBladeHeight");
+	uPatchCountLocation		  = gl->glGetUniformLocation(patchCullShaderProgram->getId(), "uPatchCount");
+	uLodDistancesLocation	  = gl->glGetUniformLocation(patchCullShaderProgram->getId(), "uLodDistances");
+	uOcclusionCullingLocation = gl->glGetUniformLocation(patchCullShaderProgram->getId(), "uOcclusionCulling");
+	uHiZLevelCountLocation	  = gl->glGetUniformLocation(patchCullShaderProgram->getId(), "uHiZLevelCount");
+	uExpandGroupLimitLocation = gl->glGetUniformLocation(patchCullShaderProgram->getId(), "uExpandGroupLimit");
+	uHiZLevelLocation		  = gl->glGetUniformLocation(hiZBuildShaderProgram->getId(), "uLevel");
+	uPatchListOffsetLocations[(int)LodTier::NEAR] = gl->glGetUniformLocation(grassShaderProgram->getId(), "uPatchListOffset");
+	uPatchListOffsetLocations[(int)LodTier::MID]  = gl->glGetUniformLocation(grassLowShaderProgram->getId(), "uPatchListOffset");
+	uPatchListOffsetLocations[(int)LodTier::FAR]  = gl->glGetUniformLocation(grassCardShaderProgram->getId(), "uPatchListOffset");
+	uCardSizeLocation		   = gl->glGetUniformLocation(grassCardShaderProgram->getId(), "uCardSize");
+	uBakeProjectionLocation	   = gl->glGetUniformLocation(grassCardBakeShaderProgram->getId(), "uBakeProjection");
+	uBakeBendingFactorLocation = gl->glGetUniformLocation(grassCardBakeShaderProgram->getId(), "uBakeBendingFactor");
+	uExpandPatchListOffsetLocation	= gl->glGetUniformLocation(grassExpandShaderProgram->getId(), "uPatchListOffset");
+	uExpandBladeCountLocation		= gl->glGetUniformLocation(grassExpandShaderProgram->getId(), "uBladeCount");
+	uExpandPatchListCountLocation	= gl->glGetUniformLocation(grassExpandShaderProgram->getId(), "uPatchListCount");
+	uExpandVertexCapacityLocation	= gl->glGetUniformLocation(grassExpandShaderProgram->getId(), "uVertexCapacity");
+	uExpandedVertexCapacityLocation = gl->glGetUniformLocation(grassExpandedShaderProgram->getId(), "uVertexCapacity");
+	GLint maxStorageBlockSize;
+	gl->glGetIntegerv(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxStorageBlockSize);
+	expandedVertexLimit = std::min(expandedVertexLimit, GLuint(maxStorageBlockSize / 32));
+	GLint maxWorkGroupCount;
+	gl->glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &maxWorkGroupCount);
+	expandGroupLimit = GLuint(maxWorkGroupCount);
+	for (int i = 0; i < 2; i++)
+	{
+		uStripPatchListOffsetLocations[i] = gl->glGetUniformLocation(grassStripShaderProgram[i]->getId(), "uPatchListOffset");
+		uStripSegmentCountLocations[i]	  = gl->glGetUniformLocation(grassStripShaderProgram[i]->getId(), "uSegmentCount");
+	}
+	uRestPatchCountLocation	   = gl->glGetUniformLocation(bladeRestShaderProgram->getId(), "uPatchCount");
+	uRestStiffnessLocation	   = gl->glGetUniformLocation(bladeRestShaderProgram->getId(), "uStiffness");
+	uRestResetStateLocation	   = gl->glGetUniformLocation(bladeRestShaderProgram->getId(), "uResetState");
+	uSimInstanceCountLocation  = gl->glGetUniformLocation(bladeSimulationShaderProgram->getId(), "uInstanceCount");
+	uSimGravityLocation		   = gl->glGetUniformLocation(bladeSimulationShaderProgram->getId(), "uGravity");
+	uSimWindStrengthLocation   = gl->glGetUniformLocation(bladeSimulationShaderProgram->getId(), "uWindStrength");
+	uSimCollisionDecayLocation = gl->glGetUniformLocation(bladeSimulationShaderProgram->getId(), "uCollisionDecay");
+	uSimTimeLocation		   = gl->glGetUniformLocation(bladeSimulationShaderProgram->getId(), "uSimulationTime");
+	uSimDeltaTimeLocation	   = gl->glGetUniformLocation(bladeSimulationShaderProgram->getId(), "uDeltaTime");
+	uSimColliderCountLocation  = gl->glGetUniformLocation(bladeSimulationShaderProgram->getId(), "uColliderCount");
+	uSimCollidersLocation	   = gl->glGetUniformLocation(bladeSimulationShaderProgram->getId(), "uColliders");
+	uClipmapInstanceOffsetLocation = gl->glGetUniformLocation(terrainClipmapShaderProgram->getId(), "uInstanceOffset");
+	uTerrainProjectionScaleLocation	 = gl->glGetUniformLocation(terrainTessShaderProgram->getId(), "uProjectionScale");
+	uTerrainViewportHeightLocation	 = gl->glGetUniformLocation(terrainTessShaderProgram->getId(), "uViewportHeight");
+	uTerrainTargetEdgeLengthLocation = gl->glGetUniformLocation(terrainTessShaderProgram->getId(), "uTargetEdgeLength");
+	uTerrainMaxEdgeLevelLocation	 = gl->glGetUniformLocation(terrainTessShaderProgram->getId(), "uMaxEdgeLevel");
 
 	/* Generating patches */
 	patchTransSSBO = grassField->getPatchTransSSBO();
@@ -58,6 +174,21 @@ void OpenGLWindow::initializeGL()
 	grassShaderProgram->bindBuffer("patchTranslationsBuffer", patchTransSSBO);
 	grassShaderProgram->bindBuffer("patchRandomsBuffer", patchRandomsSSBO);
 
+	/* Visible patch lists (identity list when culling is disabled), GPU culling writes one list per LOD tier */
+	patchIndicesSSBO   = grassField->getPatchIndicesSSBO();
+	visiblePatchesSSBO = std::make_shared<ge::gl::Buffer>(std::max(1, 3 * grassField->getPatchCount()) * sizeof(int));
+	grassDrawCommandBuffer = std::make_shared<ge::gl::Buffer>((3 * 4 + 3 + 2) * sizeof(GLuint));	// 3 draw commands + expansion dispatch + occlusion stats
+	expandedDrawCommandBuffer = std::make_shared<ge::gl::Buffer>(4 * sizeof(GLuint));
+
+	/* Persistently mapped per-frame data, triple buffered */
+	frameRing = std::make_unique<RingBuffer>(getFrameRingSize());
+
+	/* Per-pass GPU timing, indexed by Pass */
+	gpuTimer = std::make_unique<GpuTimer>(std::vector<std::string>{ "Skybox", "Terrain", "Simulation", "Culling", "Grass", "GUI" });
+	grassStatistics = std::make_unique<PipelineStatistics>();
+	grassPrePassStatistics = std::make_unique<PipelineStatistics>();
+	terrainStatistics = std::make_unique<PipelineStatistics>();
+
 	std::vector<float> dummyPos
 	{
 		-0.5f, -0.5f, -0.5f,  1.0f,
@@ -192,16 +323,10 @@ void OpenGLWindow::initializeGL()
 	};
 
 	/* Grass VAO setup */
-	grassPositionBuffer		  = grassField->getGrassVertexBuffer();
-	grassCenterPositionBuffer = grassField->getGrassCenterBuffer();
-	grassTexCoordBuffer		  = grassField->getGrassTexCoordBuffer();
-	grassRandomsBuffer		  = grassField->getGrassRandomsBuffer();
+	grassBladeBuffer = grassField->getGrassBladeBuffer();
+	grassShaderProgram->bindBuffer("grassBladesBuffer", grassBladeBuffer);
 
-	grassVAO = std::make_shared<ge::gl::VertexArray>();
-	grassVAO->addAttrib(grassPositionBuffer,	   0, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassCenterPositionBuffer, 1, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassTexCoordBuffer,	   2, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassRandomsBuffer,		   3, 4, GL_FLOAT);
+	grassVAO = grassField->getGrassVAO();
 
 	/* Terrain VAO setup */
 	terrainPositionBuffer = terrain->getTerrainVertexBuffer();
@@ -211,6 +336,22 @@ void OpenGLWindow::initializeGL()
 	terrainVAO->addElementBuffer(terrainIndexBuffer);
 	terrainVAO->addAttrib(terrainPositionBuffer, 0, 2, GL_FLOAT);
 
+	terrainChunkVertexBuffer = terrain->getChunkVertexBuffer();
+	terrainChunkIndexBuffer  = terrain->getChunkIndexBuffer();
+	terrainChunkBoundsBuffer = terrain->getChunkBoundsBuffer();
+
+	terrainChunkVAO = std::make_shared<ge::gl::VertexArray>();
+	terrainChunkVAO->addElementBuffer(terrainChunkIndexBuffer);
+	terrainChunkVAO->addAttrib(terrainChunkVertexBuffer, 0, 2, GL_UNSIGNED_SHORT, 0, 0, GL_TRUE);
+	terrainChunkVAO->addAttrib(terrainChunkBoundsBuffer, 1, 4, GL_FLOAT, 0, 0, GL_FALSE, 1);
+
+	terrainPatchVertexBuffer = terrain->getPatchVertexBuffer();
+	terrainPatchIndexBuffer	 = terrain->getPatchIndexBuffer();
+
+	terrainPatchVAO = std::make_shared<ge::gl::VertexArray>();
+	terrainPatchVAO->addElementBuffer(terrainPatchIndexBuffer);
+	terrainPatchVAO->addAttrib(terrainPatchVertexBuffer, 0, 2, GL_FLOAT);
+
 	/* Dummy VAO setup */
 	dummyPositionBuffer = std::make_shared<ge::gl::Buffer>(dummyPos.size()      * sizeof(float), dummyPos.data());
 	dummyTexCoordBuffer = std::make_shared<ge::gl::Buffer>(dummyTexCoord.size() * sizeof(float), dummyTexCoord.data());
@@ -228,10 +369,11 @@ void OpenGLWindow::initializeGL()
 	// Elapsed time since initialization
 	timer.start();
 
-	// Timer for application ticks
+	// Timer for application ticks (headless frames are driven by the caller)
 	tickTimer = new QTimer(this);
 	QObject::connect(tickTimer, SIGNAL(timeout()), this, SLOT(tick()));
-	tickTimer->start();
+	if (!headless)
+		tickTimer->start();
 
 	// Texture parameters
 	gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S    , GL_CLAMP_TO_EDGE);
@@ -242,7 +384,8 @@ void OpenGLWindow::initializeGL()
 	// Load textures (mirrored vertically because of y axis differences between OpenGL and QImage)
 	debugTexture	  = new QOpenGLTexture(QImage("../res/debug_texture.png").mirrored());
 	grassAlphaTexture = new QOpenGLTexture(QImage("../res/grass_alpha.png").mirrored());
-	heightMap		  = new QOpenGLTexture(QImage("../res/height_map.png").mirrored());
+	heightMap		  = new QOpenGLTexture(QImage("../res/height_map.png").mirrored());	// heightField is its CPU copy
+	heightPyramidSSBO = createHeightPyramidSSBO();
 
 	// Load skybox
 	std::vector<QString> faces
@@ -255,15 +398,206 @@ void OpenGLWindow::initializeGL()
 		"../res/skybox_back.png"
 	};
 	skyboxTexture = loadSkybox(faces);
+
+	/* Far LOD grass card */
+	bakeGrassCard();
 }
 
 void OpenGLWindow::tick()
+{
+	updateWind();
+	update();
+}
+
+void OpenGLWindow::initializeHeadless(GLuint framebuffer, int width, int height)
+{
+	headlessFramebuffer = framebuffer;
+
+	initializeGL();
+	resizeGL(width, height);
+	camera->setAspectRatio((float)width / (float)height);
+}
+
+void OpenGLWindow::renderHeadlessFrame(int time)
+{
+	/* Fixed timestep - time comes from the caller instead of the wall clock */
+	this->time = time;
+	updateWind();
+
+	gl->glBindFramebuffer(GL_FRAMEBUFFER, headlessFramebuffer);
+	paintGL();
+}
+
+Camera *OpenGLWindow::getCamera()
+{
+	return camera;
+}
+
+GpuTimer *OpenGLWindow::getGpuTimer()
+{
+	return gpuTimer.get();
+}
+
+PipelineStatistics *OpenGLWindow::getGrassStatistics()
+{
+	return grassStatistics.get();
+}
+
+PipelineStatistics *OpenGLWindow::getGrassPrePassStatistics()
+{
+	return grassPrePassStatistics.get();
+}
+
+PipelineStatistics *OpenGLWindow::getTerrainStatistics()
+{
+	return terrainStatistics.get();
+}
+
+void OpenGLWindow::setMaxDistance(float maxDistance)
+{
+	this->maxDistance = maxDistance;
+}
+
+void OpenGLWindow::setLodEnabled(bool lodEnabled)
+{
+	this->lodEnabled = lodEnabled;
+}
+
+void OpenGLWindow::setGrassPath(GrassPath grassPath)
+{
+	this->grassPath = grassPath;
+}
+
+void OpenGLWindow::setTerrainMode(TerrainMode terrainMode)
+{
+	this->terrainMode = terrainMode;
+}
+
+void OpenGLWindow::setTerrainIndexFormat(Terrain::IndexFormat indexFormat)
+{
+	if (indexFormat == terrainIndexFormat)
+		return;
+
+	terrainIndexFormat = indexFormat;
+	terrain->setIndexFormat(indexFormat);
+	if (!terrainVAO)
+		return;
+
+	terrainIndexBuffer = terrain->getTerrainIndexBuffer();
+
+	terrainVAO = std::make_shared<ge::gl::VertexArray>();
+	terrainVAO->addElementBuffer(terrainIndexBuffer);
+	terrainVAO->addAttrib(terrainPositionBuffer, 0, 2, GL_FLOAT);
+}
+
+void OpenGLWindow::setGrassDepthPrePass(bool grassDepthPrePass)
+{
+	this->grassDepthPrePass = grassDepthPrePass;
+}
+
+void OpenGLWindow::setSortPatchesFrontToBack(bool sortPatchesFrontToBack)
+{
+	this->sortPatchesFrontToBack = sortPatchesFrontToBack;
+}
+
+void OpenGLWindow::setOverdrawView(bool overdrawView)
+{
+	this->overdrawView = overdrawView;
+}
+
+void OpenGLWindow::setCullingMode(CullingMode cullingMode)
+{
+	this->cullingMode = cullingMode;
+}
+
+void OpenGLWindow::setOcclusionCulling(bool occlusionCulling)
+{
+	this->occlusionCulling = occlusionCulling;
+}
+
+void OpenGLWindow::getOcclusionStats(GLuint &tested, GLuint &occluded)
+{
+	tested	 = occlusionStats[0];
+	occluded = occlusionStats[1];
+}
+
+void OpenGLWindow::printTerrainStatistics()
+{
+	std::cout << "Terrain chunks: " << terrain->getChunkMemorySize() / 1024 << " KiB (" << terrain->getChunkFullPrecisionMemorySize() / 1024
+			  << " KiB with float positions and 32-bit indices)" << std::endl;
+
+	VertexCacheOptimizer::Statistics strip	   = terrain->getIndexStatistics(Terrain::IndexFormat::STRIP);
+	VertexCacheOptimizer::Statistics optimized = terrain->getIndexStatistics(Terrain::IndexFormat::OPTIMIZED_LIST);
+	std::cout << "Terrain strip grid (" << terrain->getVertexCount() << " vertices) vertex cache (" << VertexCacheOptimizer::DEFAULT_CACHE_SIZE << " entries):"
+			  << " strip ACMR " << strip.acmr << " ATVR " << strip.atvr
+			  << ", optimized list ACMR " << optimized.acmr << " ATVR " << optimized.atvr << std::endl;
+}
+
+int OpenGLWindow::getTerrainTriangleCount()
+{
+	if (terrainMode == TerrainMode::CHUNKED)
+		return terrain->getSelectedTriangleCount();
+	if (terrainMode == TerrainMode::CLIPMAP)
+		return terrainClipmap ? terrainClipmap->getTriangleCount() : 0;
+	if (terrainMode == TerrainMode::TESSELLATED)	// known only to the GPU, last resolved frame
+		return terrainStatistics->getValue(PipelineStatistics::Counter::CLIPPING_INPUT_PRIMITIVES);	// triangles after tessellation
+	return terrain->getTriangleCount();
+}
+
+void OpenGLWindow::setSimulationEnabled(bool simulationEnabled)
+{
+	this->simulationEnabled = simulationEnabled;
+}
+
+void OpenGLWindow::requestSimulationVerification(int steps)
+{
+	simulationVerifySteps = steps;
+}
+
+float OpenGLWindow::getSimulationError()
+{
+	return simulationError;
+}
+
+void OpenGLWindow::requestReferenceComparison()
+{
+	referenceComparisonRequested = true;
+}
+
+GrassReferenceRenderer::Comparison OpenGLWindow::getReferenceComparison()
+{
+	return referenceComparison;
+}
+
+GrassReferenceRenderer *OpenGLWindow::renderReferenceFrame(int time, int threadCount)
+{
+	/* Frame state of paintGL without GL - CPU culled patches, all of them through the near blade chain */
+	this->time = time;
+	updateWind();
+	mvp = camera->getProjectionMatrix() * camera->getViewMatrix();
+
+	int visibleCount = cullPatchesCPU();
+	getReferenceRenderer()->render(visiblePatches.data(), visibleCount, getReferenceParameters(), threadCount);
+
+	return referenceRenderer.get();
+}
+
+void OpenGLWindow::updateWind()
 {
 	/* Update wind speed */
 	const float pi = glm::pi<float>();
 	windParams.z = glm::cos(time * pi / 10000) / 2 + 0.5;	// 0 - 1	// period 10s
+}
 
-	update();
+void OpenGLWindow::keepCameraAboveGround()
+{
+	if (!cameraGroundCollision)
+		return;
+
+	glm::vec3 position = camera->getPosition();
+	float ground = heightField->getTerrainHeight(glm::vec2(position.x, position.z)) + cameraGroundClearance;
+	if (position.y < ground)
+		camera->setPosition(glm::vec3(position.x, ground, position.z));
 }
 
 void OpenGLWindow::resizeGL(int w, int h)
@@ -275,40 +609,124 @@ void OpenGLWindow::resizeGL(int w, int h)
 void OpenGLWindow::paintGL()
 {
 	/* RENDER CALL BEGIN */
-	const qreal retinaScale = devicePixelRatio();
+	const qreal retinaScale = headless ? 1.0 : devicePixelRatio();
+
+	/* The CPU height field maps world positions like terrainHeight.glsl */
+	heightField->setTerrainSize(terrain->getTerrainWidth(), terrain->getTerrainLength(), maxTerrainHeight);
+
+	/* Every frame - a new height map or max. terrain height can raise the ground under a resting camera */
+	if (!headless)
+		keepCameraAboveGround();
 
 	mvp = camera->getProjectionMatrix() * camera->getViewMatrix();
-	time = timer.elapsed();
+	if (!headless)
+		time = timer.elapsed();
 
 	gl->glViewport(0, 0, windowWidth * retinaScale, windowHeight * retinaScale);
 	gl->glClearColor(0.0, 0.0, 0.0, 1.0);
 	gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+	/* A write did not fit last frame - grow the regions (waits for the GPU once) */
+	if (frameRingFull)
+	{
+		frameRing->reserve(2 * frameRing->getFrameSize());
+		frameRingFull = false;
+	}
+	frameRing->beginFrame();
+	gpuTimer->beginFrame();
+	grassStatistics->beginFrame();
+	grassPrePassStatistics->beginFrame();
+	terrainStatistics->beginFrame();
+
 	/* INITIALIZE GUI */
 	if (guiEnabled)
 		initGui();
 
+	/* UPDATE PER-FRAME UNIFORMS */
+	updateFrameUniforms();
+
 	/* DRAW SKYBOX */
 	if (skyboxEnabled)
+	{
+		gpuTimer->begin((int)Pass::SKYBOX);
 		drawSkybox();
+		gpuTimer->end((int)Pass::SKYBOX);
+	}
 
 	/* DRAW TERRAIN */
+	gpuTimer->begin((int)Pass::TERRAIN);
+	terrainStatistics->begin();
 	drawTerrain();
+	terrainStatistics->end();
+	gpuTimer->end((int)Pass::TERRAIN);
 
 	/* DRAW DUMMY */
 	//drawDummy();
 
+	/* SIMULATE GRASS BLADES */
+	if (simulationEnabled && getSimulatedBladeCount() > maxSimulatedBlades)
+	{
+		/* No state buffers for this many blades - back to the analytic wind instead of drawing stale states */
+		std::cout << "Blade simulation disabled: too many blades (" << getSimulatedBladeCount() << " > " << maxSimulatedBlades << ")" << std::endl;
+		simulationEnabled = false;
+		simulationBladeLimitHit = true;
+	}
+	if (simulationEnabled)
+	{
+		gpuTimer->begin((int)Pass::SIMULATION);
+		simulateBlades();
+		gpuTimer->end((int)Pass::SIMULATION);
+	}
+	if (simulationVerifySteps > 0)
+	{
+		verifySimulation(simulationVerifySteps);
+		simulationVerifySteps = 0;
+	}
+
+	/* CULL GRASS PATCHES */
+	gpuTimer->begin((int)Pass::CULLING);
+	cullPatches();
+	gpuTimer->end((int)Pass::CULLING);
+
 	/* DRAW GRASS */
-	drawGrass();
+	gpuTimer->begin((int)Pass::GRASS);
+	if (overdrawView)
+	{
+		/* Grass fragments are counted on black, the terrain depth still hides them */
+		gl->glClear(GL_COLOR_BUFFER_BIT);
+		gl->glEnable(GL_BLEND);
+		gl->glBlendFunc(GL_ONE, GL_ONE);
+	}
+	if (grassDepthPrePass)
+	{
+		grassPrePassStatistics->begin();
+		drawGrass(true);
+		grassPrePassStatistics->end();
+	}
+	grassStatistics->begin();
+	drawGrass(false);
+	grassStatistics->end();
+	if (overdrawView)
+		gl->glDisable(GL_BLEND);
+	gpuTimer->end((int)Pass::GRASS);
+	if (referenceComparisonRequested)
+	{
+		compareWithReference();
+		referenceComparisonRequested = false;
+	}
 
 	/* DRAW GUI */
 	if (guiEnabled)
 	{
+		gpuTimer->begin((int)Pass::GUI);
 		gl->glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		ImGui::Render();
 		QtImGui::render();
+		gpuTimer->end((int)Pass::GUI);
 	}
 
+	frameRing->endFrame();
+
 	/* RENDER CALL END */
 	printError();
 }
@@ -346,6 +764,78 @@ void OpenGLWindow::initGui()
 		SliderInt("Max. tessellation level", &maxTessLevel, 0, 10, "%d", NULL);
 		SliderFloat("Max. bending factor", &maxBendingFactor, 0.0f, 5.0f, "%.1f");
 		SliderFloat("Max. distance", &maxDistance, 0.0f, 1000.0f, "%.f");
+
+		{
+			static int radioValue = 1;
+			Text("Patch culling");						SameLine();
+			RadioButton("None##c", &radioValue, 0);		SameLine();
+			RadioButton("CPU##c" , &radioValue, 1);		SameLine();
+			RadioButton("GPU##c" , &radioValue, 2);
+
+			if (radioValue == 0)
+				cullingMode = CullingMode::NONE;
+			else if (radioValue == 1)
+				cullingMode = CullingMode::CPU;
+			else if (radioValue == 2)
+				cullingMode = CullingMode::GPU;
+		}
+		if (cullingMode == CullingMode::GPU)
+		{
+			Checkbox("Verify against CPU (reads back)", &verifyGpuCulling);
+			if (verifyGpuCulling)
+				Text("Visible patches: GPU %d / CPU %d / %d %s", gpuVisiblePatchCount, cpuReferencePatchCount, grassField->getPatchCount(),
+					gpuVisiblePatchCount + gpuOccludedPatchCount == cpuReferencePatchCount ? "" : "MISMATCH");
+			else
+				Text("Visible patches: on GPU / %d", grassField->getPatchCount());
+
+			Checkbox("Hi-Z occlusion culling (terrain)", &occlusionCulling);
+			if (occlusionCulling)
+				Text("Occluded patches: %u / %u in the frustum", occlusionStats[1], occlusionStats[0]);
+		}
+		else
+			Text("Visible patches: %d / %d", visiblePatchCount, grassField->getPatchCount());
+		if (cullingMode != CullingMode::NONE)
+		{
+			Checkbox("Patch quadtree", &usePatchQuadtree);
+			if (usePatchQuadtree)
+				Text("Visited nodes: %d / %d", grassField->getPatchQuadtree()->getVisitedNodeCount(), grassField->getPatchQuadtree()->getNodeCount());
+
+			Checkbox("LOD tiers", &lodEnabled);
+			if (lodEnabled)
+			{
+				SliderFloat2("Near / mid tier end", glm::value_ptr(lodDistances), 0.0f, 1000.0f, "%.f");
+				lodDistances.y = std::max(lodDistances.y, lodDistances.x);
+			}
+			if (cullingMode == CullingMode::CPU || verifyGpuCulling)
+				Text("LOD patches (near/mid/far): %d / %d / %d", lodPatchCounts[0], lodPatchCounts[1], lodPatchCounts[2]);
+			if (cullingMode == CullingMode::CPU)
+				Checkbox("Sort patches front to back", &sortPatchesFrontToBack);
+		}
+		Checkbox("Grass depth pre-pass", &grassDepthPrePass);
+		Checkbox("Overdraw view (grass fragments)", &overdrawView);
+
+		{
+			int pathValue = (int)grassPath;
+			Text("Near blades");								SameLine();
+			RadioButton("Tessellation##p", &pathValue, 0);		SameLine();
+			RadioButton("Compute##p"	 , &pathValue, 1);	SameLine();
+			RadioButton("Pulling##p"	 , &pathValue, 2);	SameLine();
+			RadioButton("Attributes##p"	 , &pathValue, 3);
+			grassPath = (GrassPath)pathValue;
+
+			if (grassPath == GrassPath::COMPUTE)
+			{
+				Text("Strip buffer: %u vertices (%.f MB)%s", expandedVertexCapacity, expandedVertexCapacity * 32.0 / (1024 * 1024),
+					getExpandedVertexBound() > expandedVertexLimit ? " LIMITED - near blades may be dropped" : "");
+				if (Button("Compare with CPU reference"))
+					referenceComparisonRequested = true;
+				if (referenceComparison.referenceVertexCount > 0 || referenceComparison.vertexCount > 0)
+					Text("Matched vertices: %d / %d (CPU %d), max. error %g %s", referenceComparison.matchedVertexCount, referenceComparison.vertexCount,
+						referenceComparison.referenceVertexCount, referenceComparison.maxError, referenceComparison.passed ? "" : "MISMATCH");
+			}
+			else if (grassPath == GrassPath::PULLING || grassPath == GrassPath::ATTRIBUTES)
+				SliderInt("Strip segments", &stripSegmentCount, 1, 10);
+		}
 		
 		{
 			static int radioValue = 2;
@@ -382,6 +872,55 @@ void OpenGLWindow::initGui()
 		}
 		SliderFloat("Max. terrain height", &maxTerrainHeight, 0.0f, 100.0f, "%.f");
 
+		{
+			int modeValue = (int)terrainMode;
+			Text("Grid");								SameLine();
+			RadioButton("Strip##tm"  , &modeValue, 0);	SameLine();
+			RadioButton("Chunked##tm", &modeValue, 1);	SameLine();
+			RadioButton("Clipmap##tm", &modeValue, 2);	SameLine();
+			RadioButton("Tessellated##tm", &modeValue, 3);
+			terrainMode = (TerrainMode)modeValue;
+
+			if (terrainMode == TerrainMode::CHUNKED)
+			{
+				SliderFloat("Chunk LOD distance", &chunkLodDistance, 1.0f, 500.0f, "%.f");
+				Text("Visible chunks: %d / %d (%d quads per side)", visibleChunkCount, terrain->getChunkCount(), Terrain::CHUNK_QUADS);
+				Text("Vertices: %d, triangles: %d", terrain->getSelectedVertexCount(), terrain->getSelectedTriangleCount());
+				Text("Chunk buffers: %zu KiB (%zu KiB with float positions and 32-bit indices)", terrain->getChunkMemorySize() / 1024,
+					 terrain->getChunkFullPrecisionMemorySize() / 1024);
+			}
+			else if (terrainMode == TerrainMode::CLIPMAP)
+			{
+				SliderInt("Clipmap levels", &clipmapLevelCount, 1, TerrainClipmap::MAX_LEVEL_COUNT);
+				SliderFloat("Clipmap spacing", &clipmapSpacing, 0.25f, 8.0f, "%.2f");
+				if (terrainClipmap)
+					Text("Extent: %.f, vertices: %d, triangles: %d", terrainClipmap->getExtent(), terrainClipmap->getVertexCount(), terrainClipmap->getTriangleCount());
+			}
+			else if (terrainMode == TerrainMode::TESSELLATED)
+			{
+				SliderFloat("Target edge length (px)", &terrainTargetEdgeLength, 1.0f, 64.0f, "%.f");
+				SliderFloat("Max. edge level", &terrainMaxEdgeLevel, 1.0f, 64.0f, "%.f");
+				if (terrainStatistics->getSupported())
+					Text("Patches: %d, triangles: %d (strip grid %d)", terrain->getPatchCount(), getTerrainTriangleCount(), terrain->getTriangleCount());
+				else
+					Text("Patches: %d", terrain->getPatchCount());
+			}
+			else
+			{
+				int formatValue = (int)terrainIndexFormat;
+				Text("Indices");										SameLine();
+				RadioButton("Strips##ti"		 , &formatValue, 0);	SameLine();
+				RadioButton("Optimized list##ti", &formatValue, 1);
+				setTerrainIndexFormat((Terrain::IndexFormat)formatValue);
+
+				VertexCacheOptimizer::Statistics strip	   = terrain->getIndexStatistics(Terrain::IndexFormat::STRIP);
+				VertexCacheOptimizer::Statistics optimized = terrain->getIndexStatistics(Terrain::IndexFormat::OPTIMIZED_LIST);
+				Text("Vertices: %d, triangles: %d", terrain->getVertexCount(), terrain->getTriangleCount());
+				Text("ACMR / ATVR (%d entry FIFO): strips %.3f / %.3f, list %.3f / %.3f", VertexCacheOptimizer::DEFAULT_CACHE_SIZE,
+					 strip.acmr, strip.atvr, optimized.acmr, optimized.atvr);
+			}
+		}
+
 		Separator();
 
 		Text("Scene");
@@ -390,7 +929,72 @@ void OpenGLWindow::initGui()
 		SliderFloat2("Wind parameters", glm::value_ptr(windParams), 0.0f, 5.0f, "%.1f");
 		SliderFloat("Wind speed", &windParams.z, 0.0f, 1.0f, "%.1f");
 
+		if (Checkbox("Blade simulation", &simulationEnabled) && simulationEnabled)
+			simulationBladeLimitHit = false;
+		if (simulationBladeLimitHit)
+		{
+			SameLine();
+			Text("disabled - too many blades (%d > %d)", getSimulatedBladeCount(), maxSimulatedBlades);
+		}
+		if (simulationEnabled)
+		{
+			SliderFloat("Gravity", &simulationParameters.gravity, 0.0f, 20.0f, "%.1f");
+			SliderFloat("Stiffness", &bladeStiffness, 1.0f, 60.0f, "%.f");
+			SliderFloat("Wind strength", &simulationParameters.windStrength, 0.0f, 10.0f, "%.1f");
+			SliderFloat("Camera collider radius", &cameraColliderRadius, 0.0f, 10.0f, "%.1f");
+			if (Button("Reset blades"))
+				resetSimulation = true;
+			SameLine();
+			if (Button("Verify against CPU (100 steps)"))
+				simulationVerifySteps = 100;
+			if (simulationError >= 0.0f)
+				Text("Max. CPU/GPU difference: %g %s", simulationError, simulationError <= BladeSimulation::TOLERANCE ? "" : "MISMATCH");
+		}
+
 		Checkbox("Skybox", &skyboxEnabled);
+		Checkbox("Camera ground collision", &cameraGroundCollision);
+		if (cameraGroundCollision)
+			SliderFloat("Eye height", &cameraGroundClearance, 0.5f, 20.0f, "%.1f");
+		{
+			glm::vec3 position = camera->getPosition();
+			glm::vec3 normal = heightField->getTerrainNormal(glm::vec2(position.x, position.z));
+			Text("Ground below the camera: height %.1f, slope %.f deg", heightField->getTerrainHeight(glm::vec2(position.x, position.z)),
+				 glm::degrees(std::acos(std::clamp(normal.y, -1.0f, 1.0f))));
+		}
+		Text("Frame ring: %d / %d B per frame, %d stalls", (int)frameRing->getUsedSize(), (int)frameRing->getFrameSize(), frameRing->getStallCount());
+
+		Separator();
+
+		Text("GPU time per pass");
+		for (int pass = 0; pass < gpuTimer->getPassCount(); pass++)
+		{
+			const std::vector<float> &history = gpuTimer->getHistory(pass);
+			std::string label = gpuTimer->getPassName(pass) + "##gpu";
+			char overlay[32];
+			snprintf(overlay, sizeof(overlay), "%.3f ms", gpuTimer->getTime(pass));
+			PlotLines(label.c_str(), history.data(), history.size(), gpuTimer->getHistoryOffset(), overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+		}
+
+		Text("Grass pipeline statistics");
+		if (grassStatistics->getSupported())
+		{
+			using Counter = PipelineStatistics::Counter;
+			GLuint64 patches = grassStatistics->getValue(Counter::TESS_CONTROL_PATCHES);
+			GLuint64 tesInvocations = grassStatistics->getValue(Counter::TESS_EVALUATION_INVOCATIONS);
+
+			Text("VS invocations: %llu", (unsigned long long)grassStatistics->getValue(Counter::VERTEX_SHADER_INVOCATIONS));
+			Text("TCS patches: %llu", (unsigned long long)patches);
+			Text("TES invocations: %llu (%.1f per patch)", (unsigned long long)tesInvocations, patches ? (double)tesInvocations / patches : 0.0);
+			Text("Primitives submitted: %llu", (unsigned long long)grassStatistics->getValue(Counter::PRIMITIVES_SUBMITTED));
+			Text("Clipping in/out: %llu / %llu", (unsigned long long)grassStatistics->getValue(Counter::CLIPPING_INPUT_PRIMITIVES),
+												 (unsigned long long)grassStatistics->getValue(Counter::CLIPPING_OUTPUT_PRIMITIVES));
+			Text("FS invocations: %llu", (unsigned long long)grassStatistics->getValue(Counter::FRAGMENT_SHADER_INVOCATIONS));
+			if (grassDepthPrePass)
+				Text("Pre-pass VS / FS invocations: %llu / %llu", (unsigned long long)grassPrePassStatistics->getValue(Counter::VERTEX_SHADER_INVOCATIONS),
+																  (unsigned long long)grassPrePassStatistics->getValue(Counter::FRAGMENT_SHADER_INVOCATIONS));
+		}
+		else
+			Text("Not supported (needs OpenGL 4.6 or ARB_pipeline_statistics_query)");
 
 		Text("Camera");
 		SliderFloat("Camera speed", &cameraSpeed, 0.5f, 5.0f, "%.1f");
@@ -417,6 +1021,8 @@ void OpenGLWindow::initGui()
 			static int rows = 100;
 			static int cols = 100;
 			static GrassField::BladeDimensions bladeDimensions{ 0.1, 0.3, 1.0, 5.0 };
+			static int seed = 0;
+			static int threadCount = std::max(1u, std::thread::hardware_concurrency());
 
 			SliderFloat("Field size", &fieldSize, 100.0f, 1000.0f, "%.f");
 			SliderFloat("Patch size", &patchSize, 1.0f, 100.0f, "%.f");
@@ -430,9 +1036,33 @@ void OpenGLWindow::initGui()
 			SliderFloat("Terrain length", &terrainLength, 100.0f, 1000.0f, "%.f");
 			SliderInt("Terrain rows", &rows, 1, 1000, "%d", NULL);
 			SliderInt("Terrain columns", &cols, 1, 1000, "%d", NULL);
+			InputInt("Seed", &seed);
+			SliderInt("Generation threads", &threadCount, 1, std::max(1u, std::thread::hardware_concurrency()), "%d", NULL);
 
 			if (Button("Regenerate"))
-				regenerateField(fieldSize, patchSize, bladeCount, terrainWidth, terrainLength, rows, cols, bladeDimensions);
+				regenerateField(fieldSize, patchSize, bladeCount, terrainWidth, terrainLength, rows, cols, bladeDimensions, seed, threadCount);
+			Text("Blade generation: %.2f ms", grassField->getGenerationTime());
+		}
+
+		Separator();
+
+		Text("Benchmarks (console output)");
+
+		/* One at a time off the GUI thread, so they neither freeze the window nor compete for the cores */
+		if (cpuBenchmark.valid() && cpuBenchmark.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			Text("Running...");
+		else
+		{
+			if (Button("Blade generation scaling"))
+				cpuBenchmark = std::async(std::launch::async, Benchmark::bladeGenerationScaling, 10000000);
+			SameLine();
+			if (Button("Blade generation kernels"))
+				cpuBenchmark = std::async(std::launch::async, Benchmark::bladeGenerationKernels);
+			if (Button("Patch culling (flat scan vs. quadtree)"))
+				cpuBenchmark = std::async(std::launch::async, Benchmark::patchCulling);
+			SameLine();
+			if (Button("CPU reference renderer"))
+				cpuBenchmark = std::async(std::launch::async, Benchmark::referenceRenderer);
 		}
 
 	}
@@ -442,88 +1072,947 @@ void OpenGLWindow::initGui()
 
 void OpenGLWindow::drawTerrain()
 {
-	GLint uMaxTerrainHeight = gl->glGetUniformLocation(terrainShaderProgram->getId(), "uMaxTerrainHeight");
-	GLint uTerrainWidth = gl->glGetUniformLocation(terrainShaderProgram->getId(), "uTerrainWidth");
-	GLint uTerrainHeight = gl->glGetUniformLocation(terrainShaderProgram->getId(), "uTerrainHeight");
-
 	terrainShaderProgram->use();
-	terrainVAO->bind();
-	terrainShaderProgram->setMatrix4fv("uMVP", glm::value_ptr(mvp));
-	gl->glUniform1f(uMaxTerrainHeight, maxTerrainHeight);
-	gl->glUniform1f(uTerrainWidth, terrain->getTerrainWidth());
-	gl->glUniform1f(uTerrainHeight, terrain->getTerrainLength());
-
 	gl->glPolygonMode(GL_FRONT_AND_BACK, terrainRasterizationMode);
-	gl->glEnable(GL_PRIMITIVE_RESTART);
-	gl->glPrimitiveRestartIndex(terrain->getRestartIndex());
 
 	// Textures
 	gl->glActiveTexture(GL_TEXTURE0 + 0); // Texture unit 0
 	heightMap->bind();
 
+	if (terrainMode == TerrainMode::CHUNKED)
+	{
+		drawTerrainChunks();
+		return;
+	}
+	if (terrainMode == TerrainMode::CLIPMAP)
+	{
+		drawTerrainClipmap();
+		return;
+	}
+	if (terrainMode == TerrainMode::TESSELLATED)
+	{
+		drawTerrainPatches();
+		return;
+	}
+
+	terrainVAO->bind();
+	if (terrain->getIndexFormat() == Terrain::IndexFormat::STRIP)
+	{
+		gl->glEnable(GL_PRIMITIVE_RESTART);
+		gl->glPrimitiveRestartIndex(terrain->getRestartIndex());
+	}
+
 	// Draw
-	gl->glDrawElements(GL_TRIANGLE_STRIP, terrain->getIndexCount(), GL_UNSIGNED_INT, 0);
+	gl->glDrawElements(terrain->getPrimitiveType(), terrain->getIndexCount(), GL_UNSIGNED_INT, 0);
 
 	gl->glDisable(GL_PRIMITIVE_RESTART);
 }
 
-void OpenGLWindow::drawGrass()
+void OpenGLWindow::drawTerrainChunks()
 {
-	GLint uTime			= gl->glGetUniformLocation(grassShaderProgram->getId(), "uTime");
-	GLint uFieldSize	= gl->glGetUniformLocation(grassShaderProgram->getId(), "uFieldSize");
-	GLint uWindEnabled	= gl->glGetUniformLocation(grassShaderProgram->getId(), "uWindEnabled");
-	GLint uLightingEnabled = gl->glGetUniformLocation(grassShaderProgram->getId(), "uLightingEnabled");
-	GLint uAlphaTexture = gl->glGetUniformLocation(grassShaderProgram->getId(), "uAlphaTexture");
-	GLint uHeightMap	= gl->glGetUniformLocation(grassShaderProgram->getId(), "uHeightMap");
-	GLint uCameraPos	= gl->glGetUniformLocation(grassShaderProgram->getId(), "uCameraPos");
-	GLint uMaxDistance	= gl->glGetUniformLocation(grassShaderProgram->getId(), "uMaxDistance");
-	GLint uMaxTerrainHeight = gl->glGetUniformLocation(grassShaderProgram->getId(), "uMaxTerrainHeight");
-	
-	grassShaderProgram->use();
-	grassVAO->bind();
+	Frustum frustum(mvp);
+	visibleChunkCount = terrain->selectChunkLods(frustum, camera->getPosition(), chunkLodDistance, *heightField, chunkDrawCommands);
+	if (chunkDrawCommands.empty())
+		return;
+
+	/* One multi-draw, the commands are streamed through the frame ring */
+	RingBuffer::Allocation commands = frameRing->write(chunkDrawCommands.data(), chunkDrawCommands.size() * sizeof(Terrain::DrawCommand), sizeof(GLuint));
+	if (!commands.data)
+	{
+		frameRingFull = true;
+		return;
+	}
 
-	glm::vec3 cameraPos = camera->getPosition();
+	terrainChunkShaderProgram->use();
+	terrainChunkVAO->bind();
+	gl->glBindBuffer(GL_DRAW_INDIRECT_BUFFER, frameRing->getId());
+	gl->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (const void *)commands.offset, chunkDrawCommands.size(), 0);
+}
 
-	// Uniforms
-	grassShaderProgram->setMatrix4fv("uMVP", glm::value_ptr(mvp));
-	grassShaderProgram->set1i("uMaxTessLevel", maxTessLevel);
-	grassShaderProgram->set1f("uMaxBendingFactor", maxBendingFactor);
-	grassShaderProgram->set3fv("uCameraPos", glm::value_ptr(cameraPos));
-	grassShaderProgram->set3fv("uLightPos", glm::value_ptr(lightPosition));
-	grassShaderProgram->set3fv("uLightColor", glm::value_ptr(lightColor));
-	grassShaderProgram->set3fv("uWindParams", glm::value_ptr(windParams));
-	gl->glUniform1i(uTime, time);
-	gl->glUniform1f(uFieldSize, grassField->getFieldSize());
-	gl->glUniform1f(uMaxDistance, maxDistance);
-	gl->glUniform1f(uMaxTerrainHeight, maxTerrainHeight);
-	gl->glUniform1i(uWindEnabled, windEnabled);
-	gl->glUniform1i(uLightingEnabled, lightingEnabled);
-	gl->glUniform1i(uAlphaTexture, 0);
-	gl->glUniform1i(uHeightMap, 1);
+void OpenGLWindow::drawTerrainClipmap()
+{
+	if (!terrainClipmap || terrainClipmap->getLevelCount() != clipmapLevelCount || terrainClipmap->getSpacing() != clipmapSpacing)
+	{
+		terrainClipmap = std::make_unique<TerrainClipmap>(clipmapBlockSize, clipmapLevelCount, clipmapSpacing);
+		terrainClipmapVertexBuffer = terrainClipmap->getVertexBuffer();
+		terrainClipmapIndexBuffer  = terrainClipmap->getIndexBuffer();
 
-	gl->glPolygonMode(GL_FRONT_AND_BACK, grassRasterizationMode);
+		terrainClipmapVAO = std::make_shared<ge::gl::VertexArray>();
+		terrainClipmapVAO->addElementBuffer(terrainClipmapIndexBuffer);
+		terrainClipmapVAO->addAttrib(terrainClipmapVertexBuffer, 0, 2, GL_FLOAT);
+	}
+
+	/* Only the level origins and instance offsets change, they are streamed through the frame ring */
+	Frustum frustum(mvp);
+	terrainClipmap->update(camera->getPosition(), frustum, *heightField);
+	RingBuffer::Allocation uniforms = frameRing->write(&terrainClipmap->getUniforms(), sizeof(TerrainClipmap::Uniforms));
+	if (!uniforms.data)
+	{
+		frameRingFull = true;
+		return;
+	}
+	frameRing->bindRange(GL_UNIFORM_BUFFER, 1, uniforms);
+
+	terrainClipmapShaderProgram->use();
+	terrainClipmapVAO->bind();
+
+	/* One instanced draw per mesh */
+	for (int i = 0; i < (int)TerrainClipmap::Mesh::COUNT; i++)
+	{
+		TerrainClipmap::Mesh mesh = (TerrainClipmap::Mesh)i;
+		int instanceCount = terrainClipmap->getInstanceCount(mesh);
+		if (instanceCount == 0)
+			continue;
+
+		TerrainClipmap::MeshRange range = terrainClipmap->getMesh(mesh);
+		gl->glUniform1i(uClipmapInstanceOffsetLocation, terrainClipmap->getInstanceOffset(mesh));
+		gl->glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (const void *)(range.firstIndex * sizeof(unsigned int)),
+											  instanceCount, range.baseVertex);
+	}
+}
+
+void OpenGLWindow::drawTerrainPatches()
+{
+	/* Edge levels from the projected edge length, see terrainTCS.glsl */
+	terrainTessShaderProgram->use();
+	gl->glUniform1f(uTerrainProjectionScaleLocation, camera->getProjectionMatrix()[1][1]);
+	gl->glUniform1f(uTerrainViewportHeightLocation, windowHeight * (headless ? 1.0 : devicePixelRatio()));	// physical pixels, as in resizeGL
+	gl->glUniform1f(uTerrainTargetEdgeLengthLocation, terrainTargetEdgeLength);
+	gl->glUniform1f(uTerrainMaxEdgeLevelLocation, terrainMaxEdgeLevel);
+
+	heightPyramidSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 9);
+	terrainPatchVAO->bind();
 	gl->glPatchParameteri(GL_PATCH_VERTICES, 4);
+	gl->glDrawElements(GL_PATCHES, terrain->getPatchCount() * 4, GL_UNSIGNED_INT, 0);
+}
+
+void OpenGLWindow::drawGrass(bool depthOnly)
+{
+	/* Patch list or indirect commands did not fit into the frame ring */
+	if ((cullingMode == CullingMode::CPU && visiblePatchCount > 0 && !visiblePatchesAllocation.data)
+		|| (cullingMode == CullingMode::GPU && !grassCommandsValid))
+		return;
+
+	grassVAO->bind();
+
+	gl->glPolygonMode(GL_FRONT_AND_BACK, grassRasterizationMode);
 
 	// Textures
+	gl->glActiveTexture(GL_TEXTURE0 + 1); // Texture unit 1
+	heightMap->bind();
+
+	// Shared blade data
+	patchTransSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+	patchRandomsSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 1);
+	grassBladeBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 2);
+	if (bladeStatesSSBO)
+	{
+		bladeStatesSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 7);
+		bladeRestSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 8);
+	}
+
+	// Patch list
+	if (cullingMode == CullingMode::NONE)
+		patchIndicesSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 3);
+	else if (cullingMode == CullingMode::CPU)
+		frameRing->bindRange(GL_SHADER_STORAGE_BUFFER, 3, visiblePatchesAllocation);
+	else
+		visiblePatchesSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 3);
+
+	// Depth pre-pass - alpha-tested depth only, the color pass then shades just the nearest fragment of each pixel
+	if (depthOnly)
+		gl->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	else if (grassDepthPrePass)
+	{
+		gl->glDepthMask(GL_FALSE);
+		gl->glDepthFunc(GL_LEQUAL);
+	}
+
+	// Draw
+	if (grassPath == GrassPath::COMPUTE)
+		drawGrassExpanded(depthOnly);
+	else
+		drawGrassTier((int)LodTier::NEAR, depthOnly);
+	drawGrassTier((int)LodTier::MID, depthOnly);
+	drawGrassTier((int)LodTier::FAR, depthOnly);
+
+	gl->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	gl->glDepthMask(GL_TRUE);
+	gl->glDepthFunc(GL_LESS);
+}
+
+void OpenGLWindow::drawGrassTier(int tier, bool depthOnly)
+{
+	bool indirect = cullingMode == CullingMode::GPU;
+	if (!indirect && lodPatchCounts[tier] == 0)
+		return;
+
+	GLenum mode;
+	GLsizei vertexCount;
+	GLint listOffsetLocation = uPatchListOffsetLocations[tier];
+	bool attributes = false;
+	gl->glActiveTexture(GL_TEXTURE0 + 0); // Texture unit 0
+
+	switch ((LodTier)tier)
+	{
+		case LodTier::NEAR:
+			if (grassPath == GrassPath::TESSELLATION)
+			{
+				(depthOnly ? grassDepthShaderProgram : grassShaderProgram)->use();
+				gl->glPatchParameteri(GL_PATCH_VERTICES, 4);
+				mode = GL_PATCHES;
+			}
+			else
+			{
+				/* Fixed-segment strips, blade data pulled from the SSBO or fetched as attributes */
+				attributes = grassPath == GrassPath::ATTRIBUTES;
+				if (attributes && (!bladeAttributeVAO || bladeAttributeSegmentCount != stripSegmentCount))
+				{
+					bladeAttributeVAO = grassField->getBladeAttributeVAO(getNearVerticesPerBlade());
+					bladeAttributeSegmentCount = stripSegmentCount;
+				}
+				if (attributes)
+					bladeAttributeVAO->bind();
+
+				(depthOnly ? grassStripDepthShaderProgram : grassStripShaderProgram)[attributes]->use();
+				gl->glUniform1i(uStripSegmentCountLocations[attributes], stripSegmentCount);
+				listOffsetLocation = uStripPatchListOffsetLocations[attributes];
+				mode = GL_TRIANGLE_STRIP;
+			}
+			grassAlphaTexture->bind();
+			vertexCount = grassField->getGrassBladeCount() * getNearVerticesPerBlade();
+			break;
+		case LodTier::MID:
+			(depthOnly ? grassLowDepthShaderProgram : grassLowShaderProgram)->use();
+			grassAlphaTexture->bind();
+			mode = GL_TRIANGLES;
+			vertexCount = grassField->getGrassBladeCount() * 6;
+			break;
+		case LodTier::FAR:
+		default:
+			(depthOnly ? grassCardDepthShaderProgram : grassCardShaderProgram)->use();
+			gl->glUniform2fv(uCardSizeLocation, 1, glm::value_ptr(grassCardSize));
+			gl->glBindTexture(GL_TEXTURE_2D, grassCardTexture);
+			mode = GL_TRIANGLES;
+			vertexCount = 12;	// two crossed cards
+			break;
+	}
+
+	/* GPU culling writes the list of tier t at t * patchCount, CPU lists are packed */
+	int listOffset = indirect ? tier * grassField->getPatchCount() : lodPatchOffsets[tier];
+	gl->glUniform1i(listOffsetLocation, listOffset);
+
+	if (indirect)
+	{
+		grassDrawCommandBuffer->bind(GL_DRAW_INDIRECT_BUFFER);
+		gl->glDrawArraysIndirect(mode, (const void *)(tier * 4 * sizeof(GLuint)));
+	}
+	else
+		gl->glDrawArraysInstanced(mode, 0, vertexCount, lodPatchCounts[tier]);
+
+	if (attributes)
+		grassVAO->bind();
+}
+
+int OpenGLWindow::getNearVerticesPerBlade()
+{
+	/* Strips: left and right vertex per row plus the duplicated first and last vertex */
+	if (grassPath == GrassPath::PULLING || grassPath == GrassPath::ATTRIBUTES)
+		return 2 * (stripSegmentCount + 1) + 2;
+	return 4;
+}
+
+void OpenGLWindow::drawGrassExpanded(bool depthOnly)
+{
+	bool indirect = cullingMode == CullingMode::GPU;
+	if (!indirect && lodPatchCounts[(int)LodTier::NEAR] == 0)
+		return;
+
+	/* Expanded once per frame, the color pass after the depth pre-pass reuses the strips */
+	if (depthOnly || !grassDepthPrePass)
+		expandedStripsValid = expandGrassBlades();
+	if (!expandedStripsValid)
+		return;
+
+	(depthOnly ? grassExpandedDepthShaderProgram : grassExpandedShaderProgram)->use();
+	gl->glUniform1ui(uExpandedVertexCapacityLocation, expandedVertexCapacity);
 	gl->glActiveTexture(GL_TEXTURE0 + 0); // Texture unit 0
 	grassAlphaTexture->bind();
+	expandedVertexBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 6);
+
+	/* All blade strips are joined by degenerate triangles, the vertex count was accumulated by the expansion */
+	expandedDrawCommandBuffer->bind(GL_DRAW_INDIRECT_BUFFER);
+	gl->glDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr);
+}
+
+double OpenGLWindow::getExpandedVertexBound()
+{
+	/* Near tier patches have their bounds (patch square + blade reach) within the tier distance of the camera */
+	float patchSize	   = grassField->getPatchSize();
+	float nearDistance = std::min(lodEnabled ? lodDistances.x : FLT_MAX, maxDistance);
+	float radius	   = nearDistance + patchSize * 1.5f + grassField->getPatchReach(maxBendingFactor);
+	double nearPatches = std::min(glm::pi<double>() * radius * radius / (patchSize * patchSize), (double)grassField->getPatchCount());
+
+	/* Every blade at the highest tessellation level, see grassExpandCS */
+	return nearPatches * grassField->getGrassBladeCount() * (2 * (maxTessLevel + 1) + 2);
+}
+
+bool OpenGLWindow::expandGrassBlades()
+{
+	/* Allocated on first use (the tessellation path does not need it) and grown when the settings raise the bound */
+	GLuint vertexBound = (GLuint)std::min(std::ceil(getExpandedVertexBound()), (double)expandedVertexLimit);
+	if (!expandedVertexBuffer || vertexBound > expandedVertexCapacity)
+	{
+		expandedVertexCapacity = std::max(vertexBound, 1u);
+		expandedVertexBuffer = std::make_shared<ge::gl::Buffer>((GLsizeiptr)expandedVertexCapacity * 32);	// sizeof(ExpandedVertex) in grassExpanded.glsl
+		if (getExpandedVertexBound() > expandedVertexLimit)
+			std::cout << "Strip buffer limited to " << expandedVertexCapacity << " vertices, near blades past it are dropped" << std::endl;
+	}
+
+	/* Reset the vertex count - copied from the ring like the culling commands */
+	GLuint drawCommand[4] = { 0, 1, 0, 0 };
+	RingBuffer::Allocation reset = frameRing->write(drawCommand, sizeof(drawCommand), sizeof(GLuint));
+	if (!reset.data)
+	{
+		frameRingFull = true;
+		return false;
+	}
+	gl->glCopyNamedBufferSubData(frameRing->getId(), expandedDrawCommandBuffer->getId(), reset.offset, 0, sizeof(drawCommand));
+
+	int bladeCount = grassField->getGrassBladeCount();
+
+	grassExpandShaderProgram->use();
+	gl->glUniform1i(uExpandBladeCountLocation, bladeCount);
+	gl->glUniform1ui(uExpandVertexCapacityLocation, expandedVertexCapacity);
+	expandedDrawCommandBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 5);
+	expandedVertexBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 6);
+
+	/* One work group per near tier patch and chunk of 64 blades, up to expandGroupLimit patches - the shader loops over the rest */
+	if (cullingMode == CullingMode::GPU)
+	{
+		gl->glUniform1i(uExpandPatchListOffsetLocation, 0);
+		gl->glUniform1i(uExpandPatchListCountLocation, -1);
+		grassDrawCommandBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 4);
+		grassDrawCommandBuffer->bind(GL_DISPATCH_INDIRECT_BUFFER);
+		gl->glDispatchComputeIndirect(3 * 4 * sizeof(GLuint));
+	}
+	else
+	{
+		int nearPatchCount = lodPatchCounts[(int)LodTier::NEAR];
+		gl->glUniform1i(uExpandPatchListOffsetLocation, lodPatchOffsets[(int)LodTier::NEAR]);
+		gl->glUniform1i(uExpandPatchListCountLocation, nearPatchCount);
+		gl->glDispatchCompute(std::min((GLuint)nearPatchCount, expandGroupLimit), (bladeCount + 63) / 64, 1);
+	}
+
+	gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	return true;
+}
+
+int OpenGLWindow::getSimulatedBladeCount()
+{
+	return grassField->getPatchCount() * grassField->getGrassBladeCount();
+}
+
+void OpenGLWindow::simulateBlades()
+{
+	int bladeCount = getSimulatedBladeCount();
+
+	/* Allocated on first use, one state per blade instance */
+	if (!bladeStatesSSBO)
+	{
+		bladeStatesSSBO = std::make_shared<ge::gl::Buffer>(std::max(1, bladeCount) * sizeof(BladeSimulation::State));
+		bladeRestSSBO	= std::make_shared<ge::gl::Buffer>(std::max(1, bladeCount) * sizeof(BladeSimulation::Rest));
+		resetSimulation = true;
+	}
+
+	/* The rest pose only changes with the field parameters */
+	glm::vec3 restParameters(maxBendingFactor, maxTerrainHeight, bladeStiffness);
+	if (resetSimulation || restParameters != simulatedRestParameters)
+	{
+		updateBladeRest(resetSimulation);
+		simulatedRestParameters = restParameters;
+		resetSimulation = false;
+		lastSimulationTime = time;
+	}
+
+	/* Step length follows the frame time, limited to keep the explicit step stable */
+	BladeSimulation::Parameters parameters = simulationParameters;
+	parameters.windEnabled = windEnabled;
+	parameters.windParams  = windParams;
+	parameters.time		   = time;
+	parameters.deltaTime   = glm::clamp((time - lastSimulationTime) / 1000.0f, 0.0f, 1.0f / 30.0f);
+	lastSimulationTime = time;
+
+	/* The camera pushes the blades away */
+	if (cameraColliderRadius > 0.0f)
+		parameters.colliders.push_back({ camera->getPosition(), cameraColliderRadius, camera->getPosition(), 0.0f });
+
+	dispatchSimulationStep(parameters);
+}
+
+void OpenGLWindow::updateBladeRest(bool resetState)
+{
+	int bladeCount = getSimulatedBladeCount();
+
+	bladeRestShaderProgram->use();
+	gl->glUniform1i(uRestPatchCountLocation, grassField->getPatchCount());
+	gl->glUniform1f(uRestStiffnessLocation, bladeStiffness);
+	gl->glUniform1i(uRestResetStateLocation, resetState);
+
 	gl->glActiveTexture(GL_TEXTURE0 + 1); // Texture unit 1
 	heightMap->bind();
+	patchTransSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+	patchRandomsSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 1);
+	grassBladeBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 2);
+	bladeStatesSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 7);
+	bladeRestSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 8);
+
+	gl->glDispatchCompute((bladeCount + 63) / 64, 1, 1);
+	gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
 
-	// Draw
-	gl->glDrawArraysInstanced(GL_PATCHES, 0, grassField->getGrassBladeCount() * 4, grassField->getPatchCount());
+void OpenGLWindow::dispatchSimulationStep(const BladeSimulation::Parameters &parameters)
+{
+	int bladeCount = getSimulatedBladeCount();
+
+	/* Colliders as (a, radius), (b, 0) pairs */
+	std::vector<glm::vec4> colliders;
+	for (size_t i = 0; i < parameters.colliders.size() && i < BladeSimulation::MAX_COLLIDERS; i++)
+	{
+		colliders.push_back(glm::vec4(parameters.colliders[i].a, parameters.colliders[i].radius));
+		colliders.push_back(glm::vec4(parameters.colliders[i].b, 0.0f));
+	}
+
+	bladeSimulationShaderProgram->use();
+	gl->glUniform1i(uSimInstanceCountLocation, bladeCount);
+	gl->glUniform1f(uSimGravityLocation, parameters.gravity);
+	gl->glUniform1f(uSimWindStrengthLocation, parameters.windStrength);
+	gl->glUniform1f(uSimCollisionDecayLocation, parameters.collisionDecay);
+	gl->glUniform1i(uSimTimeLocation, parameters.time);
+	gl->glUniform1f(uSimDeltaTimeLocation, parameters.deltaTime);
+	gl->glUniform1i(uSimColliderCountLocation, colliders.size() / 2);
+	if (!colliders.empty())
+		gl->glUniform4fv(uSimCollidersLocation, colliders.size(), glm::value_ptr(colliders[0]));
+
+	bladeStatesSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 7);
+	bladeRestSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 8);
+
+	gl->glDispatchCompute((bladeCount + 63) / 64, 1, 1);
+	gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 }
 
-void OpenGLWindow::drawSkybox()
+void OpenGLWindow::verifySimulation(int steps)
+{
+	/* Debug path - the same steps on the GPU and with the CPU reference from the rest pose (reads back, stalls) */
+	int bladeCount = getSimulatedBladeCount();
+	if (bladeCount > maxSimulatedBlades)
+	{
+		std::cout << "Blade simulation verification skipped: too many blades (" << bladeCount << " > " << maxSimulatedBlades << ")" << std::endl;
+		return;
+	}
+
+	if (!bladeStatesSSBO)
+	{
+		bladeStatesSSBO = std::make_shared<ge::gl::Buffer>(std::max(1, bladeCount) * sizeof(BladeSimulation::State));
+		bladeRestSSBO	= std::make_shared<ge::gl::Buffer>(std::max(1, bladeCount) * sizeof(BladeSimulation::Rest));
+	}
+	updateBladeRest(true);
+
+	std::vector<BladeSimulation::Rest> rest(bladeCount);
+	std::vector<BladeSimulation::State> states(bladeCount);
+	bladeRestSSBO->getData(rest.data(), rest.size() * sizeof(BladeSimulation::Rest));
+	bladeStatesSSBO->getData(states.data(), states.size() * sizeof(BladeSimulation::State));
+
+	/* Fixed colliders on the first standing blades so the collision response is covered too */
+	BladeSimulation::Parameters parameters = simulationParameters;
+	parameters.windEnabled = windEnabled;
+	parameters.windParams  = windParams;
+	parameters.deltaTime   = 1.0f / 60.0f;
+	for (int i = 0; i < bladeCount && parameters.colliders.size() < 2; i++)
+	{
+		glm::vec3 root = glm::vec3(rest[i].root);
+		float height = rest[i].root.w;
+		if (height <= 0.0f)
+			continue;
+		if (parameters.colliders.empty())
+			parameters.colliders.push_back({ root + glm::vec3(0.0f, height, 0.0f), height / 2, root + glm::vec3(0.0f, height, 0.0f), 0.0f });
+		else
+			parameters.colliders.push_back({ root + glm::vec3(-2.0f, height / 2, 0.0f), height / 4, root + glm::vec3(2.0f, height / 2, 0.0f), 0.0f });
+	}
+
+	for (int step = 0; step < steps; step++)
+	{
+		parameters.time = time + step * 16;
+		dispatchSimulationStep(parameters);
+		BladeSimulation::step(rest, states, parameters);
+	}
+
+	std::vector<BladeSimulation::State> gpuStates(bladeCount);
+	bladeStatesSSBO->getData(gpuStates.data(), gpuStates.size() * sizeof(BladeSimulation::State));
+	simulationError = BladeSimulation::maxDifference(states, gpuStates);
+
+	std::cout << "Blade simulation (" << bladeCount << " blades, " << steps << " steps): max. CPU/GPU difference " << simulationError
+			  << (simulationError <= BladeSimulation::TOLERANCE ? "" : " MISMATCH") << std::endl;
+
+	/* Continue from the rest pose */
+	resetSimulation = true;
+}
+
+GrassReferenceRenderer *OpenGLWindow::getReferenceRenderer()
+{
+	/* Created on first use, holds per-blade data of the current field */
+	if (!referenceRenderer)
+		referenceRenderer = std::make_unique<GrassReferenceRenderer>(grassField.get(), heightField.get());
+	return referenceRenderer.get();
+}
+
+GrassReferenceRenderer::Parameters OpenGLWindow::getReferenceParameters()
+{
+	return { camera->getPosition(), maxDistance, maxTessLevel, maxBendingFactor, maxTerrainHeight, windEnabled, windParams, time };
+}
+
+void OpenGLWindow::compareWithReference()
+{
+	/* Debug path - reads back the strips of grassExpandCS and renders the same patches on the CPU (stalls) */
+	referenceComparison = { 0, 0, 0, 0.0f, false };
+	if (grassPath != GrassPath::COMPUTE || cullingMode == CullingMode::GPU || simulationEnabled)
+	{
+		std::cout << "CPU reference comparison needs the compute path, CPU or no culling and the blade simulation off" << std::endl;
+		return;
+	}
+
+	/* Near patch list of expandGrassBlades */
+	std::vector<int> nearPatches;
+	if (cullingMode == CullingMode::NONE)
+	{
+		for (int i = 0; i < lodPatchCounts[(int)LodTier::NEAR]; i++)
+			nearPatches.push_back(i);
+	}
+	else
+		nearPatches = lodTierPatches[(int)LodTier::NEAR];
+
+	/* The command is not reset when there are no near patches */
+	GLuint drawCommand[4] = { 0, 0, 0, 0 };
+	if (!nearPatches.empty())
+		expandedDrawCommandBuffer->getData(drawCommand, sizeof(drawCommand));
+	if (drawCommand[0] > expandedVertexCapacity)
+	{
+		std::cout << "CPU reference comparison: strip buffer overflow (" << drawCommand[0] << " vertices)" << std::endl;
+		return;
+	}
+	std::vector<GrassReferenceRenderer::Vertex> gpuVertices(drawCommand[0]);
+	if (!gpuVertices.empty())
+		expandedVertexBuffer->getData(gpuVertices.data(), gpuVertices.size() * sizeof(GrassReferenceRenderer::Vertex));
+
+	const std::vector<GrassReferenceRenderer::Vertex> &cpuVertices = getReferenceRenderer()->render(nearPatches.data(), nearPatches.size(), getReferenceParameters());
+	referenceComparison = GrassReferenceRenderer::compare(cpuVertices, gpuVertices);
+
+	std::cout << "CPU reference (" << nearPatches.size() << " patches, " << referenceRenderer->getBladeCount() << " blades, "
+			  << referenceRenderer->getRenderTime() << " ms): " << referenceComparison.matchedVertexCount << " / " << referenceComparison.vertexCount
+			  << " GPU vertices matched (CPU " << referenceComparison.referenceVertexCount << "), max. error " << referenceComparison.maxError
+			  << (referenceComparison.passed ? "" : " MISMATCH") << std::endl;
+}
+
+void OpenGLWindow::cullPatches()
+{
+	/* Turned off (checkbox or culling mode) - the stats in flight would be shown when it is turned on again */
+	if ((cullingMode != CullingMode::GPU || !occlusionCulling) && occlusionStatsBuffers[0])
+		resetOcclusionStats();
+
+	if (cullingMode == CullingMode::NONE)
+	{
+		/* Everything through the full tessellated path */
+		visiblePatchCount = grassField->getPatchCount();
+		lodPatchCounts[0]  = visiblePatchCount;
+		lodPatchCounts[1]  = lodPatchCounts[2]  = 0;
+		lodPatchOffsets[0] = lodPatchOffsets[1] = lodPatchOffsets[2] = 0;
+	}
+	else if (cullingMode == CullingMode::CPU)
+	{
+		visiblePatchCount = cullPatchesCPU();
+		assignLodTiers(visiblePatchCount);
+		if (visiblePatchCount > 0)
+		{
+			visiblePatchesAllocation = frameRing->write(lodPatches.data(), visiblePatchCount * sizeof(int));
+			frameRingFull |= !visiblePatchesAllocation.data;
+		}
+	}
+	else if (cullingMode == CullingMode::GPU)
+	{
+		grassCommandsValid = cullPatchesGPU();
+
+		/* Debug path - compare the GPU instance counts with the CPU reference (stalls the pipeline) */
+		if (verifyGpuCulling)
+		{
+			GLuint drawCommands[3][4];
+			grassDrawCommandBuffer->getData(drawCommands, sizeof(drawCommands));
+			gpuVisiblePatchCount   = drawCommands[0][1] + drawCommands[1][1] + drawCommands[2][1];
+			cpuReferencePatchCount = cullPatchesCPU();
+			assignLodTiers(cpuReferencePatchCount);
+
+			/* The CPU has no depth - occluded patches count as visible, the tiers differ by them */
+			gpuOccludedPatchCount = 0;
+			if (occlusionCulling)
+				grassDrawCommandBuffer->getData(&gpuOccludedPatchCount, sizeof(GLuint), (3 * 4 + 3 + 1) * sizeof(GLuint));
+
+			if (gpuVisiblePatchCount + gpuOccludedPatchCount != cpuReferencePatchCount)
+				std::cout << "GPU culling mismatch: GPU " << gpuVisiblePatchCount << " + " << gpuOccludedPatchCount << " occluded, CPU "
+						  << cpuReferencePatchCount << std::endl;
+			for (int tier = 0; tier < 3 && !occlusionCulling; tier++)
+			{
+				if ((int)drawCommands[tier][1] != lodPatchCounts[tier])
+					std::cout << "GPU LOD tier " << tier << " mismatch: GPU " << drawCommands[tier][1] << ", CPU " << lodPatchCounts[tier] << std::endl;
+			}
+		}
+	}
+}
+
+int OpenGLWindow::cullPatchesCPU()
+{
+	glm::vec3 cameraPos = camera->getPosition();
+	Frustum frustum(mvp);
+
+	visiblePatches.resize(grassField->getPatchCount());
+
+	if (usePatchQuadtree)
+	{
+		float padding = grassField->getPatchReach(maxBendingFactor);
+		return grassField->getPatchQuadtree()->cull(frustum, cameraPos, maxDistance, padding, maxTerrainHeight, grassField->getBladeDimensions().hMax,
+													 visiblePatches.data());
+	}
+	else
+		return grassField->cullPatches(frustum, cameraPos, maxDistance, maxTerrainHeight, maxBendingFactor, visiblePatches.data());
+}
+
+bool OpenGLWindow::cullPatchesGPU()
+{
+	int patchCount = grassField->getPatchCount();
+
+	/* All patches share the horizontal bounds extent, the heights come from the height pyramid */
+	glm::vec3 min, max;
+	grassField->getPatchBounds(0, maxTerrainHeight, maxBendingFactor, min, max);
+	glm::vec2 patchHalfExtent((max.x - min.x) / 2, (max.z - min.z) / 2);
+
+	/* Reset instance counts - copied from the ring so the command buffer is never touched by the CPU */
+	GLuint bladeCount = grassField->getGrassBladeCount();
+	GLuint drawCommands[3 * 4 + 3 + 2] =
+	{
+		bladeCount * getNearVerticesPerBlade(), 0, 0, 0,	// near - tessellated patches or strips
+		bladeCount * 6, 0, 0, 0,							// mid - 2 triangles per blade
+		12, 0, 0, 0,										// far - two crossed cards
+		0, (bladeCount + 63) / 64, 1,						// near - compute expansion (patches x blade chunks)
+		0, 0												// occlusion stats - tested, occluded
+	};
+	RingBuffer::Allocation reset = frameRing->write(drawCommands, sizeof(drawCommands), sizeof(GLuint));
+	if (!reset.data)
+	{
+		/* The command buffer keeps last frame's counts - the grass is skipped this frame */
+		frameRingFull = true;
+		return false;
+	}
+	gl->glCopyNamedBufferSubData(frameRing->getId(), grassDrawCommandBuffer->getId(), reset.offset, 0, sizeof(drawCommands));
+
+	glm::vec2 tierDistances = lodEnabled ? lodDistances : glm::vec2(FLT_MAX);
+
+	/* The terrain is already in the depth buffer - the only occluder of the grass */
+	if (occlusionCulling)
+		buildHiZ();
+
+	patchCullShaderProgram->use();
+	gl->glUniform2fv(uPatchHalfExtentLocation, 1, glm::value_ptr(patchHalfExtent));
+	gl->glUniform1f(uPatchHalfSizeLocation, grassField->getPatchSize() / 2);
+	gl->glUniform1f(uPatchBladeHeightLocation, grassField->getBladeDimensions().hMax);
+	gl->glUniform1i(uPatchCountLocation, patchCount);
+	gl->glUniform2fv(uLodDistancesLocation, 1, glm::value_ptr(tierDistances));
+	gl->glUniform1i(uOcclusionCullingLocation, occlusionCulling);
+	gl->glUniform1i(uHiZLevelCountLocation, hiZLevelCount);
+	gl->glUniform1ui(uExpandGroupLimitLocation, expandGroupLimit);
+	gl->glBindTextureUnit(2, hiZTexture);
+
+	patchTransSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 0);
+	visiblePatchesSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 3);
+	grassDrawCommandBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 4);
+	heightPyramidSSBO->bindBase(GL_SHADER_STORAGE_BUFFER, 9);
+
+	gl->glDispatchCompute((patchCount + 63) / 64, 1, 1);
+	gl->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	/* Occlusion stats without stalling - every frame copies them into its own buffer, which is read when the slot comes around again,
+	   after the frameRing fence of that frame has passed */
+	if (occlusionCulling)
+	{
+		std::shared_ptr<ge::gl::Buffer> &statsBuffer = occlusionStatsBuffers[occlusionStatsFrame];
+		if (statsBuffer)
+			statsBuffer->getData(occlusionStats, sizeof(occlusionStats));
+		else
+			statsBuffer = std::make_shared<ge::gl::Buffer>(sizeof(occlusionStats));
+
+		gl->glCopyNamedBufferSubData(grassDrawCommandBuffer->getId(), statsBuffer->getId(), (3 * 4 + 3) * sizeof(GLuint), 0, sizeof(occlusionStats));
+		occlusionStatsFrame = (occlusionStatsFrame + 1) % occlusionStatsLatency;
+	}
+	return true;
+}
+
+void OpenGLWindow::resetOcclusionStats()
+{
+	occlusionStats[0] = occlusionStats[1] = 0;
+	for (int i = 0; i < occlusionStatsLatency; i++)
+		occlusionStatsBuffers[i].reset();
+	occlusionStatsFrame = 0;
+}
+
+void OpenGLWindow::buildHiZ()
+{
+	GLint framebuffer, viewport[4];
+	gl->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+	gl->glGetIntegerv(GL_VIEWPORT, viewport);
+
+	/* Level 0 matches the framebuffer texel for texel, recreated when it is resized */
+	if (viewport[2] != hiZWidth || viewport[3] != hiZHeight)
+	{
+		if (hiZTexture)
+		{
+			gl->glDeleteFramebuffers(1, &hiZDepthFramebuffer);
+			gl->glDeleteTextures(1, &hiZDepthTexture);
+			gl->glDeleteTextures(1, &hiZTexture);
+		}
+		hiZWidth	  = viewport[2];
+		hiZHeight	  = viewport[3];
+		hiZLevelCount = (int)std::log2(std::max(hiZWidth, hiZHeight)) + 1;
+
+		/* Same format as the window depth buffer, so the depth can be blitted */
+		gl->glCreateTextures(GL_TEXTURE_2D, 1, &hiZDepthTexture);
+		gl->glTextureStorage2D(hiZDepthTexture, 1, GL_DEPTH24_STENCIL8, hiZWidth, hiZHeight);
+		gl->glTextureParameteri(hiZDepthTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		gl->glTextureParameteri(hiZDepthTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		gl->glCreateFramebuffers(1, &hiZDepthFramebuffer);
+		gl->glNamedFramebufferTexture(hiZDepthFramebuffer, GL_DEPTH_STENCIL_ATTACHMENT, hiZDepthTexture, 0);
+
+		gl->glCreateTextures(GL_TEXTURE_2D, 1, &hiZTexture);
+		gl->glTextureStorage2D(hiZTexture, hiZLevelCount, GL_R32F, hiZWidth, hiZHeight);
+		gl->glTextureParameteri(hiZTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		gl->glTextureParameteri(hiZTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	gl->glBlitNamedFramebuffer(framebuffer, hiZDepthFramebuffer, 0, 0, hiZWidth, hiZHeight, 0, 0, hiZWidth, hiZHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	/* Level by level, each one reads the previous */
+	hiZBuildShaderProgram->use();
+	gl->glBindTextureUnit(0, hiZDepthTexture);
+	for (int level = 0; level < hiZLevelCount; level++)
+	{
+		int width  = std::max(1, hiZWidth >> level);
+		int height = std::max(1, hiZHeight >> level);
+
+		gl->glUniform1i(uHiZLevelLocation, level);
+		gl->glBindImageTexture(0, hiZTexture, std::max(0, level - 1), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		gl->glBindImageTexture(1, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		gl->glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+		gl->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+}
+
+void OpenGLWindow::assignLodTiers(int visibleCount)
+{
+	/* Tier by the distance from the camera to the patch bounds, same as patchCullCS.glsl */
+	glm::vec3 cameraPos = camera->getPosition();
+	glm::vec2 tierDistances = lodEnabled ? lodDistances : glm::vec2(FLT_MAX);
+	glm::vec3 min, max;
+
+	for (auto &tierPatches : lodTierPatches)
+		tierPatches.clear();
+
+	for (int i = 0; i < visibleCount; i++)
+	{
+		grassField->getPatchBounds(visiblePatches[i], maxTerrainHeight, maxBendingFactor, min, max);
+		float distance = glm::length(glm::clamp(cameraPos, min, max) - cameraPos);
+		int tier = distance < tierDistances.x ? 0 : (distance < tierDistances.y ? 1 : 2);
+		lodTierPatches[tier].push_back(visiblePatches[i]);
+	}
+
+	/* Front to back within each tier, so the depth test rejects the blades behind nearer patches before shading */
+	if (sortPatchesFrontToBack)
+	{
+		std::vector<glm::vec3> &positions = *grassField->getPatchPositions();
+		auto distance2 = [&](int patch) { glm::vec2 d(positions[patch].x - cameraPos.x, positions[patch].z - cameraPos.z); return glm::dot(d, d); };
+		for (auto &tierPatches : lodTierPatches)
+			std::sort(tierPatches.begin(), tierPatches.end(), [&](int a, int b) { return distance2(a) < distance2(b); });
+	}
+
+	/* Pack the tiers into one list: near | mid | far */
+	lodPatches.clear();
+	for (int tier = 0; tier < 3; tier++)
+	{
+		lodPatchOffsets[tier] = lodPatches.size();
+		lodPatchCounts[tier]  = lodTierPatches[tier].size();
+		lodPatches.insert(lodPatches.end(), lodTierPatches[tier].begin(), lodTierPatches[tier].end());
+	}
+}
+
+void OpenGLWindow::bakeGrassCard()
+{
+	const int cardWidth	 = 512;
+	const int cardHeight = 128;
+
+	/* The card covers the patch plus the blade reach, blades are rendered from the side */
+	GrassField::BladeDimensions bladeDimensions = grassField->getBladeDimensions();
+	float margin = bladeDimensions.wMax + maxBendingFactor;
+	float patchSize = grassField->getPatchSize();
+	grassCardSize = glm::vec2(patchSize + 2 * margin, bladeDimensions.hMax + maxBendingFactor);
+
+	if (!grassCardTexture)
+	{
+		gl->glCreateTextures(GL_TEXTURE_2D, 1, &grassCardTexture);
+		gl->glTextureStorage2D(grassCardTexture, 8, GL_RGBA8, cardWidth, cardHeight);
+		gl->glTextureParameteri(grassCardTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		gl->glTextureParameteri(grassCardTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		gl->glTextureParameteri(grassCardTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		gl->glTextureParameteri(grassCardTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		gl->glCreateRenderbuffers(1, &grassCardDepthBuffer);
+		gl->glNamedRenderbufferStorage(grassCardDepthBuffer, GL_DEPTH_COMPONENT24, cardWidth, cardHeight);
+
+		gl->glCreateFramebuffers(1, &grassCardFramebuffer);
+		gl->glNamedFramebufferTexture(grassCardFramebuffer, GL_COLOR_ATTACHMENT0, grassCardTexture, 0);
+		gl->glNamedFramebufferRenderbuffer(grassCardFramebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, grassCardDepthBuffer);
+	}
+
+	GLint previousFramebuffer, previousViewport[4];
+	gl->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	gl->glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	gl->glBindFramebuffer(GL_FRAMEBUFFER, grassCardFramebuffer);
+	gl->glViewport(0, 0, cardWidth, cardHeight);
+
+	/* Transparent texels keep the bottom grass color so filtering does not darken the edges */
+	const float clearColor[4] = { 0.086f, 0.288f, 0.213f, 0.0f };
+	const float clearDepth = 1.0f;
+	gl->glClearNamedFramebufferfv(grassCardFramebuffer, GL_COLOR, 0, clearColor);
+	gl->glClearNamedFramebufferfv(grassCardFramebuffer, GL_DEPTH, 0, &clearDepth);
+
+	glm::mat4 projection = glm::ortho(-grassCardSize.x / 2, grassCardSize.x / 2, 0.0f, grassCardSize.y, -patchSize, patchSize);
+
+	grassCardBakeShaderProgram->use();
+	gl->glUniformMatrix4fv(uBakeProjectionLocation, 1, GL_FALSE, glm::value_ptr(projection));
+	gl->glUniform1f(uBakeBendingFactorLocation, maxBendingFactor);
+
+	grassVAO->bind();
+	grassBladeBuffer->bindBase(GL_SHADER_STORAGE_BUFFER, 2);
+	gl->glActiveTexture(GL_TEXTURE0 + 0);
+	grassAlphaTexture->bind();
+	gl->glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	gl->glDrawArrays(GL_TRIANGLES, 0, grassField->getGrassBladeCount() * 6);
+
+	gl->glGenerateTextureMipmap(grassCardTexture);
+
+	gl->glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	gl->glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+void OpenGLWindow::updateFrameUniforms()
 {
 	glm::mat4 view = glm::mat4(glm::mat3(camera->getViewMatrix())); // remove translation from the view matrix
 	glm::mat4 proj = camera->getProjectionMatrix();
-	glm::mat4 skyboxMVP = proj * view;
+	Frustum frustum(mvp);
+
+	frameUniforms.mvp		= mvp;
+	frameUniforms.skyboxMVP = proj * view;
+	for (int i = 0; i < 6; i++)
+		frameUniforms.frustumPlanes[i] = frustum.getPlanes()[i];
+	frameUniforms.cameraPos			= camera->getPosition();
+	frameUniforms.maxDistance		= maxDistance;
+	frameUniforms.lightPos			= lightPosition;
+	frameUniforms.maxTerrainHeight	= maxTerrainHeight;
+	frameUniforms.lightColor		= lightColor;
+	frameUniforms.maxBendingFactor	= maxBendingFactor;
+	frameUniforms.windParams		= windParams;
+	frameUniforms.fieldSize			= grassField->getFieldSize();
+	frameUniforms.terrainWidth		= terrain->getTerrainWidth();
+	frameUniforms.terrainHeight		= terrain->getTerrainLength();
+	frameUniforms.time				= time;
+	frameUniforms.maxTessLevel		= maxTessLevel;
+	frameUniforms.windEnabled		= windEnabled;
+	frameUniforms.lightingEnabled	= lightingEnabled;
+	frameUniforms.simulationEnabled = simulationEnabled && bladeStatesSSBO;
+	frameUniforms.overdrawView		= overdrawView;
+
+	/* Single write per frame into the mapped ring */
+	RingBuffer::Allocation allocation = frameRing->write(&frameUniforms, sizeof(FrameUniforms));
+	if (!allocation.data)
+	{
+		frameRingFull = true;
+		return;
+	}
+	frameRing->bindRange(GL_UNIFORM_BUFFER, 0, allocation);
+}
 
+GLsizeiptr OpenGLWindow::getFrameRingSize()
+{
+	/* Frame uniforms + full visible patch list + culling commands + expansion command + terrain chunk commands (interior and 4 edges)
+	   + clipmap uniforms, each padded to the offset alignment */
+	const GLsizeiptr alignmentSlack = 256;
+	return sizeof(FrameUniforms) + grassField->getPatchCount() * sizeof(int) + (3 * 4 + 3 + 2) * sizeof(GLuint) + 4 * sizeof(GLuint)
+		 + terrain->getChunkCount() * 5 * sizeof(Terrain::DrawCommand) + sizeof(TerrainClipmap::Uniforms) + 6 * alignmentSlack;
+}
+
+std::shared_ptr<ge::gl::Buffer> OpenGLWindow::createHeightPyramidSSBO()
+{
+	/* heightPyramidBuffer in heightPyramid.glsl - level table (width, height, first tile), height map info, tiles of all levels */
+	const std::vector<HeightField::PyramidLevel> &pyramid = heightField->getPyramid();
+	int levelCount = std::min((int)pyramid.size(), maxHeightPyramidLevels);
+
+	std::vector<glm::ivec4> header(maxHeightPyramidLevels + 1, glm::ivec4(0));
+	std::vector<glm::vec2> tiles;
+	for (int level = 0; level < levelCount; level++)
+	{
+		header[level] = glm::ivec4(pyramid[level].width, pyramid[level].height, (int)tiles.size(), 0);
+		tiles.insert(tiles.end(), pyramid[level].ranges.begin(), pyramid[level].ranges.end());
+	}
+	header[maxHeightPyramidLevels] = glm::ivec4(heightField->getWidth(), heightField->getHeight(), HeightField::TILE_SIZE, levelCount);
+
+	std::vector<char> data(header.size() * sizeof(glm::ivec4) + tiles.size() * sizeof(glm::vec2));
+	std::memcpy(data.data(), header.data(), header.size() * sizeof(glm::ivec4));
+	std::memcpy(data.data() + header.size() * sizeof(glm::ivec4), tiles.data(), tiles.size() * sizeof(glm::vec2));
+
+	return std::make_shared<ge::gl::Buffer>(data.size(), data.data());
+}
+
+std::string OpenGLWindow::loadShaderSource(std::string fileName)
+{
+	std::string source = ge::util::loadTextFile(fileName);
+	std::string directory = fileName.substr(0, fileName.find_last_of('/') + 1);
+
+	/* Resolve #include "file" directives (paths relative to the including file) */
+	std::istringstream stream(source);
+	std::string line, result;
+	while (std::getline(stream, line))
+	{
+		if (line.rfind("#include", 0) == 0)
+		{
+			size_t first = line.find('"');
+			size_t last  = line.rfind('"');
+			if (first == std::string::npos || last <= first + 1)
+			{
+				/* #error fails the compilation, so the shader is not built without the included code */
+				std::cout << "Malformed #include in " << fileName << ": " << line << std::endl;
+				result += "#error malformed #include\n";
+				continue;
+			}
+			result +=loadShaderSource(directory + line.substr(first + 1, last - first - 1)) + "\n";
+		}
+		else
+			result += line + "\n";
+	}
+
+	return result;
+}
+
+void OpenGLWindow::drawSkybox()
+{
 	gl->glDepthMask(GL_FALSE);
 
 	skyboxShaderProgram->use();
-	skyboxShaderProgram->setMatrix4fv("uMVP", glm::value_ptr(skyboxMVP));
 	skyboxVAO->bind();
 
 	// Textures
@@ -540,7 +2029,6 @@ void OpenGLWindow::drawDummy()
 {
 	dummyShaderProgram->use();
 	dummyVAO->bind();
-	dummyShaderProgram->setMatrix4fv("uMVP", glm::value_ptr(mvp));
 
 	gl->glPolygonMode(GL_FRONT_AND_BACK, rasterizationMode);
 	gl->glActiveTexture(GL_TEXTURE0 + 0); // Texture unit 0
@@ -549,42 +2037,54 @@ void OpenGLWindow::drawDummy()
 	gl->glDrawArrays(GL_TRIANGLES, 0, 36);
 }
 
-void OpenGLWindow::regenerateField(float fieldSize, float patchSize, int grassBladeCount, float terrainWidth, float terrainLength, int rows, int cols, GrassField::BladeDimensions bladeDimensions)
+void OpenGLWindow::regenerateField(float fieldSize, float patchSize, int grassBladeCount, float terrainWidth, float terrainLength, int rows, int cols, GrassField::BladeDimensions bladeDimensions, unsigned int seed, int threadCount)
 {
 	grassField.reset();
 	terrain.reset();
 	patchTransSSBO.reset();
 	patchRandomsSSBO.reset();
+	patchIndicesSSBO.reset();
+	visiblePatchesSSBO.reset();
 
-	grassPositionBuffer.reset();
-	grassCenterPositionBuffer.reset();
-	grassTexCoordBuffer.reset();
-	grassRandomsBuffer.reset();
+	grassBladeBuffer.reset();
 	grassVAO.reset();
 
 	terrainPositionBuffer.reset();
 	terrainIndexBuffer.reset();
 	terrainIndexBuffer.reset();
 	terrainVAO.reset();
-
-	grassField = std::make_shared<GrassField>(fieldSize, patchSize, grassBladeCount, bladeDimensions);
+	terrainChunkVertexBuffer.reset();
+	terrainChunkIndexBuffer.reset();
+	terrainChunkBoundsBuffer.reset();
+	terrainChunkVAO.reset();
+	terrainPatchVertexBuffer.reset();
+	terrainPatchIndexBuffer.reset();
+	terrainPatchVAO.reset();
+
+	grassField = std::make_shared<GrassField>(fieldSize, patchSize, grassBladeCount, bladeDimensions, seed, threadCount);
+	grassField->setHeightField(*heightField);
 	terrain = std::make_shared<Terrain>(terrainWidth, terrainLength, rows, cols);
+	terrain->setIndexFormat(terrainIndexFormat);
 
 	/* Grass VAO setup */
-	grassPositionBuffer = grassField->getGrassVertexBuffer();
-	grassCenterPositionBuffer = grassField->getGrassCenterBuffer();
-	grassTexCoordBuffer = grassField->getGrassTexCoordBuffer();
-	grassRandomsBuffer = grassField->getGrassRandomsBuffer();
+	grassBladeBuffer = grassField->getGrassBladeBuffer();
 	patchTransSSBO = grassField->getPatchTransSSBO();
 	patchRandomsSSBO = grassField->getPatchRandomsSSBO();
 	grassShaderProgram->bindBuffer("patchTranslationsBuffer", patchTransSSBO);
 	grassShaderProgram->bindBuffer("patchRandomsBuffer", patchRandomsSSBO);
-
-	grassVAO = std::make_shared<ge::gl::VertexArray>();
-	grassVAO->addAttrib(grassPositionBuffer, 0, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassCenterPositionBuffer, 1, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassTexCoordBuffer, 2, 4, GL_FLOAT);
-	grassVAO->addAttrib(grassRandomsBuffer, 3, 4, GL_FLOAT);
+	grassShaderProgram->bindBuffer("grassBladesBuffer", grassBladeBuffer);
+	patchIndicesSSBO   = grassField->getPatchIndicesSSBO();
+	visiblePatchesSSBO = std::make_shared<ge::gl::Buffer>(std::max(1, 3 * grassField->getPatchCount()) * sizeof(int));
+	frameRing->reserve(getFrameRingSize());
+	expandedVertexBuffer.reset();
+	expandedVertexCapacity = 0;
+
+	grassVAO = grassField->getGrassVAO();
+	bladeAttributeVAO.reset();
+	referenceRenderer.reset();
+	bladeStatesSSBO.reset();
+	bladeRestSSBO.reset();
+	bakeGrassCard();
 
 	/* Terrain VAO setup */
 	terrainPositionBuffer = terrain->getTerrainVertexBuffer();
@@ -593,6 +2093,22 @@ void OpenGLWindow::regenerateField(float fieldSize, float patchSize, int grassBl
 	terrainVAO = std::make_shared<ge::gl::VertexArray>();
 	terrainVAO->addElementBuffer(terrainIndexBuffer);
 	terrainVAO->addAttrib(terrainPositionBuffer, 0, 2, GL_FLOAT);
+
+	terrainChunkVertexBuffer = terrain->getChunkVertexBuffer();
+	terrainChunkIndexBuffer  = terrain->getChunkIndexBuffer();
+	terrainChunkBoundsBuffer = terrain->getChunkBoundsBuffer();
+
+	terrainChunkVAO = std::make_shared<ge::gl::VertexArray>();
+	terrainChunkVAO->addElementBuffer(terrainChunkIndexBuffer);
+	terrainChunkVAO->addAttrib(terrainChunkVertexBuffer, 0, 2, GL_UNSIGNED_SHORT, 0, 0, GL_TRUE);
+	terrainChunkVAO->addAttrib(terrainChunkBoundsBuffer, 1, 4, GL_FLOAT, 0, 0, GL_FALSE, 1);
+
+	terrainPatchVertexBuffer = terrain->getPatchVertexBuffer();
+	terrainPatchIndexBuffer	 = terrain->getPatchIndexBuffer();
+
+	terrainPatchVAO = std::make_shared<ge::gl::VertexArray>();
+	terrainPatchVAO->addElementBuffer(terrainPatchIndexBuffer);
+	terrainPatchVAO->addAttrib(terrainPatchVertexBuffer, 0, 2, GL_FLOAT);
 }
 
 void OpenGLWindow::wheelEvent(QWheelEvent *event)
@@ -662,7 +2178,20 @@ void OpenGLWindow::keyPressEvent(QKeyEvent *event)
 	{
 		QString fileName = QFileDialog::getOpenFileName(this, tr("Open Image"), "../res", tr("Image Files (*.png *.jpg *.bmp)"));
 		if (fileName != NULL)
-			heightMap = new QOpenGLTexture(QImage(fileName).mirrored());
+		{
+			/* The old texture and pyramid are released in the widget's context */
+			makeCurrent();
+			QImage image = QImage(fileName).mirrored();
+			delete heightMap;
+			heightMap	= new QOpenGLTexture(image);
+			heightField = std::make_unique<HeightField>(image);
+			heightField->setTerrainSize(terrain->getTerrainWidth(), terrain->getTerrainLength(), maxTerrainHeight);
+			heightPyramidSSBO = createHeightPyramidSSBO();
+			doneCurrent();
+			grassField->setHeightField(*heightField);
+			referenceRenderer.reset();
+			resetSimulation = true;		// rest pose (blade roots on the terrain) is rebuilt by bladeRestCS
+		}
 	}
 
 	update();
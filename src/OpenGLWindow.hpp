@@ -24,18 +24,81 @@
 #include <imgui.h>
 
 #include <memory>
+#include <future>
+#include <chrono>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <cstring>
 
 #include "Camera.hpp"
 #include "GrassField.hpp"
+#include "Benchmark.hpp"
+#include "Frustum.hpp"
+#include "RingBuffer.hpp"
+#include "GpuTimer.hpp"
+#include "PipelineStatistics.hpp"
+#include "BladeSimulation.hpp"
+#include "HeightField.hpp"
+#include "GrassReferenceRenderer.hpp"
+#include "TerrainClipmap.hpp"
 
 class OpenGLWindow : public QOpenGLWidget, protected QOpenGLFunctions_4_5_Core
 {
 	Q_OBJECT
 public:
-	explicit OpenGLWindow();
+	/* How the near tier blades are generated */
+	enum class GrassPath
+	{
+		TESSELLATION,	// hardware tessellation of 4-vertex patches
+		COMPUTE,		// strips expanded by grassExpandCS
+		PULLING,		// fixed-segment strips, blade data pulled from the SSBO
+		ATTRIBUTES		// fixed-segment strips, blade data from vertex attributes
+	};
+
+	/* Where the grass patches are culled */
+	enum class CullingMode { NONE, CPU, GPU };
+
+	/* How the terrain grid is drawn */
+	enum class TerrainMode
+	{
+		STRIP,			// one strip grid of rows x cols vertices
+		CHUNKED,		// culled chunks with distance LOD (geomipmapping)
+		CLIPMAP,		// nested grid rings around the camera, independent of the terrain size
+		TESSELLATED		// coarse quad patches tessellated by the projected edge length
+	};
+
+	explicit OpenGLWindow(bool headless = false);
 	~OpenGLWindow();
 
+	/* Headless rendering into an external framebuffer (benchmark mode), the caller owns the context */
+	void initializeHeadless(GLuint framebuffer, int width, int height);
+	void renderHeadlessFrame(int time);	// time in ms
+	Camera *getCamera();
+	GpuTimer *getGpuTimer();
+	PipelineStatistics *getGrassStatistics();
+	PipelineStatistics *getGrassPrePassStatistics();	// issues queries only while the depth pre-pass is on
+	PipelineStatistics *getTerrainStatistics();
+	void setMaxDistance(float maxDistance);
+	void setLodEnabled(bool lodEnabled);
+	void setGrassPath(GrassPath grassPath);
+	void setTerrainMode(TerrainMode terrainMode);
+	void setTerrainIndexFormat(Terrain::IndexFormat indexFormat);	// strip grid, rebuilds its index buffer
+	void setGrassDepthPrePass(bool grassDepthPrePass);
+	void setSortPatchesFrontToBack(bool sortPatchesFrontToBack);	// CPU culling only
+	void setOverdrawView(bool overdrawView);
+	void setCullingMode(CullingMode cullingMode);
+	void setOcclusionCulling(bool occlusionCulling);				// GPU culling only
+	void getOcclusionStats(GLuint &tested, GLuint &occluded);		// occlusionStatsLatency frames old, 0 while occlusion culling is off
+	int getTerrainTriangleCount();					// drawn in the last frame
+	void printTerrainStatistics();					// once at startup, the GUI shows them for regenerated terrain
+	void setSimulationEnabled(bool simulationEnabled);
+	void requestSimulationVerification(int steps);	// runs in the next frame
+	float getSimulationError();						// -1 before the first verification
+	void requestReferenceComparison();				// runs in the next frame, needs the compute path
+	GrassReferenceRenderer::Comparison getReferenceComparison();
+	GrassReferenceRenderer *renderReferenceFrame(int time, int threadCount = 0);	// CPU only, works without a GL context
+
 public slots:
 	void tick();
 
@@ -47,11 +110,41 @@ protected:
 	void printError() const;
 	void initGui();
 	void drawTerrain();
-	void drawGrass();
+	void drawTerrainChunks();
+	void drawTerrainClipmap();
+	void drawTerrainPatches();
+	void drawGrass(bool depthOnly);
+	void drawGrassTier(int tier, bool depthOnly);
+	void drawGrassExpanded(bool depthOnly);
+	bool expandGrassBlades();
+	double getExpandedVertexBound();
+	int getNearVerticesPerBlade();
+	void simulateBlades();
+	void updateBladeRest(bool resetState);
+	void dispatchSimulationStep(const BladeSimulation::Parameters &parameters);
+	void verifySimulation(int steps);
+	int getSimulatedBladeCount();
+	GrassReferenceRenderer *getReferenceRenderer();
+	GrassReferenceRenderer::Parameters getReferenceParameters();
+	void compareWithReference();
+	void bakeGrassCard();
 	void drawSkybox();
 	void drawDummy();
+	void cullPatches();
+	int cullPatchesCPU();
+	bool cullPatchesGPU();
+	void buildHiZ();
+	void resetOcclusionStats();
+	void assignLodTiers(int visibleCount);
+	void updateFrameUniforms();
+	void updateWind();
+	void keepCameraAboveGround();
+	GLsizeiptr getFrameRingSize();
+	std::shared_ptr<ge::gl::Buffer> createHeightPyramidSSBO();
+
+	std::string loadShaderSource(std::string fileName);
 
-	void regenerateField(float fieldSize, float patchSize, int grassBladeCount, float terrainWidth, float terrainHeight, int rows, int cols, GrassField::BladeDimensions bladeDimensions);
+	void regenerateField(float fieldSize, float patchSize, int grassBladeCount, float terrainWidth, float terrainHeight, int rows, int cols, GrassField::BladeDimensions bladeDimensions, unsigned int seed, int threadCount);
 
 	/* Event handlers */
 	void wheelEvent(QWheelEvent* event);
@@ -63,6 +156,34 @@ protected:
 	unsigned int loadSkybox(std::vector<QString> faces);
 
 private:
+	enum class Pass { SKYBOX, TERRAIN, SIMULATION, CULLING, GRASS, GUI };
+	enum class LodTier { NEAR, MID, FAR };	// tessellated, flat 2-triangle blades, grass cards
+
+	/* Mirrors the FrameUniforms block in shaders/frameUniforms.glsl (std140) */
+	struct FrameUniforms
+	{
+		glm::mat4 mvp;
+		glm::mat4 skyboxMVP;
+		glm::vec4 frustumPlanes[6];
+		glm::vec3 cameraPos;
+		float	  maxDistance;
+		glm::vec3 lightPos;
+		float	  maxTerrainHeight;
+		glm::vec3 lightColor;
+		float	  maxBendingFactor;
+		glm::vec3 windParams;
+		float	  fieldSize;
+		float	  terrainWidth;
+		float	  terrainHeight;
+		int		  time;
+		int		  maxTessLevel;
+		int		  windEnabled;
+		int		  lightingEnabled;
+		int		  simulationEnabled;
+		int		  overdrawView;
+	};
+	static_assert(sizeof(FrameUniforms) == 320, "FrameUniforms must match the std140 layout");
+
 	bool initialized;
 	int maxTessLevel = 5;
 	float maxBendingFactor = 0.3f;
@@ -70,6 +191,8 @@ private:
 	float maxTerrainHeight = 30.0f;
 	int time;
 	float cameraSpeed = 3.0f;
+	bool cameraGroundCollision = true;
+	float cameraGroundClearance = 2.0f;		// eye height above the terrain
 	int windowWidth;
 	int windowHeight;
 
@@ -77,9 +200,84 @@ private:
 	bool lightingEnabled = false;
 	bool skyboxEnabled = true;
 	bool guiEnabled = true;
+	bool headless = false;
+	GLuint headlessFramebuffer = 0;
 	bool controlPressed = false;
+	std::future<void> cpuBenchmark;				// Benchmark run from the GUI, off the GUI thread
+
+	CullingMode cullingMode = CullingMode::CPU;
+	std::vector<int> visiblePatches;
+	int visiblePatchCount = 0;
+	bool verifyGpuCulling = false;
+	bool usePatchQuadtree = true;
+	int cpuReferencePatchCount = 0;
+	int gpuVisiblePatchCount = 0;
+
+	bool occlusionCulling = false;				// GPU culling only, against a Hi-Z pyramid of the terrain depth
+	GLuint gpuOccludedPatchCount = 0;			// read back with verifyGpuCulling
+	GLuint occlusionStats[2] = { 0, 0 };		// patches tested against the Hi-Z, occluded - occlusionStatsLatency frames old
+	static const int occlusionStatsLatency = 3;	// frames, regions of frameRing
+	int occlusionStatsFrame = 0;
+	GLuint hiZDepthTexture = 0;
+	GLuint hiZDepthFramebuffer = 0;
+	GLuint hiZTexture = 0;						// R32F, farthest depth per texel, level 0 at the framebuffer size
+	int hiZWidth = 0;
+	int hiZHeight = 0;
+	int hiZLevelCount = 0;
+
+	bool lodEnabled = true;
+	glm::vec2 lodDistances{ 150.0f, 300.0f };	// end of the near and mid tier
+	std::vector<int> lodTierPatches[3];
+	std::vector<int> lodPatches;				// visible patches ordered near | mid | far
+	int lodPatchCounts[3] = { 0, 0, 0 };
+	int lodPatchOffsets[3] = { 0, 0, 0 };
+	bool sortPatchesFrontToBack = false;		// CPU culling, GPU lists are in atomic append order
+	bool grassDepthPrePass = false;
+	bool overdrawView = false;					// additive grass fragment count instead of shading
+	glm::vec2 grassCardSize;
+	GLuint grassCardTexture = 0;
+	GLuint grassCardDepthBuffer = 0;
+	GLuint grassCardFramebuffer = 0;
+
+	GrassPath grassPath = GrassPath::TESSELLATION;
+	GLuint expandedVertexCapacity = 0;			// 32 B per vertex, sized by getExpandedVertexBound
+	GLuint expandedVertexLimit = 1 << 24;		// 512 MB, lowered to GL_MAX_SHADER_STORAGE_BLOCK_SIZE
+	GLuint expandGroupLimit = 65535;			// GL_MAX_COMPUTE_WORK_GROUP_COUNT x, patches per expansion dispatch
+	int stripSegmentCount = 5;
+	int bladeAttributeSegmentCount = 0;			// segment count bladeAttributeVAO was built for
+
+	bool simulationEnabled = false;
+	bool simulationBladeLimitHit = false;				// switched off because of maxSimulatedBlades
+	bool resetSimulation = true;
+	BladeSimulation::Parameters simulationParameters;	// time, step and colliders are set per step
+	float bladeStiffness = 40.0f;
+	float cameraColliderRadius = 2.0f;
+	glm::vec3 simulatedRestParameters{ -1.0f };			// bending factor, terrain height, stiffness of the current rest pose
+	int lastSimulationTime = 0;
+	int simulationVerifySteps = 0;
+	float simulationError = -1.0f;
+	const int maxSimulatedBlades = 4000000;				// 80 B of state per blade
+
+	std::unique_ptr<HeightField> heightField;			// CPU copy of heightMap
+	const int maxHeightPyramidLevels = 16;				// MAX_PYRAMID_LEVELS in heightPyramid.glsl
+	std::unique_ptr<GrassReferenceRenderer> referenceRenderer;
+	bool referenceComparisonRequested = false;
+	GrassReferenceRenderer::Comparison referenceComparison{ 0, 0, 0, 0.0f, false };
+
+	TerrainMode terrainMode = TerrainMode::STRIP;
+	Terrain::IndexFormat terrainIndexFormat = Terrain::IndexFormat::STRIP;
+	float chunkLodDistance = 50.0f;						// level 0 below, then one level per doubling
+	std::vector<Terrain::DrawCommand> chunkDrawCommands;
+	int visibleChunkCount = 0;
+	std::unique_ptr<TerrainClipmap> terrainClipmap;		// created on first use, rebuilt when the layout changes
+	int clipmapLevelCount = 6;
+	float clipmapSpacing = 1.0f;						// of the finest level
+	const int clipmapBlockSize = 16;					// levels of 63 x 63 vertices
+	float terrainTargetEdgeLength = 16.0f;				// pixels per tessellated edge
+	float terrainMaxEdgeLevel = Terrain::TESS_PATCH_QUADS;	// matches the strip grid, higher levels go finer than the height map
 
 	glm::mat4 mvp;
+	FrameUniforms frameUniforms;
 	glm::vec3 lightPosition { 100.0, 500.0, 100.0 };
 	glm::vec3 lightColor{ 0.086, 0.837, 0.388 };
 	glm::vec3 windParams{ 1.0, 1.0, 0.0 };
@@ -95,28 +293,112 @@ private:
 	GLenum grassRasterizationMode = GL_FILL;
 	GLenum terrainRasterizationMode = GL_FILL;
 
-	std::shared_ptr<ge::gl::Buffer> grassPositionBuffer;
-	std::shared_ptr<ge::gl::Buffer> grassCenterPositionBuffer;
-	std::shared_ptr<ge::gl::Buffer> grassTexCoordBuffer;
-	std::shared_ptr<ge::gl::Buffer> grassRandomsBuffer;
+	std::shared_ptr<ge::gl::Buffer> grassBladeBuffer;
 	std::shared_ptr<ge::gl::Buffer> terrainPositionBuffer;
 	std::shared_ptr<ge::gl::Buffer> terrainIndexBuffer;
 	std::shared_ptr<ge::gl::Buffer> terrainTexCoordBuffer;
+	std::shared_ptr<ge::gl::Buffer> terrainChunkVertexBuffer;
+	std::shared_ptr<ge::gl::Buffer> terrainChunkIndexBuffer;
+	std::shared_ptr<ge::gl::Buffer> terrainChunkBoundsBuffer;
+	std::shared_ptr<ge::gl::Buffer> terrainClipmapVertexBuffer;
+	std::shared_ptr<ge::gl::Buffer> terrainClipmapIndexBuffer;
+	std::shared_ptr<ge::gl::Buffer> terrainPatchVertexBuffer;
+	std::shared_ptr<ge::gl::Buffer> terrainPatchIndexBuffer;
 	std::shared_ptr<ge::gl::Buffer> dummyPositionBuffer;
 	std::shared_ptr<ge::gl::Buffer> dummyTexCoordBuffer;
 	std::shared_ptr<ge::gl::Buffer> skyboxPositionBuffer;
 	std::shared_ptr<ge::gl::Buffer> patchTransSSBO;
 	std::shared_ptr<ge::gl::Buffer> patchRandomsSSBO;
+	std::shared_ptr<ge::gl::Buffer> patchIndicesSSBO;
+	std::shared_ptr<ge::gl::Buffer> visiblePatchesSSBO;
+	std::shared_ptr<ge::gl::Buffer> heightPyramidSSBO;		// heightField pyramid for patchCullCS and terrainTCS
+	std::shared_ptr<ge::gl::Buffer> grassDrawCommandBuffer;
+	std::shared_ptr<ge::gl::Buffer> occlusionStatsBuffers[occlusionStatsLatency];
+	std::shared_ptr<ge::gl::Buffer> expandedVertexBuffer;
+	std::shared_ptr<ge::gl::Buffer> expandedDrawCommandBuffer;
+	std::shared_ptr<ge::gl::Buffer> bladeStatesSSBO;
+	std::shared_ptr<ge::gl::Buffer> bladeRestSSBO;
 
 	std::shared_ptr<ge::gl::Context>	 gl;
 
+	/* Streamed per-frame data (uniforms, CPU visible patch list, indirect command reset) */
+	std::unique_ptr<RingBuffer> frameRing;
+	RingBuffer::Allocation visiblePatchesAllocation;
+	bool frameRingFull = false;			// a write failed, grown before the next frame
+	bool grassCommandsValid = true;
+	bool expandedStripsValid = true;
+
+	std::unique_ptr<GpuTimer> gpuTimer;
+	std::unique_ptr<PipelineStatistics> grassStatistics;		// color pass
+	std::unique_ptr<PipelineStatistics> grassPrePassStatistics;
+	std::unique_ptr<PipelineStatistics> terrainStatistics;
+
 	std::shared_ptr<ge::gl::Program>	 grassShaderProgram;
 	std::shared_ptr<ge::gl::Program>	 terrainShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 terrainClipmapShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 terrainChunkShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 terrainTessShaderProgram;
 	std::shared_ptr<ge::gl::Program>	 dummyShaderProgram;
 	std::shared_ptr<ge::gl::Program>	 skyboxShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 patchCullShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 hiZBuildShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassLowShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassCardShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassCardBakeShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassExpandShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassExpandedShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassStripShaderProgram[2];	// pulling, attributes
+	std::shared_ptr<ge::gl::Program>	 bladeRestShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 bladeSimulationShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassDepthShaderProgram;			// depth-only variants for the pre-pass
+	std::shared_ptr<ge::gl::Program>	 grassLowDepthShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassCardDepthShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassExpandedDepthShaderProgram;
+	std::shared_ptr<ge::gl::Program>	 grassStripDepthShaderProgram[2];
+
+	GLint uPatchHalfExtentLocation;
+	GLint uPatchHalfSizeLocation;
+	GLint uPatchBladeHeightLocation;
+	GLint uPatchCountLocation;
+	GLint uLodDistancesLocation;
+	GLint uOcclusionCullingLocation;
+	GLint uHiZLevelCountLocation;
+	GLint uExpandGroupLimitLocation;
+	GLint uHiZLevelLocation;
+	GLint uPatchListOffsetLocations[3];	// per LodTier program
+	GLint uCardSizeLocation;
+	GLint uBakeProjectionLocation;
+	GLint uBakeBendingFactorLocation;
+	GLint uExpandPatchListOffsetLocation;
+	GLint uExpandBladeCountLocation;
+	GLint uExpandPatchListCountLocation;
+	GLint uExpandVertexCapacityLocation;
+	GLint uExpandedVertexCapacityLocation;
+	GLint uStripPatchListOffsetLocations[2];
+	GLint uStripSegmentCountLocations[2];
+	GLint uRestPatchCountLocation;
+	GLint uRestStiffnessLocation;
+	GLint uRestResetStateLocation;
+	GLint uSimInstanceCountLocation;
+	GLint uSimGravityLocation;
+	GLint uSimWindStrengthLocation;
+	GLint uSimCollisionDecayLocation;
+	GLint uSimTimeLocation;
+	GLint uSimDeltaTimeLocation;
+	GLint uSimColliderCountLocation;
+	GLint uSimCollidersLocation;
+	GLint uClipmapInstanceOffsetLocation;
+	GLint uTerrainProjectionScaleLocation;
+	GLint uTerrainViewportHeightLocation;
+	GLint uTerrainTargetEdgeLengthLocation;
+	GLint uTerrainMaxEdgeLevelLocation;
 
 	std::shared_ptr<ge::gl::VertexArray> grassVAO;
+	std::shared_ptr<ge::gl::VertexArray> bladeAttributeVAO;
 	std::shared_ptr<ge::gl::VertexArray> terrainVAO;
+	std::shared_ptr<ge::gl::VertexArray> terrainChunkVAO;
+	std::shared_ptr<ge::gl::VertexArray> terrainClipmapVAO;
+	std::shared_ptr<ge::gl::VertexArray> terrainPatchVAO;
 	std::shared_ptr<ge::gl::VertexArray> dummyVAO;
 	std::shared_ptr<ge::gl::VertexArray> skyboxVAO;
 
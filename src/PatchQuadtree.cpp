@@ -0,0 +1,207 @@
+#include "PatchQuadtree.hpp"
+
+PatchQuadtree::PatchQuadtree(std::vector<glm::vec3> *patchPositions, int patchesInRowOrCol, float patchSize, int leafSize)
+	: patchPositions{ patchPositions }, patchesInRowOrCol{ patchesInRowOrCol }, patchSize{ patchSize }, leafSize{ leafSize }
+{
+	visitedNodeCount = 0;
+	patchOrder.reserve(patchPositions->size());
+	patchHeights.assign(patchPositions->size(), glm::vec2(0.0f, 1.0f));
+
+	if (patchesInRowOrCol > 0)
+	{
+		nodes.resize(1);
+		build(0, 0, patchesInRowOrCol, 0, patchesInRowOrCol);
+	}
+}
+
+int PatchQuadtree::cull(Frustum &frustum, glm::vec3 cameraPos, float maxDistance, float padding, float maxTerrainHeight, float bladeHeight, int *visiblePatches)
+{
+	this->frustum		   = &frustum;
+	this->cameraPos		   = cameraPos;
+	this->maxDistance	   = maxDistance;
+	this->padding		   = padding;
+	this->maxTerrainHeight = maxTerrainHeight;
+	this->bladeHeight	   = bladeHeight;
+	this->visiblePatches   = visiblePatches;
+	visibleCount	 = 0;
+	visitedNodeCount = 0;
+
+	if (!nodes.empty())
+		cullNode(0, true, true);
+
+	return visibleCount;
+}
+
+void PatchQuadtree::setPatchHeights(const std::vector<glm::vec2> &patchHeights)
+{
+	this->patchHeights = patchHeights;
+	if (!nodes.empty())
+		mergeHeights(0);
+}
+
+int PatchQuadtree::getNodeCount()
+{
+	return nodes.size();
+}
+
+int PatchQuadtree::getVisitedNodeCount()
+{
+	return visitedNodeCount;
+}
+
+std::vector<PatchQuadtree::Node> *PatchQuadtree::getNodes()
+{
+	return &nodes;
+}
+
+std::vector<int> *PatchQuadtree::getPatchOrder()
+{
+	return &patchOrder;
+}
+
+void PatchQuadtree::build(int nodeIndex, int rowBegin, int rowEnd, int colBegin, int colEnd)
+{
+	Node node;
+	node.firstChild = -1;
+	node.childCount = 0;
+	node.firstPatch = patchOrder.size();
+
+	/* Patch squares of the first and the last patch of the node span its area */
+	glm::vec3 first = patchPositions->at(rowBegin * patchesInRowOrCol + colBegin);
+	glm::vec3 last  = patchPositions->at((rowEnd - 1) * patchesInRowOrCol + colEnd - 1);
+	node.min = glm::vec2(glm::min(first.x, last.x) - patchSize / 2, glm::min(first.z, last.z) - patchSize / 2);
+	node.max = glm::vec2(glm::max(first.x, last.x) + patchSize / 2, glm::max(first.z, last.z) + patchSize / 2);
+
+	if (rowEnd - rowBegin <= leafSize && colEnd - colBegin <= leafSize)
+	{
+		for (int row = rowBegin; row < rowEnd; row++)
+			for (int col = colBegin; col < colEnd; col++)
+				patchOrder.push_back(row * patchesInRowOrCol + col);
+	}
+	else
+	{
+		/* Split into (up to) four children stored next to each other */
+		int rowMiddle = (rowBegin + rowEnd + 1) / 2;
+		int colMiddle = (colBegin + colEnd + 1) / 2;
+		int ranges[4][4] =
+		{
+			{ rowBegin,  rowMiddle, colBegin,  colMiddle },
+			{ rowBegin,  rowMiddle, colMiddle, colEnd    },
+			{ rowMiddle, rowEnd,    colBegin,  colMiddle },
+			{ rowMiddle, rowEnd,    colMiddle, colEnd    }
+		};
+
+		node.firstChild = nodes.size();
+		for (auto &range : ranges)
+		{
+			if (range[0] < range[1] && range[2] < range[3])
+				node.childCount++;
+		}
+		nodes.resize(nodes.size() + node.childCount);
+
+		int child = node.firstChild;
+		for (auto &range : ranges)
+		{
+			if (range[0] < range[1] && range[2] < range[3])
+				build(child++, range[0], range[1], range[2], range[3]);
+		}
+	}
+
+	node.patchCount = patchOrder.size() - node.firstPatch;
+	node.heights = glm::vec2(0.0f, 1.0f);
+	nodes[nodeIndex] = node;
+}
+
+glm::vec2 PatchQuadtree::mergeHeights(int nodeIndex)
+{
+	Node &node = nodes[nodeIndex];
+	glm::vec2 heights(1.0f, 0.0f);
+
+	if (node.firstChild >= 0)
+	{
+		for (int i = 0; i < node.childCount; i++)
+		{
+			glm::vec2 child = mergeHeights(node.firstChild + i);
+			heights = glm::vec2(std::min(heights.x, child.x), std::max(heights.y, child.y));
+		}
+	}
+	else
+	{
+		for (int i = 0; i < node.patchCount; i++)
+		{
+			glm::vec2 patch = patchHeights[patchOrder[node.firstPatch + i]];
+			heights = glm::vec2(std::min(heights.x, patch.x), std::max(heights.y, patch.y));
+		}
+	}
+
+	nodes[nodeIndex].heights = heights;
+	return heights;
+}
+
+void PatchQuadtree::cullNode(int nodeIndex, bool testFrustum, bool testDistance)
+{
+	const Node &node = nodes[nodeIndex];
+	visitedNodeCount++;
+
+	glm::vec3 min(node.min.x - padding, maxTerrainHeight * node.heights.x, node.min.y - padding);
+	glm::vec3 max(node.max.x + padding, maxTerrainHeight * node.heights.y + bladeHeight, node.max.y + padding);
+
+	if (testDistance)
+	{
+		glm::vec3 nearest = glm::clamp(cameraPos, min, max);
+		if (glm::length(nearest - cameraPos) > maxDistance)
+			return;
+
+		/* Farthest corner within max. distance - no descendant can be distance culled */
+		glm::vec3 farthest(cameraPos.x < (min.x + max.x) / 2 ? max.x : min.x,
+						   cameraPos.y < (min.y + max.y) / 2 ? max.y : min.y,
+						   cameraPos.z < (min.z + max.z) / 2 ? max.z : min.z);
+		if (glm::length(farthest - cameraPos) <= maxDistance)
+			testDistance = false;
+	}
+
+	if (testFrustum)
+	{
+		Frustum::Result result = frustum->testBox(min, max);
+		if (result == Frustum::Result::OUTSIDE)
+			return;
+		if (result == Frustum::Result::INSIDE)
+			testFrustum = false;
+	}
+
+	/* Whole subtree visible */
+	if (!testFrustum && !testDistance)
+	{
+		for (int i = 0; i < node.patchCount; i++)
+			visiblePatches[visibleCount++] = patchOrder[node.firstPatch + i];
+		return;
+	}
+
+	if (node.firstChild >= 0)
+	{
+		for (int i = 0; i < node.childCount; i++)
+			cullNode(node.firstChild + i, testFrustum, testDistance);
+		return;
+	}
+
+	/* Leaf - test individual patches */
+	for (int i = 0; i < node.patchCount; i++)
+	{
+		int patchIndex = patchOrder[node.firstPatch + i];
+		glm::vec3 center = patchPositions->at(patchIndex);
+		glm::vec2 heights = patchHeights[patchIndex];
+		glm::vec3 patchMin(center.x - patchSize / 2 - padding, maxTerrainHeight * heights.x, center.z - patchSize / 2 - padding);
+		glm::vec3 patchMax(center.x + patchSize / 2 + padding, maxTerrainHeight * heights.y + bladeHeight, center.z + patchSize / 2 + padding);
+
+		if (testDistance)
+		{
+			glm::vec3 nearest = glm::clamp(cameraPos, patchMin, patchMax);
+			if (glm::length(nearest - cameraPos) > maxDistance)
+				continue;
+		}
+		if (testFrustum && !frustum->isBoxVisible(patchMin, patchMax))
+			continue;
+
+		visiblePatches[visibleCount++] = patchIndex;
+	}
+}
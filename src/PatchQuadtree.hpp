@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+
+/*
+	Quadtree over the row-major patch grid of a GrassField.
+	Patches are stored in tree order, so every node covers a contiguous range of patchOrder
+	and a node which is entirely visible is emitted without visiting its children.
+*/
+class PatchQuadtree
+{
+public:
+    struct Node
+    {
+        glm::vec2 min;      // x, z of the patch squares covered by the node
+        glm::vec2 max;
+        int firstChild;     // -1 for leaves
+        int childCount;
+        int firstPatch;     // range in patchOrder
+        int patchCount;
+        glm::vec2 heights;  // terrain height range 0 - 1 of the patches
+    };
+
+    PatchQuadtree(std::vector<glm::vec3> *patchPositions, int patchesInRowOrCol, float patchSize, int leafSize = 4);
+
+    /* Writes visible patch indices, returns their count. padding extends the patch squares horizontally (blade reach),
+       vertically the bounds span maxTerrainHeight * heights up to bladeHeight above. */
+    int cull(Frustum &frustum, glm::vec3 cameraPos, float maxDistance, float padding, float maxTerrainHeight, float bladeHeight, int *visiblePatches);
+
+    /* Terrain height range 0 - 1 per patch index, node ranges are merged bottom-up */
+    void setPatchHeights(const std::vector<glm::vec2> &patchHeights);
+
+    int getNodeCount();
+    int getVisitedNodeCount();
+    std::vector<Node> *getNodes();
+    std::vector<int> *getPatchOrder();
+
+protected:
+    void build(int nodeIndex, int rowBegin, int rowEnd, int colBegin, int colEnd);
+    void cullNode(int nodeIndex, bool testFrustum, bool testDistance);
+    glm::vec2 mergeHeights(int nodeIndex);
+
+private:
+    std::vector<glm::vec3> *patchPositions;
+    int patchesInRowOrCol;
+    float patchSize;
+    int leafSize;
+
+    std::vector<Node> nodes;
+    std::vector<int> patchOrder;
+    std::vector<glm::vec2> patchHeights;
+
+    /* Traversal state */
+    Frustum *frustum;
+    glm::vec3 cameraPos;
+    float maxDistance;
+    float padding;
+    float maxTerrainHeight;
+    float bladeHeight;
+    int *visiblePatches;
+    int visibleCount;
+    int visitedNodeCount;
+};
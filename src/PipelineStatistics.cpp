@@ -0,0 +1,144 @@
+#include "PipelineStatistics.hpp"
+
+const GLenum PipelineStatistics::targets[COUNTER_COUNT] =
+{
+	GL_VERTEX_SHADER_INVOCATIONS,
+	GL_TESS_CONTROL_SHADER_PATCHES,
+	GL_TESS_EVALUATION_SHADER_INVOCATIONS,
+	GL_PRIMITIVES_SUBMITTED,
+	GL_CLIPPING_INPUT_PRIMITIVES,
+	GL_CLIPPING_OUTPUT_PRIMITIVES,
+	GL_FRAGMENT_SHADER_INVOCATIONS
+};
+
+PipelineStatistics::PipelineStatistics(int frameLatency)
+	: frameLatency{ frameLatency }
+{
+	initializeOpenGLFunctions();
+
+	supported = isSupported();
+	queries.assign(frameLatency, std::vector<GLuint>(COUNTER_COUNT, 0));
+	issued.assign(frameLatency, false);
+	values.assign(COUNTER_COUNT, 0);
+
+	if (supported)
+	{
+		for (auto &frameQueries : queries)
+			glGenQueries(COUNTER_COUNT, frameQueries.data());
+	}
+
+	frame	  = 0;
+	recording = false;
+}
+
+PipelineStatistics::~PipelineStatistics()
+{
+	if (supported)
+	{
+		for (auto &frameQueries : queries)
+			glDeleteQueries(COUNTER_COUNT, frameQueries.data());
+	}
+}
+
+bool PipelineStatistics::isSupported()
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	return context && (context->format().version() >= qMakePair(4, 6) || context->hasExtension("GL_ARB_pipeline_statistics_query"));
+}
+
+void PipelineStatistics::beginFrame()
+{
+	frame = (frame + 1) % frameLatency;
+
+	if (issued[frame])
+		resolve(frame, recording);
+}
+
+void PipelineStatistics::begin()
+{
+	if (!supported)
+		return;
+
+	for (int i = 0; i < COUNTER_COUNT; i++)
+		glBeginQuery(targets[i], queries[frame][i]);
+}
+
+void PipelineStatistics::end()
+{
+	if (!supported)
+		return;
+
+	for (int i = 0; i < COUNTER_COUNT; i++)
+		glEndQuery(targets[i]);
+	issued[frame] = true;
+}
+
+void PipelineStatistics::flush()
+{
+	/* Oldest frame first so records stay in submission order */
+	for (int i = 1; i <= frameLatency; i++)
+	{
+		int frameIndex = (frame + i) % frameLatency;
+		if (issued[frameIndex])
+			resolve(frameIndex, true);
+	}
+}
+
+void PipelineStatistics::setRecording(bool recording)
+{
+	this->recording = recording;
+	records.clear();
+}
+
+const std::vector<std::vector<GLuint64>> &PipelineStatistics::getRecords()
+{
+	return records;
+}
+
+bool PipelineStatistics::getSupported()
+{
+	return supported;
+}
+
+GLuint64 PipelineStatistics::getValue(Counter counter)
+{
+	return values[(int)counter];
+}
+
+const char *PipelineStatistics::getCounterName(Counter counter)
+{
+	switch (counter)
+	{
+		case Counter::VERTEX_SHADER_INVOCATIONS:	return "vs_invocations";
+		case Counter::TESS_CONTROL_PATCHES:			return "tcs_patches";
+		case Counter::TESS_EVALUATION_INVOCATIONS:	return "tes_invocations";
+		case Counter::PRIMITIVES_SUBMITTED:			return "primitives_submitted";
+		case Counter::CLIPPING_INPUT_PRIMITIVES:	return "clipping_input";
+		case Counter::CLIPPING_OUTPUT_PRIMITIVES:	return "clipping_output";
+		case Counter::FRAGMENT_SHADER_INVOCATIONS:	return "fs_invocations";
+		default:									return "";
+	}
+}
+
+void PipelineStatistics::resolve(int frameIndex, bool wait)
+{
+	/* All counters end together - the last one tells whether the set is ready */
+	if (!wait)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(queries[frameIndex][COUNTER_COUNT - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			issued[frameIndex] = false;
+			return;
+		}
+	}
+
+	for (int i = 0; i < COUNTER_COUNT; i++)
+		glGetQueryObjectui64v(queries[frameIndex][i], GL_QUERY_RESULT, &values[i]);
+
+	if (recording)
+		records.push_back(values);
+
+	issued[frameIndex] = false;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_5_Core>
+
+/* ARB_pipeline_statistics_query (core in OpenGL 4.6) - not in the 4.5 headers */
+#ifndef GL_VERTEX_SHADER_INVOCATIONS
+#define GL_VERTICES_SUBMITTED                 0x82EE
+#define GL_PRIMITIVES_SUBMITTED               0x82EF
+#define GL_VERTEX_SHADER_INVOCATIONS          0x82F0
+#define GL_TESS_CONTROL_SHADER_PATCHES        0x82F1
+#define GL_TESS_EVALUATION_SHADER_INVOCATIONS 0x82F2
+#define GL_GEOMETRY_SHADER_PRIMITIVES_EMITTED 0x82F3
+#define GL_FRAGMENT_SHADER_INVOCATIONS        0x82F4
+#define GL_COMPUTE_SHADER_INVOCATIONS         0x82F5
+#define GL_CLIPPING_INPUT_PRIMITIVES          0x82F6
+#define GL_CLIPPING_OUTPUT_PRIMITIVES         0x82F7
+#endif
+
+/*
+	Pipeline statistics counters around one render pass (one instance per measured pass).
+	Like GpuTimer, query sets are reused after frameLatency frames and read only when available.
+*/
+class PipelineStatistics : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    enum class Counter
+    {
+        VERTEX_SHADER_INVOCATIONS,
+        TESS_CONTROL_PATCHES,
+        TESS_EVALUATION_INVOCATIONS,
+        PRIMITIVES_SUBMITTED,           // by the draw calls - patches on the tessellated path
+        CLIPPING_INPUT_PRIMITIVES,
+        CLIPPING_OUTPUT_PRIMITIVES,
+        FRAGMENT_SHADER_INVOCATIONS
+    };
+    static const int COUNTER_COUNT = 7;
+
+    PipelineStatistics(int frameLatency = 2);
+    ~PipelineStatistics();
+
+    static bool isSupported();
+
+    void beginFrame();
+    void begin();
+    void end();
+    void flush();
+
+    void setRecording(bool recording);
+    const std::vector<std::vector<GLuint64>> &getRecords();
+
+    bool getSupported();
+    GLuint64 getValue(Counter counter);     // last resolved frame
+    static const char *getCounterName(Counter counter);
+
+protected:
+    void resolve(int frameIndex, bool wait);
+
+private:
+    static const GLenum targets[COUNTER_COUNT];
+
+    std::vector<std::vector<GLuint>> queries;   // [frame][counter]
+    std::vector<bool> issued;                   // [frame]
+    std::vector<GLuint64> values;
+    std::vector<std::vector<GLuint64>> records;
+    int frameLatency;
+    int frame;
+    bool supported;
+    bool recording;
+};
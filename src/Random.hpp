@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+	Counter-based (stateless) random number generator.
+	Every value is a pure function of (seed, counter, stream), so the blades
+	can be generated in any order and on any number of threads with identical results.
+*/
+class Random
+{
+public:
+    /* Integer hash with good avalanche properties (lowbias32 by Chris Wellons) */
+    static inline uint32_t hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    /* Key derived from the user seed, computed once per generator */
+    static inline uint32_t key(uint32_t seed)
+    {
+        return hash(seed ^ 0x9e3779b9U);
+    }
+
+    /* Key of a separate domain of the same seed (e.g. patches next to blades) - never the key of another seed like key(seed + 1) */
+    static inline uint32_t key(uint32_t seed, uint32_t domain)
+    {
+        return hash(key(seed) + hash(domain ^ 0x85ebca6bU));
+    }
+
+    /* Per-counter state (e.g. one per blade), shared by all streams of that counter */
+    static inline uint32_t counterState(uint32_t key, uint32_t counter)
+    {
+        return hash(counter ^ key);
+    }
+
+    /* Random bits of one stream of a counter */
+    static inline uint32_t bits(uint32_t counterState, uint32_t stream)
+    {
+        return hash(counterState + stream * 0x9e3779b9U);
+    }
+
+    /* Uniformly distributed float in [min, max) */
+    static inline float uniform(uint32_t counterState, uint32_t stream, float min, float max)
+    {
+        float t = (float)(bits(counterState, stream) >> 8) * (1.0f / 16777216.0f);
+        return min + t * (max - min);
+    }
+};
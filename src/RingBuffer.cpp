@@ -0,0 +1,151 @@
+#include "RingBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+RingBuffer::RingBuffer(GLsizeiptr frameSize, int frameCount)
+	: frameSize{ frameSize }, frameCount{ frameCount }
+{
+	initializeOpenGLFunctions();
+
+	GLint uniformAlignment, storageAlignment;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	defaultAlignment = std::max(uniformAlignment, storageAlignment);
+
+	/* Regions start at multiples of the alignment, so region-relative alignment is also buffer alignment */
+	this->frameSize = alignFrameSize(frameSize);
+
+	stallCount = 0;
+	create();
+}
+
+RingBuffer::~RingBuffer()
+{
+	destroy();
+}
+
+bool RingBuffer::isSupported()
+{
+	QOpenGLContext *context = QOpenGLContext::currentContext();
+	return context && !context->isOpenGLES() && context->format().version() >= qMakePair(4, 4);
+}
+
+void RingBuffer::beginFrame()
+{
+	frame = (frame + 1) % frameCount;
+	head  = 0;
+
+	/* Wait until the GPU has finished reading this region (normally already signaled) */
+	if (fences[frame])
+	{
+		GLenum result = glClientWaitSync(fences[frame], 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			stallCount++;
+			while (glClientWaitSync(fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(fences[frame]);
+		fences[frame] = nullptr;
+	}
+}
+
+void RingBuffer::endFrame()
+{
+	if (fences[frame])
+		glDeleteSync(fences[frame]);
+	fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void RingBuffer::reserve(GLsizeiptr frameSize)
+{
+	frameSize = alignFrameSize(frameSize);
+	if (frameSize <= this->frameSize)
+		return;
+
+	/* Rare - the whole buffer has to be idle before it is replaced */
+	glFinish();
+	destroy();
+	this->frameSize = frameSize;
+	create();
+}
+
+RingBuffer::Allocation RingBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+	if (alignment == 0)
+		alignment = defaultAlignment;
+
+	GLsizeiptr offset = (head + alignment - 1) / alignment * alignment;
+	if (offset + size > frameSize)
+		return Allocation{ nullptr, 0, 0 };
+
+	head = offset + size;
+	GLintptr bufferOffset = frame * frameSize + offset;
+
+	return Allocation{ mappedData + bufferOffset, bufferOffset, size };
+}
+
+RingBuffer::Allocation RingBuffer::write(const void *data, GLsizeiptr size, GLsizeiptr alignment)
+{
+	Allocation allocation = allocate(size, alignment);
+	if (allocation.data)
+		memcpy(allocation.data, data, size);
+
+	return allocation;
+}
+
+void RingBuffer::bindRange(GLenum target, GLuint index, Allocation allocation)
+{
+	glBindBufferRange(target, index, buffer, allocation.offset, allocation.size);
+}
+
+GLuint RingBuffer::getId()
+{
+	return buffer;
+}
+
+GLsizeiptr RingBuffer::getFrameSize()
+{
+	return frameSize;
+}
+
+GLsizeiptr RingBuffer::getUsedSize()
+{
+	return head;
+}
+
+int RingBuffer::getStallCount()
+{
+	return stallCount;
+}
+
+GLsizeiptr RingBuffer::alignFrameSize(GLsizeiptr frameSize)
+{
+	return (frameSize + defaultAlignment - 1) / defaultAlignment * defaultAlignment;
+}
+
+void RingBuffer::create()
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glCreateBuffers(1, &buffer);
+	glNamedBufferStorage(buffer, frameSize * frameCount, nullptr, flags);
+	mappedData = (char *)glMapNamedBufferRange(buffer, 0, frameSize * frameCount, flags);
+
+	fences.assign(frameCount, nullptr);
+	frame = 0;
+	head  = 0;
+}
+
+void RingBuffer::destroy()
+{
+	for (auto &fence : fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+	}
+	fences.clear();
+
+	glUnmapNamedBuffer(buffer);
+	glDeleteBuffers(1, &buffer);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_5_Core>
+
+/*
+	Persistently mapped streaming buffer split into frameCount regions (triple buffering by default).
+	Each frame writes into its own region with plain memcpys, a fence placed at the end of the frame
+	protects the region until the GPU has consumed it.
+*/
+class RingBuffer : protected QOpenGLFunctions_4_5_Core
+{
+public:
+    struct Allocation
+    {
+        void *data;         // mapped pointer, nullptr if the region is full
+        GLintptr offset;    // offset from the start of the buffer
+        GLsizeiptr size;
+    };
+
+    RingBuffer(GLsizeiptr frameSize, int frameCount = 3);
+    ~RingBuffer();
+
+    /* Requires glBufferStorage (OpenGL 4.4) */
+    static bool isSupported();
+
+    void beginFrame();
+    void endFrame();
+    void reserve(GLsizeiptr frameSize);
+
+    /* alignment = 0 uses the largest uniform/storage buffer offset alignment */
+    Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 0);
+    Allocation write(const void *data, GLsizeiptr size, GLsizeiptr alignment = 0);
+    void bindRange(GLenum target, GLuint index, Allocation allocation);
+
+    GLuint getId();
+    GLsizeiptr getFrameSize();
+    GLsizeiptr getUsedSize();
+    int getStallCount();
+
+protected:
+    void create();
+    void destroy();
+    GLsizeiptr alignFrameSize(GLsizeiptr frameSize);   // rounded up to defaultAlignment
+
+private:
+    GLuint buffer;
+    char *mappedData;
+    GLsizeiptr frameSize;
+    GLsizeiptr head;
+    GLsizeiptr defaultAlignment;
+    int frameCount;
+    int frame;
+    int stallCount;
+    std::vector<GLsync> fences;
+};
@@ -5,15 +5,33 @@ Terrain::Terrain(float terrainWidth, float terrainLength, int rows, int cols)
 {
     indexCount = (rows - 1) * cols * 2 + rows - 1;
     generateTerrain();
+    generateChunks();
+    generateChunkIndices();
+    generatePatches();
 }
 
 Terrain::~Terrain()
 {
 }
 
+void Terrain::setIndexFormat(IndexFormat format)
+{
+    indexFormat = format;
+}
+
+Terrain::IndexFormat Terrain::getIndexFormat()
+{
+    return indexFormat;
+}
+
+GLenum Terrain::getPrimitiveType()
+{
+    return indexFormat == IndexFormat::STRIP ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+}
+
 int Terrain::getIndexCount()
 {
-    return indexCount;
+    return indexFormat == IndexFormat::STRIP ? indexCount : optimizedIndices.size();
 }
 
 int Terrain::getRestartIndex()
@@ -21,6 +39,11 @@ int Terrain::getRestartIndex()
     return restartIndex;
 }
 
+VertexCacheOptimizer::Statistics Terrain::getIndexStatistics(IndexFormat format)
+{
+    return format == IndexFormat::STRIP ? stripStatistics : optimizedStatistics;
+}
+
 float Terrain::getTerrainWidth()
 {
     return terrainWidth;
@@ -31,6 +54,16 @@ float Terrain::getTerrainLength()
     return terrainLength;
 }
 
+int Terrain::getVertexCount()
+{
+    return rows * cols;
+}
+
+int Terrain::getTriangleCount()
+{
+    return std::max(0, (rows - 1) * (cols - 1) * 2);
+}
+
 std::shared_ptr<ge::gl::Buffer> Terrain::getTerrainVertexBuffer()
 {
     std::shared_ptr<ge::gl::Buffer> terrainVertexBuffer;
@@ -42,7 +75,10 @@ std::shared_ptr<ge::gl::Buffer> Terrain::getTerrainVertexBuffer()
 std::shared_ptr<ge::gl::Buffer> Terrain::getTerrainIndexBuffer()
 {
     std::shared_ptr<ge::gl::Buffer> terrainIndexBuffer;
-    terrainIndexBuffer = std::make_shared<ge::gl::Buffer>(terrainIndices->size() * sizeof(unsigned int), terrainIndices->data());
+    if (indexFormat == IndexFormat::STRIP)
+        terrainIndexBuffer = std::make_shared<ge::gl::Buffer>(terrainIndices->size() * sizeof(unsigned int), terrainIndices->data());
+    else
+        terrainIndexBuffer = std::make_shared<ge::gl::Buffer>(optimizedIndices.size() * sizeof(unsigned int), optimizedIndices.data());
 
     return terrainIndexBuffer;
 }
@@ -82,9 +118,315 @@ void Terrain::generateTerrain()
         // Restart triangle strips
         terrainIndices->push_back(restartIndex);
     }
+
+    /* The same triangles and windings as the strips (odd strip triangles swap their first two vertices) as a list */
+    std::vector<unsigned int> triangles;
+    triangles.reserve(getTriangleCount() * 3);
+    for (int i = 0; i < rows - 1; i++)
+    {
+        for (int j = 0; j < cols - 1; j++)
+        {
+            unsigned int index = rowColToIndex(i, j);
+            unsigned int next  = rowColToIndex(i + 1, j);
+            triangles.insert(triangles.end(), { index, next, index + 1 });
+            triangles.insert(triangles.end(), { index + 1, next, next + 1 });
+        }
+    }
+    optimizedIndices = VertexCacheOptimizer::optimize(triangles, terrainVertices->size());
+
+    stripStatistics     = VertexCacheOptimizer::analyze(*terrainIndices, terrainVertices->size(), true, restartIndex);
+    optimizedStatistics = VertexCacheOptimizer::analyze(optimizedIndices, terrainVertices->size(), false);
 }
 
 int Terrain::rowColToIndex(int row, int col)
 {
     return row * cols + col;
-}
\ No newline at end of file
+}
+
+int Terrain::getChunkCount()
+{
+    return chunks.size();
+}
+
+const std::vector<Terrain::Chunk> &Terrain::getChunks()
+{
+    return chunks;
+}
+
+std::shared_ptr<ge::gl::Buffer> Terrain::getChunkVertexBuffer()
+{
+    return std::make_shared<ge::gl::Buffer>(chunkVertices.size() * sizeof(ChunkVertex), chunkVertices.data());
+}
+
+std::shared_ptr<ge::gl::Buffer> Terrain::getChunkIndexBuffer()
+{
+    return std::make_shared<ge::gl::Buffer>(chunkIndices.size() * sizeof(GLushort), chunkIndices.data());
+}
+
+std::shared_ptr<ge::gl::Buffer> Terrain::getChunkBoundsBuffer()
+{
+    std::vector<glm::vec4> bounds;
+    for (const Chunk &chunk : chunks)
+        bounds.push_back(glm::vec4(chunk.min.x, chunk.min.y, chunk.max.x, chunk.max.y));
+
+    return std::make_shared<ge::gl::Buffer>(bounds.size() * sizeof(glm::vec4), bounds.data());
+}
+
+size_t Terrain::getChunkMemorySize()
+{
+    return chunkVertices.size() * sizeof(ChunkVertex) + chunkIndices.size() * sizeof(GLushort) + chunks.size() * sizeof(glm::vec4);
+}
+
+size_t Terrain::getChunkFullPrecisionMemorySize()
+{
+    /* World space positions cannot be shared, every chunk needs its own grid */
+    return chunks.size() * chunkVertices.size() * sizeof(glm::vec2) + chunkIndices.size() * sizeof(unsigned int);
+}
+
+int Terrain::selectChunkLods(Frustum &frustum, glm::vec3 cameraPos, float lodDistance, const HeightField &heightField, std::vector<DrawCommand> &commands)
+{
+    commands.clear();
+    selectedVertexCount = 0;
+    selectedTriangleCount = 0;
+
+    /* Levels of all chunks first, culled neighbours still decide the seams */
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        /* The maximum height can change every frame, the pyramid query is a few tiles */
+        chunks[i].heightRange = heightField.getTerrainHeightRange(chunks[i].min, chunks[i].max);
+        glm::vec3 min(chunks[i].min.x, chunks[i].heightRange.x, chunks[i].min.y);
+        glm::vec3 max(chunks[i].max.x, chunks[i].heightRange.y, chunks[i].max.y);
+        float distance = glm::length(glm::clamp(cameraPos, min, max) - cameraPos);
+
+        int level = 0;
+        if (distance >= lodDistance)
+            level = std::min(CHUNK_LOD_COUNT - 1, 1 + (int)std::floor(std::log2(distance / std::max(lodDistance, 1e-3f))));
+        chunkLevels[i] = level;
+    }
+
+    int visibleCount = 0;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        const Chunk &chunk = chunks[i];
+        if (!frustum.isBoxVisible(glm::vec3(chunk.min.x, chunk.heightRange.x, chunk.min.y), glm::vec3(chunk.max.x, chunk.heightRange.y, chunk.max.y)))
+            continue;
+        visibleCount++;
+
+        int level = chunkLevels[i];
+        int cells = CHUNK_QUADS >> level;
+        int vertexCount = (cells + 1) * (cells + 1);
+
+        std::vector<IndexRange> ranges{ chunkInteriors[level] };
+        for (int side = 0; side < 4; side++)
+        {
+            int neighbour = chunk.neighbours[side];
+            int outerLevel = neighbour < 0 ? level : std::max(level, chunkLevels[neighbour]);
+            ranges.push_back(chunkEdges[level][side][outerLevel]);
+            vertexCount -= cells - (CHUNK_QUADS >> outerLevel);    // border vertices the coarser neighbour does not have
+        }
+
+        for (const IndexRange &range : ranges)
+        {
+            if (range.count == 0)
+                continue;
+            commands.push_back({ (GLuint)range.count, 1, (GLuint)range.first, 0, (GLuint)i });
+            selectedTriangleCount += range.count / 3;
+        }
+        selectedVertexCount += vertexCount;
+    }
+
+    return visibleCount;
+}
+
+int Terrain::getChunkLevel(int chunk)
+{
+    return chunkLevels[chunk];
+}
+
+int Terrain::getSelectedVertexCount()
+{
+    return selectedVertexCount;
+}
+
+int Terrain::getSelectedTriangleCount()
+{
+    return selectedTriangleCount;
+}
+
+int Terrain::getPatchCount()
+{
+    return patchIndices.size() / 4;
+}
+
+std::shared_ptr<ge::gl::Buffer> Terrain::getPatchVertexBuffer()
+{
+    return std::make_shared<ge::gl::Buffer>(patchVertices.size() * sizeof(glm::vec2), patchVertices.data());
+}
+
+std::shared_ptr<ge::gl::Buffer> Terrain::getPatchIndexBuffer()
+{
+    return std::make_shared<ge::gl::Buffer>(patchIndices.size() * sizeof(unsigned int), patchIndices.data());
+}
+
+void Terrain::generateChunks()
+{
+    /* Rows and columns are rounded to whole chunks */
+    chunkRows = std::max(1, (int)std::round((rows - 1) / (float)CHUNK_QUADS));
+    chunkCols = std::max(1, (int)std::round((cols - 1) / (float)CHUNK_QUADS));
+    float quadRows = chunkRows * CHUNK_QUADS;
+    float quadCols = chunkCols * CHUNK_QUADS;
+
+    /* One local grid shared by all chunks, the position comes from the chunk bounds */
+    chunkVertices.clear();
+    for (int row = 0; row <= CHUNK_QUADS; row++)
+    {
+        for (int col = 0; col <= CHUNK_QUADS; col++)
+        {
+            GLushort x = (GLushort)std::lround(65535.0 * col / CHUNK_QUADS);
+            GLushort z = (GLushort)std::lround(65535.0 * (CHUNK_QUADS - row) / CHUNK_QUADS);
+            chunkVertices.push_back({ x, z });
+        }
+    }
+
+    chunks.clear();
+
+    for (int chunkRow = 0; chunkRow < chunkRows; chunkRow++)
+    {
+        for (int chunkCol = 0; chunkCol < chunkCols; chunkCol++)
+        {
+            Chunk chunk;
+            chunk.neighbours[(int)Side::BOTTOM] = chunkRow > 0             ? (chunkRow - 1) * chunkCols + chunkCol : -1;
+            chunk.neighbours[(int)Side::RIGHT]  = chunkCol < chunkCols - 1 ? chunkRow * chunkCols + chunkCol + 1   : -1;
+            chunk.neighbours[(int)Side::TOP]    = chunkRow < chunkRows - 1 ? (chunkRow + 1) * chunkCols + chunkCol : -1;
+            chunk.neighbours[(int)Side::LEFT]   = chunkCol > 0             ? chunkRow * chunkCols + chunkCol - 1   : -1;
+
+            /* Same mapping as generateTerrain - rows go from positive to negative z. Neighbours compute their shared
+               bound from the same values and the border coordinates are exactly 0 and 1, so the seams stay closed. */
+            glm::vec2 first(glm::mix(-terrainWidth / 2, terrainWidth / 2, chunkCol * CHUNK_QUADS / quadCols),
+                            glm::mix(terrainLength / 2, -terrainLength / 2, chunkRow * CHUNK_QUADS / quadRows));
+            glm::vec2 last(glm::mix(-terrainWidth / 2, terrainWidth / 2, (chunkCol + 1) * CHUNK_QUADS / quadCols),
+                           glm::mix(terrainLength / 2, -terrainLength / 2, (chunkRow + 1) * CHUNK_QUADS / quadRows));
+            chunk.min = glm::min(first, last);
+            chunk.max = glm::max(first, last);
+            chunks.push_back(chunk);
+        }
+    }
+
+    chunkLevels.assign(chunks.size(), 0);
+}
+
+void Terrain::generateChunkIndices()
+{
+    chunkIndices.clear();
+
+    for (int level = 0; level < CHUNK_LOD_COUNT; level++)
+    {
+        int step = 1 << level;
+        int cells = CHUNK_QUADS / step;
+
+        /* Interior - everything but the outer ring of cells, the whole chunk on the last level */
+        chunkInteriors[level].first = chunkIndices.size();
+        int firstCell = cells == 1 ? 0 : 1;
+        int lastCell  = cells == 1 ? 1 : cells - 1;
+        for (int row = firstCell; row < lastCell; row++)
+        {
+            for (int col = firstCell; col < lastCell; col++)
+            {
+                glm::ivec2 corner(col * step, row * step);
+                addChunkTriangle(corner, corner + glm::ivec2(step, 0), corner + glm::ivec2(step, step));
+                addChunkTriangle(corner, corner + glm::ivec2(step, step), corner + glm::ivec2(0, step));
+            }
+        }
+        chunkInteriors[level].count = chunkIndices.size() - chunkInteriors[level].first;
+
+        /* Edge bands for each neighbour level that is not finer */
+        for (int side = 0; side < 4; side++)
+        {
+            for (int outerLevel = 0; outerLevel < CHUNK_LOD_COUNT; outerLevel++)
+            {
+                IndexRange &range = chunkEdges[level][side][outerLevel];
+                range.first = chunkIndices.size();
+                if (outerLevel >= level && cells > 1)
+                    addEdgeBand((Side)side, step, 1 << outerLevel);
+                range.count = chunkIndices.size() - range.first;
+            }
+        }
+    }
+}
+
+void Terrain::addEdgeBand(Side side, int step, int outerStep)
+{
+    /* Band between the chunk border (every outerStep-th vertex) and the first inner row (every step-th vertex),
+       built along the side in (position, depth) coordinates and zipped like two merged sorted lists */
+    auto toChunk = [side](int position, int depth)
+    {
+        switch (side)
+        {
+            case Side::BOTTOM: return glm::ivec2(position, depth);
+            case Side::RIGHT:  return glm::ivec2(CHUNK_QUADS - depth, position);
+            case Side::TOP:    return glm::ivec2(CHUNK_QUADS - position, CHUNK_QUADS - depth);
+            default:           return glm::ivec2(depth, CHUNK_QUADS - position);
+        }
+    };
+
+    int outerCount = CHUNK_QUADS / outerStep;   // segments
+    int innerCount = CHUNK_QUADS / step - 1;    // vertices from step to CHUNK_QUADS - step
+    int outer = 0;
+    int inner = 0;
+    while (outer < outerCount || inner < innerCount - 1)
+    {
+        bool advanceOuter = inner == innerCount - 1 || (outer < outerCount && (outer + 1) * outerStep <= (inner + 2) * step);
+        glm::ivec2 innerVertex = toChunk((inner + 1) * step, step);
+        if (advanceOuter)
+        {
+            addChunkTriangle(toChunk(outer * outerStep, 0), toChunk((outer + 1) * outerStep, 0), innerVertex);
+            outer++;
+        }
+        else
+        {
+            addChunkTriangle(toChunk(outer * outerStep, 0), toChunk((inner + 2) * step, step), innerVertex);
+            inner++;
+        }
+    }
+}
+
+void Terrain::addChunkTriangle(glm::ivec2 a, glm::ivec2 b, glm::ivec2 c)
+{
+    /* (col, row) is (x, -z), counter-clockwise in it is counter-clockwise seen from above */
+    int area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (area < 0)
+        std::swap(b, c);
+
+    for (glm::ivec2 vertex : { a, b, c })
+        chunkIndices.push_back(vertex.y * (CHUNK_QUADS + 1) + vertex.x);
+}
+
+void Terrain::generatePatches()
+{
+    int patchRows = std::max(1, (int)std::ceil((rows - 1) / (float)TESS_PATCH_QUADS));
+    int patchCols = std::max(1, (int)std::ceil((cols - 1) / (float)TESS_PATCH_QUADS));
+
+    patchVertices.clear();
+    patchIndices.clear();
+
+    /* Same mapping as generateTerrain, corners are shared by the neighbouring patches */
+    for (int row = 0; row <= patchRows; row++)
+    {
+        for (int col = 0; col <= patchCols; col++)
+        {
+            float xOffset = glm::mix(-terrainWidth  / 2,  terrainWidth  / 2, (float)col / patchCols);
+            float zOffset = glm::mix( terrainLength / 2, -terrainLength / 2, (float)row / patchRows);
+            patchVertices.push_back(glm::vec2(xOffset, zOffset));
+        }
+    }
+
+    for (int row = 0; row < patchRows; row++)
+    {
+        for (int col = 0; col < patchCols; col++)
+        {
+            unsigned int index = row * (patchCols + 1) + col;
+            unsigned int above = index + patchCols + 1;
+            patchIndices.insert(patchIndices.end(), { index, index + 1, above + 1, above });
+        }
+    }
+}
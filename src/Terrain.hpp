@@ -7,22 +7,109 @@
 
 #include <geGL/geGL.h>
 
+#include "Frustum.hpp"
+#include "HeightField.hpp"
+#include "VertexCacheOptimizer.hpp"
+
+/*
+    Height map terrain grid. Besides the monolithic strip grid the terrain is split into chunks of CHUNK_QUADS^2 quads
+    (geomipmapping): every chunk has its own vertices, all chunks share one index buffer holding CHUNK_LOD_COUNT levels.
+    A chunk has at most (CHUNK_QUADS + 1)^2 vertices, so its positions are 16-bit normalized coordinates within the chunk
+    bounds and its indices are 16-bit.
+    A level is split into the interior and 4 edge bands, the edge band towards a coarser neighbour skips the vertices
+    the neighbour does not have, so the seams stay closed.
+    For hardware tessellation the terrain is also a grid of coarse quad patches of TESS_PATCH_QUADS^2 strip quads.
+    The monolithic grid is indexed either as row strips or as a triangle list reordered for the post-transform vertex cache,
+    the row strips reuse nothing of the previous row once a row is wider than the cache.
+*/
+
 class Terrain
 {
 public:
+    /* Chunk neighbours, bottom is the first grid row (positive z) */
+    enum class Side { BOTTOM, RIGHT, TOP, LEFT };
+
+    /* Index buffer of the monolithic grid */
+    enum class IndexFormat
+    {
+        STRIP,          // GL_TRIANGLE_STRIP per row with primitive restart
+        OPTIMIZED_LIST  // GL_TRIANGLES reordered by VertexCacheOptimizer
+    };
+
+    static constexpr int CHUNK_QUADS = 32;      // per chunk side
+    static constexpr int CHUNK_LOD_COUNT = 6;   // level l uses every 2^l-th vertex, the last one is 2 triangles
+    static constexpr int TESS_PATCH_QUADS = 16; // strip quads per patch side, the tessellation level that matches the strip grid
+
+    struct Chunk
+    {
+        glm::vec2 min;          // xz bounds
+        glm::vec2 max;
+        glm::vec2 heightRange;  // of the last selection
+        int neighbours[4];      // by Side, -1 on the terrain border
+    };
+
+    /* Position within Chunk::min - Chunk::max, GL_UNSIGNED_SHORT normalized */
+    struct ChunkVertex
+    {
+        GLushort x;
+        GLushort z;
+    };
+
+    /* Mirrors DrawElementsIndirectCommand */
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint  baseVertex;
+        GLuint baseInstance;
+    };
+
     Terrain(float terrainWidth, float terrainLength, int rows, int cols);
     ~Terrain();
 
+    void setIndexFormat(IndexFormat format);
+    IndexFormat getIndexFormat();
+    GLenum getPrimitiveType();
     int getIndexCount();
     int getRestartIndex();
+    VertexCacheOptimizer::Statistics getIndexStatistics(IndexFormat format);   // FIFO cache of DEFAULT_CACHE_SIZE
     float getTerrainWidth();
     float getTerrainLength();
+    int getVertexCount();
+    int getTriangleCount();
 
     std::shared_ptr<ge::gl::Buffer> getTerrainVertexBuffer();
     std::shared_ptr<ge::gl::Buffer> getTerrainIndexBuffer();
 
+    /* Chunks (GL_TRIANGLES, GL_UNSIGNED_SHORT indices into the local grid shared by all chunks, baseInstance of the draw commands is the chunk) */
+    int getChunkCount();
+    const std::vector<Chunk> &getChunks();
+    std::shared_ptr<ge::gl::Buffer> getChunkVertexBuffer();
+    std::shared_ptr<ge::gl::Buffer> getChunkIndexBuffer();
+    std::shared_ptr<ge::gl::Buffer> getChunkBoundsBuffer();    // vec4 per chunk - min xz, max xz
+    size_t getChunkMemorySize();                // bytes of the three buffers above
+    size_t getChunkFullPrecisionMemorySize();   // the same with vec2 positions and 32-bit indices
+
+    /* Level by the distance to the chunk bounds (lodDistance, 2 * lodDistance, 4 * lodDistance, ...), draw commands of the visible chunks.
+       The bounds are tight to the heights under each chunk, heightField has to know the terrain size. */
+    int selectChunkLods(Frustum &frustum, glm::vec3 cameraPos, float lodDistance, const HeightField &heightField, std::vector<DrawCommand> &commands);
+    int getChunkLevel(int chunk);               // of the last selection
+    int getSelectedVertexCount();
+    int getSelectedTriangleCount();
+
+    /* Quad patches (GL_PATCHES, 4 vertices counter-clockwise from the corner with the lowest row and column) */
+    int getPatchCount();
+    std::shared_ptr<ge::gl::Buffer> getPatchVertexBuffer();
+    std::shared_ptr<ge::gl::Buffer> getPatchIndexBuffer();
+
 protected:
     void generateTerrain();
+    void generateChunks();
+    void generateChunkIndices();
+    void addEdgeBand(Side side, int step, int outerStep);
+    void addChunkTriangle(glm::ivec2 a, glm::ivec2 b, glm::ivec2 c);
+    void generatePatches();
 
     int rowColToIndex(int row, int col);
 
@@ -33,8 +120,32 @@ private:
     int cols;
     int indexCount;
     int restartIndex;
+    IndexFormat indexFormat = IndexFormat::STRIP;
 
     std::vector<glm::vec2> *terrainVertices;
     std::vector<unsigned int> *terrainIndices;
+    std::vector<unsigned int> optimizedIndices;
+    VertexCacheOptimizer::Statistics stripStatistics;
+    VertexCacheOptimizer::Statistics optimizedStatistics;
+
+    struct IndexRange
+    {
+        int first;
+        int count;
+    };
+
+    int chunkRows;
+    int chunkCols;
+    std::vector<Chunk> chunks;
+    std::vector<ChunkVertex> chunkVertices;
+    std::vector<GLushort> chunkIndices;
+    IndexRange chunkInteriors[CHUNK_LOD_COUNT];
+    IndexRange chunkEdges[CHUNK_LOD_COUNT][4][CHUNK_LOD_COUNT];    // level, side, level of the coarser neighbour
+    std::vector<int> chunkLevels;
+    int selectedVertexCount = 0;
+    int selectedTriangleCount = 0;
+
+    std::vector<glm::vec2> patchVertices;
+    std::vector<unsigned int> patchIndices;
 
 };
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "TerrainClipmap.hpp"
+
+/* Non-negative remainder, origins are negative on one side of the terrain */
+static long long floorMod(long long value, long long divisor)
+{
+	long long remainder = value % divisor;
+	return remainder < 0 ? remainder + divisor : remainder;
+}
+
+TerrainClipmap::TerrainClipmap(int blockSize, int levelCount, float spacing)
+	: blockSize{ std::max(blockSize, 2) }, levelCount{ std::clamp(levelCount, 1, MAX_LEVEL_COUNT) }, spacing{ spacing }
+{
+	uniforms = {};
+	for (int i = 0; i < (int)Mesh::COUNT; i++)
+		instanceOffsets[i] = instanceCounts[i] = 0;
+
+	generateMeshes();
+}
+
+int TerrainClipmap::getBlockSize()
+{
+	return blockSize;
+}
+
+int TerrainClipmap::getLevelCount()
+{
+	return levelCount;
+}
+
+float TerrainClipmap::getSpacing()
+{
+	return spacing;
+}
+
+float TerrainClipmap::getExtent()
+{
+	return (4 * blockSize - 2) * spacing * (1 << (levelCount - 1));
+}
+
+std::shared_ptr<ge::gl::Buffer> TerrainClipmap::getVertexBuffer()
+{
+	return std::make_shared<ge::gl::Buffer>(vertices.size() * sizeof(glm::vec2), vertices.data());
+}
+
+std::shared_ptr<ge::gl::Buffer> TerrainClipmap::getIndexBuffer()
+{
+	return std::make_shared<ge::gl::Buffer>(indices.size() * sizeof(unsigned int), indices.data());
+}
+
+TerrainClipmap::MeshRange TerrainClipmap::getMesh(Mesh mesh)
+{
+	return meshes[(int)mesh];
+}
+
+void TerrainClipmap::update(glm::vec3 cameraPos, Frustum &frustum, const HeightField &heightField)
+{
+	this->frustum = &frustum;
+	this->heightField = &heightField;
+	for (auto &instances : meshInstances)
+		instances.clear();
+
+	/* Origins in units of the finest spacing. The finest level is centered on the camera and snapped to every other vertex,
+	   so its border lies on the coarser grid; the coarser inner region (2m quads) is placed over it with the finer level
+	   touching either its low or its high side - the trim fills the other one. */
+	const int m = blockSize;
+	long long originX[MAX_LEVEL_COUNT];
+	long long originZ[MAX_LEVEL_COUNT];
+	originX[0] = 2 * (long long)std::floor((cameraPos.x / spacing - (2 * m - 1)) / 2.0);
+	originZ[0] = 2 * (long long)std::floor((cameraPos.z / spacing - (2 * m - 1)) / 2.0);
+	for (int level = 1; level < levelCount; level++)
+	{
+		long long step = 1ll << level;
+		originX[level] = originX[level - 1] - (m - 1) * step;
+		originZ[level] = originZ[level - 1] - (m - 1) * step;
+		if (floorMod(originX[level], 2 * step) != 0)
+			originX[level] -= step;
+		if (floorMod(originZ[level], 2 * step) != 0)
+			originZ[level] -= step;
+	}
+
+	for (int level = 0; level < levelCount; level++)
+	{
+		long long step = 1ll << level;
+		int last = level < levelCount - 1 ? 4 * m - 2 : 0;
+		uniforms.levels[level] = glm::vec4(originX[level] * spacing, originZ[level] * spacing, step * spacing, last);
+
+		/* 4 x 4 blocks around the fix-up cross, the inner 2 x 2 are the hole of the finer level */
+		const int blockOffsets[4] = { 0, m - 1, 2 * m, 3 * m - 1 };
+		for (int row = 0; row < 4; row++)
+		{
+			for (int col = 0; col < 4; col++)
+			{
+				bool ring = row == 0 || row == 3 || col == 0 || col == 3;
+				if (ring || level == 0)
+					addInstance(Mesh::BLOCK, level, glm::ivec2(blockOffsets[col], blockOffsets[row]));
+			}
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			bool ring = i == 0 || i == 3;
+			if (!ring && level > 0)
+				continue;
+			addInstance(Mesh::FIXUP_COLUMN, level, glm::ivec2(2 * m - 2, blockOffsets[i]));
+			addInstance(Mesh::FIXUP_ROW, level, glm::ivec2(blockOffsets[i], 2 * m - 2));
+		}
+
+		if (level == 0)
+			addInstance(Mesh::CENTER, level, glm::ivec2(2 * m - 2, 2 * m - 2));
+		else
+		{
+			/* 1 - the finer level touches the high side of the inner region, the trim is on the low side */
+			int shiftX = (int)((originX[level - 1] - originX[level]) / step - (m - 1));
+			int shiftZ = (int)((originZ[level - 1] - originZ[level]) / step - (m - 1));
+			addInstance(Mesh::TRIM_COLUMN, level, glm::ivec2(m - 1 + (shiftX == 0 ? 2 * m - 1 : 0), m - 1));
+			addInstance(Mesh::TRIM_ROW, level, glm::ivec2(m - 1 + (shiftX == 0 ? 0 : 1), m - 1 + (shiftZ == 0 ? 2 * m - 1 : 0)));
+		}
+
+		if (level < levelCount - 1)
+			addInstance(Mesh::SEAM, level, glm::ivec2(0, 0));
+	}
+
+	/* Instances of one mesh are drawn by one instanced draw */
+	int offset = 0;
+	for (int i = 0; i < (int)Mesh::COUNT; i++)
+	{
+		instanceOffsets[i] = offset;
+		instanceCounts[i] = std::min((int)meshInstances[i].size(), MAX_INSTANCE_COUNT - offset);
+		std::copy(meshInstances[i].begin(), meshInstances[i].begin() + instanceCounts[i], uniforms.instances + offset);
+		offset += instanceCounts[i];
+	}
+}
+
+const TerrainClipmap::Uniforms &TerrainClipmap::getUniforms()
+{
+	return uniforms;
+}
+
+int TerrainClipmap::getInstanceOffset(Mesh mesh)
+{
+	return instanceOffsets[(int)mesh];
+}
+
+int TerrainClipmap::getInstanceCount(Mesh mesh)
+{
+	return instanceCounts[(int)mesh];
+}
+
+int TerrainClipmap::getVertexCount()
+{
+	int vertexCount = 0;
+	for (int i = 0; i < (int)Mesh::COUNT; i++)
+		vertexCount += instanceCounts[i] * meshes[i].vertexCount;
+	return vertexCount;
+}
+
+int TerrainClipmap::getTriangleCount()
+{
+	int triangleCount = 0;
+	for (int i = 0; i < (int)Mesh::COUNT; i++)
+	{
+		if (i != (int)Mesh::SEAM)
+			triangleCount += instanceCounts[i] * meshes[i].indexCount / 3;
+	}
+	return triangleCount;
+}
+
+void TerrainClipmap::generateMeshes()
+{
+	const int m = blockSize;
+	addGridMesh(Mesh::BLOCK, glm::ivec2(m - 1, m - 1));
+	addGridMesh(Mesh::FIXUP_COLUMN, glm::ivec2(2, m - 1));
+	addGridMesh(Mesh::FIXUP_ROW, glm::ivec2(m - 1, 2));
+	addGridMesh(Mesh::CENTER, glm::ivec2(2, 2));
+	addGridMesh(Mesh::TRIM_COLUMN, glm::ivec2(1, 2 * m));
+	addGridMesh(Mesh::TRIM_ROW, glm::ivec2(2 * m - 1, 1));
+	addSeamMesh();
+}
+
+void TerrainClipmap::addGridMesh(Mesh mesh, glm::ivec2 size)
+{
+	MeshRange &range = meshes[(int)mesh];
+	range.firstIndex  = indices.size();
+	range.baseVertex  = vertices.size();
+	range.vertexCount = (size.x + 1) * (size.y + 1);
+	range.size		  = size;
+
+	for (int z = 0; z <= size.y; z++)
+	{
+		for (int x = 0; x <= size.x; x++)
+			vertices.push_back(glm::vec2(x, z));
+	}
+
+	/* Counter-clockwise seen from above (x, -z) */
+	for (int z = 0; z < size.y; z++)
+	{
+		for (int x = 0; x < size.x; x++)
+		{
+			unsigned int index = z * (size.x + 1) + x;
+			unsigned int above = index + size.x + 1;
+			indices.insert(indices.end(), { index, above + 1, index + 1 });
+			indices.insert(indices.end(), { index, above, above + 1 });
+		}
+	}
+	range.indexCount = indices.size() - range.firstIndex;
+}
+
+void TerrainClipmap::addSeamMesh()
+{
+	/* Triangles over every odd border vertex and its two neighbours, collapsed to lines once the border is morphed */
+	MeshRange &range = meshes[(int)Mesh::SEAM];
+	int last = 4 * blockSize - 2;
+	range.firstIndex  = indices.size();
+	range.baseVertex  = vertices.size();
+	range.size		  = glm::ivec2(last, last);
+
+	auto border = [last](int side, int position)
+	{
+		switch (side)
+		{
+			case 0:  return glm::vec2(position, 0);
+			case 1:  return glm::vec2(last, position);
+			case 2:  return glm::vec2(last - position, last);
+			default: return glm::vec2(0, last - position);
+		}
+	};
+
+	for (int side = 0; side < 4; side++)
+	{
+		for (int position = 0; position < last; position += 2)
+		{
+			unsigned int first = vertices.size() - range.baseVertex;
+			for (int i = 0; i < 3; i++)
+				vertices.push_back(border(side, position + i));
+			indices.insert(indices.end(), { first, first + 1, first + 2 });
+		}
+	}
+	range.vertexCount = vertices.size() - range.baseVertex;
+	range.indexCount  = indices.size() - range.firstIndex;
+}
+
+void TerrainClipmap::addInstance(Mesh mesh, int level, glm::ivec2 offset)
+{
+	glm::vec4 levelData = uniforms.levels[level];
+	glm::vec2 size = glm::vec2(meshes[(int)mesh].size) * levelData.z;
+	glm::vec2 min = glm::vec2(levelData.x, levelData.y) + glm::vec2(offset) * levelData.z;
+	glm::vec2 heightRange = heightField->getTerrainHeightRange(min, min + size);
+
+	if (frustum->isBoxVisible(glm::vec3(min.x, heightRange.x, min.y), glm::vec3(min.x + size.x, heightRange.y, min.y + size.y)))
+		meshInstances[(int)mesh].push_back(glm::ivec4(offset.x, offset.y, level, 0));
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include <geGL/geGL.h>
+
+#include "Frustum.hpp"
+#include "HeightField.hpp"
+
+/*
+    Geometry clipmap terrain (Asirvatham, Hoppe - GPU Gems 2, chapter 2). Level l is a grid of 4m - 1 vertices per side
+    with the spacing 2^l * spacing, centered on the camera. Every level but the finest leaves a hole for the finer one.
+    Levels are assembled from a few shared meshes - m x m vertex blocks, 3 vertices wide fix-ups and the L-shaped trim
+    on the side the finer level is shifted to - so only the instance offsets change per frame and the vertex cost does
+    not depend on the terrain size.
+*/
+class TerrainClipmap
+{
+public:
+    enum class Mesh
+    {
+        BLOCK,          // (m - 1) x (m - 1) quads
+        FIXUP_COLUMN,   // 2 x (m - 1) quads in the middle of the level
+        FIXUP_ROW,      // (m - 1) x 2 quads
+        CENTER,         // 2 x 2 quads, finest level only
+        TRIM_COLUMN,    // 1 x 2m quads
+        TRIM_ROW,       // (2m - 1) x 1 quads
+        SEAM,           // zero area triangles over the T-junctions on the outer border
+        COUNT
+    };
+
+    static constexpr int MAX_LEVEL_COUNT = 8;
+    static constexpr int MAX_INSTANCE_COUNT = 256;
+
+    /* Mirrors the ClipmapUniforms block in shaders/terrainClipmapVS.glsl (std140) */
+    struct Uniforms
+    {
+        glm::vec4 levels[MAX_LEVEL_COUNT];          // world xz of vertex (0, 0), spacing, last vertex index (0 - no border morphing)
+        glm::ivec4 instances[MAX_INSTANCE_COUNT];   // offset in level vertices, level
+    };
+
+    struct MeshRange
+    {
+        int firstIndex;
+        int indexCount;
+        int baseVertex;
+        int vertexCount;
+        glm::ivec2 size;    // quads
+    };
+
+    /* blockSize m is the block side in vertices, levels have 4m - 1 vertices per side */
+    TerrainClipmap(int blockSize = 16, int levelCount = 6, float spacing = 1.0f);
+
+    int getBlockSize();
+    int getLevelCount();
+    float getSpacing();
+    float getExtent();      // world size of the coarsest level
+
+    std::shared_ptr<ge::gl::Buffer> getVertexBuffer();
+    std::shared_ptr<ge::gl::Buffer> getIndexBuffer();
+    MeshRange getMesh(Mesh mesh);
+
+    /* Level origins around the camera and the visible instances grouped by mesh, culled with the heights under each instance */
+    void update(glm::vec3 cameraPos, Frustum &frustum, const HeightField &heightField);
+    const Uniforms &getUniforms();
+    int getInstanceOffset(Mesh mesh);
+    int getInstanceCount(Mesh mesh);
+
+    /* Of the last update, vertices on piece borders are counted per piece */
+    int getVertexCount();
+    int getTriangleCount();
+
+protected:
+    void generateMeshes();
+    void addGridMesh(Mesh mesh, glm::ivec2 size);
+    void addSeamMesh();
+    void addInstance(Mesh mesh, int level, glm::ivec2 offset);
+
+private:
+    int blockSize;
+    int levelCount;
+    float spacing;
+
+    std::vector<glm::vec2> vertices;
+    std::vector<unsigned int> indices;
+    MeshRange meshes[(int)Mesh::COUNT];
+
+    Uniforms uniforms;
+    std::vector<glm::ivec4> meshInstances[(int)Mesh::COUNT];
+    int instanceOffsets[(int)Mesh::COUNT];
+    int instanceCounts[(int)Mesh::COUNT];
+
+    /* Culling state of the update */
+    Frustum *frustum;
+    const HeightField *heightField;
+};
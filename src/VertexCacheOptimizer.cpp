@@ -0,0 +1,150 @@
+#include "VertexCacheOptimizer.hpp"
+
+std::vector<unsigned int> VertexCacheOptimizer::optimize(const std::vector<unsigned int> &triangles, int vertexCount, int cacheSize)
+{
+	int triangleCount = triangles.size() / 3;
+
+	/* Vertex -> triangle adjacency in compressed rows */
+	std::vector<int> adjacencyOffsets(vertexCount + 1, 0);
+	for (unsigned int vertex : triangles)
+		adjacencyOffsets[vertex + 1]++;
+	for (int v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<int> adjacency(triangles.size());
+	std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (int t = 0; t < triangleCount; t++)
+	{
+		for (int k = 0; k < 3; k++)
+			adjacency[fill[triangles[3 * t + k]]++] = t;
+	}
+
+	std::vector<int> liveTriangles(vertexCount);
+	for (int v = 0; v < vertexCount; v++)
+		liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+
+	std::vector<int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<int> deadEnd;		// recently referenced vertices, the next fanning vertex when the candidates are exhausted
+	std::vector<int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(triangles.size());
+
+	int time = cacheSize + 1;
+	int cursor = 0;				// scan position for vertices with live triangles
+	int fanning = triangleCount > 0 ? (int)triangles[0] : -1;
+
+	while (fanning >= 0)
+	{
+		/* Emit all remaining triangles around the fanning vertex */
+		candidates.clear();
+		for (int a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+		{
+			int t = adjacency[a];
+			if (emitted[t])
+				continue;
+
+			for (int k = 0; k < 3; k++)
+			{
+				int v = triangles[3 * t + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[t] = true;
+		}
+
+		/* Next fanning vertex - the candidate that stays in the cache longest while its triangles are emitted */
+		int next = -1;
+		int bestPriority = -1;
+		for (int v : candidates)
+		{
+			if (liveTriangles[v] <= 0)
+				continue;
+
+			int priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = time - cacheTime[v];
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		/* Dead end - a recently used vertex with live triangles, else the next one in the input order */
+		while (next < 0 && !deadEnd.empty())
+		{
+			int v = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[v] > 0)
+				next = v;
+		}
+		while (next < 0 && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+				next = cursor;
+			cursor++;
+		}
+
+		fanning = next;
+	}
+
+	return output;
+}
+
+VertexCacheOptimizer::Statistics VertexCacheOptimizer::analyze(const std::vector<unsigned int> &indices, int vertexCount, bool strip,
+															  unsigned int restartIndex, int cacheSize)
+{
+	Statistics statistics{ 0, 0, 0, 0.0f, 0.0f };
+
+	std::deque<unsigned int> cache;
+	std::vector<bool> used(vertexCount, false);
+	unsigned int stripVertices[3] = {};
+	int stripLength = 0;
+
+	for (unsigned int index : indices)
+	{
+		if (strip && index == restartIndex)
+		{
+			stripLength = 0;
+			continue;
+		}
+
+		if (std::find(cache.begin(), cache.end(), index) == cache.end())
+		{
+			statistics.transformCount++;
+			cache.push_back(index);
+			if ((int)cache.size() > cacheSize)
+				cache.pop_front();
+		}
+		if (index < (unsigned int)vertexCount && !used[index])
+		{
+			used[index] = true;
+			statistics.vertexCount++;
+		}
+
+		if (strip)
+		{
+			stripVertices[0] = stripVertices[1];
+			stripVertices[1] = stripVertices[2];
+			stripVertices[2] = index;
+			stripLength++;
+			bool degenerate = stripVertices[0] == stripVertices[1] || stripVertices[1] == stripVertices[2] || stripVertices[0] == stripVertices[2];
+			if (stripLength >= 3 && !degenerate)
+				statistics.triangleCount++;
+		}
+	}
+
+	if (!strip)
+		statistics.triangleCount = indices.size() / 3;
+	if (statistics.triangleCount > 0)
+		statistics.acmr = (float)statistics.transformCount / statistics.triangleCount;
+	if (statistics.vertexCount > 0)
+		statistics.atvr = (float)statistics.transformCount / statistics.vertexCount;
+
+	return statistics;
+}
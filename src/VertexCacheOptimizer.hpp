@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+/*
+    Post-transform vertex cache helpers for indexed meshes.
+    optimize() reorders a triangle list with Tipsify (Sander, Nehab, Barczak - Fast Triangle Reordering
+    for Vertex Locality and Reduced Overdraw, 2007), analyze() replays an index buffer through a FIFO cache
+    and reports ACMR (transformed vertices per triangle) and ATVR (transformed vertices per used vertex).
+*/
+class VertexCacheOptimizer
+{
+public:
+    static constexpr int DEFAULT_CACHE_SIZE = 16;
+
+    struct Statistics
+    {
+        int triangleCount;
+        int vertexCount;        // distinct vertices referenced
+        int transformCount;     // cache misses
+        float acmr;             // 0.5 is the ideal for a regular grid, 3 is no reuse at all
+        float atvr;             // 1 is the ideal
+    };
+
+    /* Triangle list in, triangle list with the same triangles (and windings) out */
+    static std::vector<unsigned int> optimize(const std::vector<unsigned int> &triangles, int vertexCount, int cacheSize = DEFAULT_CACHE_SIZE);
+
+    /* strip - GL_TRIANGLE_STRIP with restartIndex, degenerate triangles are not counted */
+    static Statistics analyze(const std::vector<unsigned int> &indices, int vertexCount, bool strip, unsigned int restartIndex = 0xFFFFFFFF,
+                              int cacheSize = DEFAULT_CACHE_SIZE);
+};
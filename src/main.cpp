@@ -1,8 +1,11 @@
 #include <iostream>
+#include <cstring>
 
 #include <QApplication>
+#include <QCommandLineParser>
 
 #include "OpenGLWindow.hpp"
+#include "BenchmarkRunner.hpp"
 
 int main(int argc, char **argv)
 {
@@ -13,11 +16,135 @@ int main(int argc, char **argv)
 	format.setProfile(QSurfaceFormat::CoreProfile);
 	QSurfaceFormat::setDefaultFormat(format);
 
+	/* Headless runs (the options handled by BenchmarkRunner) don't need a window system unless a platform was chosen explicitly */
+	bool headlessMode = false;
+	for (int i = 1; i < argc; i++)
+		headlessMode |= strcmp(argv[i], "--benchmark") == 0 || strcmp(argv[i], "--cpu-reference") == 0 || strcmp(argv[i], "--compare-terrain") == 0;
+	if (headlessMode && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
 	QApplication app(argc, argv);
 
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	QCommandLineOption benchmarkOption("benchmark", "Run the headless benchmark and exit.");
+	QCommandLineOption cameraPathOption("camera-path", "Camera path file for the benchmark.", "file", "../res/benchmark_path.txt");
+	QCommandLineOption framesOption("frames", "Number of measured frames.", "count", "1000");
+	QCommandLineOption warmupOption("warmup", "Number of warm-up frames.", "count", "10");
+	QCommandLineOption timestepOption("timestep", "Fixed timestep in seconds.", "seconds", "0.016666");
+	QCommandLineOption widthOption("width", "Framebuffer width.", "pixels", "1920");
+	QCommandLineOption heightOption("height", "Framebuffer height.", "pixels", "1080");
+	QCommandLineOption outputOption("output", "Output prefix for the .csv and .json results.", "prefix", "benchmark");
+	QCommandLineOption maxDistanceOption("max-distance", "Grass draw distance.", "distance", "500");
+	QCommandLineOption noLodOption("no-lod", "Draw all grass with the tessellated blades.");
+	QCommandLineOption grassPathOption("grass-path", "Near blade generation: tessellation, compute, pulling or attributes.", "path", "tessellation");
+	QCommandLineOption terrainOption("terrain", "Terrain grid: strip, chunked, clipmap or tessellated.", "mode", "strip");
+	QCommandLineOption terrainIndicesOption("terrain-indices", "Strip terrain grid indices: strip or optimized (vertex cache ordered list).", "format", "strip");
+	QCommandLineOption grassPrePassOption("grass-pre-pass", "Draw the grass depth-only before shading it (adds the grass_prepass_ counters).");
+	QCommandLineOption sortPatchesOption("sort-patches", "Sort the visible grass patches front to back within each LOD tier.");
+	QCommandLineOption overdrawViewOption("overdraw-view", "Draw the grass fragment count instead of shading.");
+	QCommandLineOption cullingOption("culling", "Grass patch culling: none, cpu or gpu.", "mode", "cpu");
+	QCommandLineOption occlusionCullingOption("occlusion-culling", "Cull grass patches behind the terrain with a Hi-Z pyramid (needs --culling gpu).");
+	QCommandLineOption compareTerrainOption("compare-terrain", "Run the benchmark once per terrain mode and compare them.");
+	QCommandLineOption screenshotOption("screenshot", "Save the last frame to an image file.", "file");
+	QCommandLineOption simulationOption("simulation", "Animate the blades with the physical simulation.");
+	QCommandLineOption verifySimulationOption("verify-simulation", "Compare the GPU blade simulation with the CPU reference and exit.", "steps");
+	QCommandLineOption cpuReferenceOption("cpu-reference", "Replay the camera path with the CPU reference renderer (no GPU needed) and exit.");
+	QCommandLineOption threadsOption("threads", "CPU reference renderer threads, 0 uses all hardware threads.", "count", "0");
+	QCommandLineOption referenceObjOption("reference-obj", "Save the last CPU reference frame as an OBJ file.", "file");
+	QCommandLineOption compareReferenceOption("compare-reference", "Compare the last frame of the compute path with the CPU reference renderer.");
+	parser.addOptions({ benchmarkOption, cameraPathOption, framesOption, warmupOption, timestepOption, widthOption, heightOption, outputOption, maxDistanceOption, noLodOption,
+						grassPathOption, screenshotOption, simulationOption, verifySimulationOption, cpuReferenceOption, threadsOption, referenceObjOption,
+						compareReferenceOption, terrainOption, compareTerrainOption, terrainIndicesOption, grassPrePassOption, sortPatchesOption,
+						overdrawViewOption, cullingOption, occlusionCullingOption });
+	parser.process(app);
+
+	if (parser.isSet(benchmarkOption) || parser.isSet(cpuReferenceOption) || parser.isSet(compareTerrainOption))
+	{
+		BenchmarkRunner::Settings settings;
+		settings.cameraPathFile	  = parser.value(cameraPathOption).toStdString();
+		settings.outputPrefix	  = parser.value(outputOption).toStdString();
+		settings.frameCount		  = parser.value(framesOption).toInt();
+		settings.warmupFrameCount = parser.value(warmupOption).toInt();
+		settings.timestep		  = parser.value(timestepOption).toFloat();
+		settings.width			  = parser.value(widthOption).toInt();
+		settings.height			  = parser.value(heightOption).toInt();
+		settings.maxDistance	  = parser.value(maxDistanceOption).toFloat();
+		settings.lodEnabled		  = !parser.isSet(noLodOption);
+		settings.grassDepthPrePass = parser.isSet(grassPrePassOption);
+		settings.sortPatches	  = parser.isSet(sortPatchesOption);
+		settings.overdrawView	  = parser.isSet(overdrawViewOption);
+		settings.occlusionCulling = parser.isSet(occlusionCullingOption);
+		settings.screenshotFile	  = parser.value(screenshotOption).toStdString();
+		settings.simulationEnabled = parser.isSet(simulationOption);
+		settings.verifySimulationSteps = parser.isSet(verifySimulationOption) ? parser.value(verifySimulationOption).toInt() : 0;
+		settings.compareReference = parser.isSet(compareReferenceOption);
+		settings.threadCount	  = parser.value(threadsOption).toInt();
+		settings.referenceObjFile = parser.value(referenceObjOption).toStdString();
+
+		QString grassPath = parser.value(grassPathOption);
+		if (grassPath == "compute")
+			settings.grassPath = OpenGLWindow::GrassPath::COMPUTE;
+		else if (grassPath == "pulling")
+			settings.grassPath = OpenGLWindow::GrassPath::PULLING;
+		else if (grassPath == "attributes")
+			settings.grassPath = OpenGLWindow::GrassPath::ATTRIBUTES;
+		else if (grassPath != "tessellation")
+		{
+			std::cout << "Unknown grass path: " << grassPath.toStdString() << std::endl;
+			return 1;
+		}
+
+		QString cullingMode = parser.value(cullingOption);
+		if (cullingMode == "none")
+			settings.cullingMode = OpenGLWindow::CullingMode::NONE;
+		else if (cullingMode == "gpu")
+			settings.cullingMode = OpenGLWindow::CullingMode::GPU;
+		else if (cullingMode != "cpu")
+		{
+			std::cout << "Unknown culling mode: " << cullingMode.toStdString() << std::endl;
+			return 1;
+		}
+		if (settings.occlusionCulling && settings.cullingMode != OpenGLWindow::CullingMode::GPU)
+		{
+			std::cout << "--occlusion-culling needs --culling gpu" << std::endl;
+			return 1;
+		}
+
+		QString terrainMode = parser.value(terrainOption);
+		if (terrainMode == "chunked")
+			settings.terrainMode = OpenGLWindow::TerrainMode::CHUNKED;
+		else if (terrainMode == "clipmap")
+			settings.terrainMode = OpenGLWindow::TerrainMode::CLIPMAP;
+		else if (terrainMode == "tessellated")
+			settings.terrainMode = OpenGLWindow::TerrainMode::TESSELLATED;
+		else if (terrainMode != "strip")
+		{
+			std::cout << "Unknown terrain mode: " << terrainMode.toStdString() << std::endl;
+			return 1;
+		}
+
+		QString terrainIndices = parser.value(terrainIndicesOption);
+		if (terrainIndices == "optimized")
+			settings.terrainIndexFormat = Terrain::IndexFormat::OPTIMIZED_LIST;
+		else if (terrainIndices != "strip")
+		{
+			std::cout << "Unknown terrain index format: " << terrainIndices.toStdString() << std::endl;
+			return 1;
+		}
+
+		BenchmarkRunner runner(settings);
+		if (parser.isSet(cpuReferenceOption))
+			return runner.runCpuReference();
+		if (parser.isSet(compareTerrainOption))
+			return runner.runTerrainComparison();
+		return runner.run();
+	}
+
 	OpenGLWindow window;
 	window.showFullScreen();
 
 	std::cout << "Grass Renderer is on..." << std::endl << std::endl;
+	window.printTerrainStatistics();
 	return app.exec();
 }
\ No newline at end of file